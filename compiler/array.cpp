@@ -48,10 +48,29 @@ void Array::update(){
         else{
             this->arr_state = ARR_STATE::done;
             this->curr_op->retire();
+            if (this->trace != nullptr) this->trace->record(trace::EventType::array_idle);
         }
     }
 }
 
+void Array::reset(){
+    this->curr_w_tile = nullptr;
+    this->next_w_tile = nullptr;
+    this->buf_state = BUF_STATE::empty;
+    this->buf_cnt = 0;
+
+    this->arr_state = ARR_STATE::idle;
+    this->x_tile = nullptr;
+    this->pin_tile = nullptr;
+    this->pout_tile = nullptr;
+    this->exec_cnt = 0;
+    this->curr_op = nullptr;
+
+    this->no_macs = 0;
+    this->sram_read_bytes = 0;
+    this->sram_write_bytes = 0;
+}
+
 void Array::init_weight_buffering(int r){
     if (this->get_op(r) == nullptr) return;
     
@@ -88,6 +107,7 @@ void Array::init_tile_op(int r){
 
     this->exec_cnt = 0;
     this->arr_state = ARR_STATE::processing;
+    if (this->trace != nullptr) this->trace->record(trace::EventType::array_busy, r);
 
     this->curr_op = this->get_op(r);
     this->x_tile = this->curr_op->x_tile;
@@ -154,24 +174,92 @@ void Array::assign_op(int r, MultOp* op){
         if (r > this->last_no_round){
             this->last_no_round = r;
         }
+        if (this->traffic != nullptr) this->traffic->add_op(r, op);
         return;
     }
     
     if (sch->second == nullptr){
         this->schedule[r] = op;
         op->assign_to_array(r, this);
+        if (this->traffic != nullptr) this->traffic->add_op(r, op);
         return;
     }
 
     throw runtime_error("Cannot assign op to array");
 }
 
+InterconnectTraffic::InterconnectTraffic(){
+    this->x_bytes = 0;
+    this->w_bytes = 0;
+    this->pin_bytes = 0;
+    this->pout_bytes = 0;
+    this->x_multicast_bytes = 0;
+    this->w_multicast_bytes = 0;
+    this->pin_multicast_bytes = 0;
+    this->pout_multicast_bytes = 0;
+}
+
+bool InterconnectTraffic::is_first_send(vector<vector<bool>>& sent, int r, Tile* tile){
+    // tiles without a bank cannot be matched, count them as separate transfers
+    if (tile->bank == nullptr) return true;
+
+    if ((int) sent.size() <= r){
+        sent.resize(r + 1);
+    }
+    vector<bool>& round_sent = sent[r];
+    if ((int) round_sent.size() <= tile->bank->id){
+        round_sent.resize(tile->bank->id + 1, false);
+    }
+    if (round_sent[tile->bank->id]) return false;
+
+    round_sent[tile->bank->id] = true;
+    return true;
+}
+
+void InterconnectTraffic::add_op(int r, MultOp* op){
+    this->x_bytes += op->x_tile->memory_size;
+    if (this->is_first_send(this->x_sent, r, op->x_tile)){
+        this->x_multicast_bytes += op->x_tile->memory_size;
+    }
+
+    this->w_bytes += op->w_tile->memory_size;
+    if (this->is_first_send(this->w_sent, r, op->w_tile)){
+        this->w_multicast_bytes += op->w_tile->memory_size;
+    }
+
+    if (op->pin_op != nullptr){
+        this->add_pin(r, op);
+    }
+
+    this->pout_bytes += op->pout_tile->memory_size;
+    if (this->is_first_send(this->pout_sent, r, op->pout_tile)){
+        this->pout_multicast_bytes += op->pout_tile->memory_size;
+    }
+}
+
+void InterconnectTraffic::add_pin(int r, MultOp* op){
+    P_Tile* pin_tile = op->pin_op->pout_tile;
+    this->pin_bytes += pin_tile->memory_size;
+    if (this->is_first_send(this->pin_sent, r, pin_tile)){
+        this->pin_multicast_bytes += pin_tile->memory_size;
+    }
+}
+
+long InterconnectTraffic::total_bytes(){
+    return this->x_bytes + this->w_bytes + this->pin_bytes + this->pout_bytes;
+}
+
+long InterconnectTraffic::total_multicast_bytes(){
+    return this->x_multicast_bytes + this->w_multicast_bytes + this->pin_multicast_bytes + this->pout_multicast_bytes;
+}
+
 Arrays::Arrays(int no_arrays, int no_rows, int no_cols){
     this->no_arrays = no_arrays;
     this->array_map = new map<int, Array*>();
 
     for (int i = 0; i < no_arrays; i++){
         (*this->array_map)[i] = new Array(i, no_rows, no_cols);
+        (*this->array_map)[i]->traffic = &this->traffic;
     }
 }
 
@@ -272,7 +360,7 @@ bool Arrays::check_w_bank_conflict(int r, W_Tile* w_tile){
 }
 
 bool Arrays::check_pout_bank_conflict(int r, P_Tile* p_tile){
-    list<MultOp*>* schedule = this->get_schedule(r);
+    unique_ptr< list<MultOp*> > schedule (this->get_schedule(r));
     for (auto it = schedule->begin(); it != schedule->end(); it++){
         if ((*it) != nullptr){
             if ((*it)->pout_tile != nullptr){
@@ -282,12 +370,11 @@ bool Arrays::check_pout_bank_conflict(int r, P_Tile* p_tile){
             }
         }
     }
-    delete schedule;
     return false;
 }
 
 bool Arrays::check_pin_bank_conflict(int r, P_Tile* p_tile){
-    list<MultOp*>* schedule = this->get_schedule(r);
+    unique_ptr< list<MultOp*> > schedule (this->get_schedule(r));
     for (auto it = schedule->begin(); it != schedule->end(); it++){
         if ((*it) != nullptr){
             if ((*it)->pin_op != nullptr){
@@ -297,7 +384,6 @@ bool Arrays::check_pin_bank_conflict(int r, P_Tile* p_tile){
             }
         }
     }
-    delete schedule;
     return false;
 }
 
@@ -386,6 +472,12 @@ void Arrays::update(){
     }
 }
 
+void Arrays::reset(){
+    for (auto it = this->array_map->begin(); it != this->array_map->end(); it++){
+        it->second->reset();
+    }
+}
+
 bool Arrays::is_idle(){
     for (auto it = this->array_map->begin(); it != this->array_map->end(); it++){
         if( !(it->second->is_idle())){
@@ -8,13 +8,10 @@
 #include "ops.hpp"
 #include "interconnect.hpp"
 #include "bank.hpp"
+#include "trace.hpp"
 
 #include <boost/log/trivial.hpp>
 
-#include <boost/serialization/map.hpp>
-#include <boost/archive/text_oarchive.hpp>
-#include <boost/archive/text_iarchive.hpp>
-
 class Dram;
 
 using namespace std;
@@ -31,6 +28,34 @@ enum class ARR_STATE{
     done
 };
 
+// Bytes moved over the x, w, pin and pout interconnects, updated as ops are
+// assigned to arrays. A tile multicast to several arrays in the same round is
+// counted once in the multicast totals. Bank conflicts are rejected during
+// placement, so each bank serves a single tile per interconnect and round, and
+// a bitmap over the bank ids is enough to find the repeated tiles.
+class InterconnectTraffic{
+    public:
+        long x_bytes, w_bytes, pin_bytes, pout_bytes;
+        long x_multicast_bytes, w_multicast_bytes, pin_multicast_bytes, pout_multicast_bytes;
+
+        InterconnectTraffic();
+
+        void add_op(int r, MultOp* op);
+        // for ops whose pin is assigned after placement
+        void add_pin(int r, MultOp* op);
+        long total_bytes();
+        long total_multicast_bytes();
+
+        friend class schedule_file::Writer;
+        friend class schedule_file::Reader;
+
+    private:
+        // sent[r][bank id]: the bank already sent its tile in round r
+        vector<vector<bool>> x_sent, w_sent, pin_sent, pout_sent;
+
+        bool is_first_send(vector<vector<bool>>& sent, int r, Tile* tile);
+};
+
 class Array{
     public:
         int id;
@@ -55,6 +80,9 @@ class Array{
         long sram_write_bytes;
         long last_no_round;
 
+        InterconnectTraffic* traffic {nullptr};
+        trace::Ring* trace {nullptr};
+
         Array(){};
         Array(int id, int no_rows, int no_cols);
         ~Array();
@@ -70,26 +98,13 @@ class Array{
         bool is_idle();
 
         void update();
+        // returns the state and the counters of the cycle model to those of
+        // the constructor, the schedule is kept
+        void reset();
 
-        friend class boost::serialization::access;
-
-        template<class Archive>
-        void serialize(Archive & ar, const unsigned int version){
-            ar & this->id;
-            ar & this->no_rows;
-            ar & this->no_cols;
-            ar & this->pipeline_cycles;
-            ar & this->last_no_round;
-            ar & this->schedule;
-            ar & this->buf_state;
-            ar & this->curr_w_tile;
-            ar & this->next_w_tile;
-            ar & this->curr_op;
-            ar & this->buf_cnt;
-            ar & this->arr_state;
-            ar & this->x_tile;
-            ar & this->exec_cnt;
-        }
+        // saved and restored by the schedule file
+        friend class schedule_file::Writer;
+        friend class schedule_file::Reader;
 
     private:
         map<int, MultOp*> schedule;
@@ -100,6 +115,7 @@ class Arrays{
 
         int no_arrays;
         map<int, Array*>* array_map;
+        InterconnectTraffic traffic;
 
         Arrays(){};
         Arrays(int no_arrays, int no_rows, int no_cols);
@@ -134,19 +150,12 @@ class Arrays{
         bool is_idle();
 
         void update();
+        void reset();
 
         long total_no_ops();
         long total_sram_read_bytes();
         long total_sram_write_bytes();
 
-        friend class boost::serialization::access;
-
-        template<class Archive>
-        void serialize(Archive & ar, const unsigned int version){
-            ar & this->no_arrays;
-            ar & this->array_map;
-        }
-
     private:
     
         
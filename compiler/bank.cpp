@@ -15,10 +15,20 @@ Bank::Bank(int id, data_type type, int capacity){
 }
 
 Bank::~Bank(){
-    
+    delete this->evict_queue;
+    delete this->write_back_queue;
+    delete this->spawn_queue;
 }
 
 
+void Bank::reset(){
+    this->allocated_tiles.clear();
+    this->capacity_used = 0;
+    this->evict_queue->clear();
+    this->spawn_queue->clear();
+    this->write_back_queue->clear();
+}
+
 int Bank::evict_queue_size(){
     return accumulate(this->evict_queue->begin(), this->evict_queue->end(), 0, [](int s, pair<int, Tile*> p){return p.second->memory_size + s;});
 }
@@ -75,6 +85,8 @@ bool Bank::evict(int r){
         }
     }
 
+    if (this->trace != nullptr) this->trace->record(trace::EventType::evict, front_it->first, (int) evict_tile->type, this->id, evict_tile->memory_size);
+
     evict_tile->remove_from_sram();
     this->evict_queue->erase(front_it);
     this->free_tile(evict_tile);
@@ -183,6 +195,18 @@ Bank* Banks::get_bank_by_id(int id, data_type type){
     }
 }
 
+void Banks::reset(){
+    for (auto it = this->x_banks->begin(); it != this->x_banks->end(); it++){
+        (*it)->reset();
+    }
+    for (auto it = this->w_banks->begin(); it != this->w_banks->end(); it++){
+        (*it)->reset();
+    }
+    for (auto it = this->p_banks->begin(); it != this->p_banks->end(); it++){
+        (*it)->reset();
+    }
+}
+
 void Banks::spawn(int r){
     for (auto it = this->x_banks->begin(); it != this->x_banks->end(); it++){
         (*it)->spawn(r);
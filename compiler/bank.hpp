@@ -8,11 +8,7 @@
 
 #include "helper.hpp"
 #include "ops.hpp"
-
-#include <boost/serialization/utility.hpp>
-#include <boost/serialization/map.hpp>
-#include <boost/archive/text_oarchive.hpp>
-#include <boost/archive/text_iarchive.hpp>
+#include "trace.hpp"
 
 using namespace std;
 
@@ -26,9 +22,12 @@ class Bank{
         int capacity; //in terms of bytes
         int capacity_used;
 
-        list<pair<int, Tile*>>* evict_queue;
-        list<pair<int, Tile*>>* spawn_queue;
-        list<Tile*>* write_back_queue;
+        // the queues are owned by the bank, their tiles by the layers
+        list<pair<int, Tile*>>* evict_queue {nullptr};
+        list<pair<int, Tile*>>* spawn_queue {nullptr};
+        list<Tile*>* write_back_queue {nullptr};
+
+        trace::Ring* trace {nullptr};
 
         Bank(){};
         Bank(int id, data_type type, int capacity);
@@ -41,17 +40,8 @@ class Bank{
         void garbage_collect(int r);
         void free_tile(Tile* tile);
         int evict_queue_size();
-
-        friend class boost::serialization::access;
-
-        template<class Archive>
-        void serialize(Archive & ar, const unsigned int version){
-            ar & this->id;   
-            ar & this->type; 
-            ar & this->allocated_tiles; 
-            ar & this->capacity;
-            ar & this->capacity_used;
-        }
+        // empties the bank and its queues, as before the cycle model
+        void reset();
 
     private:
         
@@ -75,22 +65,13 @@ class Banks{
         void spawn(int r);
 
         bool is_write_back_empty();
+        void reset();
 
         void print_usage();
-
-        friend class boost::serialization::access;
-
-        template<class Archive>
-        void serialize(Archive & ar, const unsigned int version){
-            ar & this->no_banks;   
-            ar & this->x_banks; 
-            ar & this->w_banks; 
-            ar & this->p_banks;
-        }
     private:
-        list<Bank*>* x_banks;
-        list<Bank*>* w_banks;
-        list<Bank*>* p_banks;
+        list<Bank*>* x_banks {nullptr};
+        list<Bank*>* w_banks {nullptr};
+        list<Bank*>* p_banks {nullptr};
 
 };
 
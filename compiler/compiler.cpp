@@ -3,50 +3,160 @@
 
 using namespace std;
 
+// Placement candidates of a main op for one round. Preparing them only reads
+// the arrays and the banks, the interconnects are configured by apply().
+struct Compiler::OpCandidates {
+    // false if the op cannot be placed before any routing is checked
+    bool feasible = false;
+    // the reason if the op is not placed, for the profile
+    profile::Counter failure = profile::op_route_blocked;
+
+    unique_ptr< list<Array*> > avail_arrays;
+    unique_ptr< list<Bank*> > avail_x_banks;
+    unique_ptr< list<Bank*> > avail_w_banks;
+    unique_ptr< list<Bank*> > avail_pout_banks;
+
+    unique_ptr< map<Array*, Bank*> > x_permute;
+    unique_ptr< map<Array*, Bank*> > w_permute;
+    unique_ptr< map<Array*, Bank*> > pout_permute;
+
+    // placement found by search()
+    Array* array = nullptr;
+    Bank* x_bank = nullptr;
+    Bank* w_bank = nullptr;
+    Bank* p_bank = nullptr;
+
+    void apply(Interconnects* interconnects){
+        interconnects->pout_interconnect->apply_permute(this->pout_permute.get());
+        interconnects->x_interconnect->apply_permute(this->x_permute.get());
+        interconnects->w_interconnect->apply_permute(this->w_permute.get());
+        PROFILE_INTERCONNECT(apply_permute, pout);
+        PROFILE_INTERCONNECT(apply_permute, x);
+        PROFILE_INTERCONNECT(apply_permute, w);
+    }
+
+    // applies only to the networks whose routing depends on earlier mappings,
+    // the others are overwritten by the next apply() anyway
+    void replay(Interconnects* interconnects){
+        if (interconnects->pout_interconnect->is_apply_incremental()){
+            interconnects->pout_interconnect->apply_permute(this->pout_permute.get());
+            PROFILE_INTERCONNECT(apply_permute, pout);
+        }
+        if (interconnects->x_interconnect->is_apply_incremental()){
+            interconnects->x_interconnect->apply_permute(this->x_permute.get());
+            PROFILE_INTERCONNECT(apply_permute, x);
+        }
+        if (interconnects->w_interconnect->is_apply_incremental()){
+            interconnects->w_interconnect->apply_permute(this->w_permute.get());
+            PROFILE_INTERCONNECT(apply_permute, w);
+        }
+    }
+
+    // first array and banks that can be routed on the applied interconnects
+    bool search(Interconnects* interconnects){
+        for(auto sa_it = avail_arrays->begin(); sa_it != avail_arrays->end(); sa_it++){
+            for(auto x_bank_it = avail_x_banks->begin(); x_bank_it != avail_x_banks->end(); x_bank_it++){
+                PROFILE_INTERCONNECT(is_route_free, x);
+                if (!interconnects->x_interconnect->is_route_free(*x_bank_it, *sa_it)){
+                    continue;
+                }
+
+                for(auto w_bank_it = avail_w_banks->begin(); w_bank_it != avail_w_banks->end(); w_bank_it++){
+                    PROFILE_INTERCONNECT(is_route_free, w);
+                    if (!interconnects->w_interconnect->is_route_free(*w_bank_it, *sa_it)){
+                        continue;
+                    }
+
+                    for(auto p_bank_it = avail_pout_banks->begin(); p_bank_it != avail_pout_banks->end(); p_bank_it++){
+                        PROFILE_INTERCONNECT(is_route_free, pout);
+                        if (!interconnects->pout_interconnect->is_route_free(*p_bank_it, *sa_it)){
+                            continue;
+                        }
+
+                        this->array = *sa_it;
+                        this->x_bank = *x_bank_it;
+                        this->w_bank = *w_bank_it;
+                        this->p_bank = *p_bank_it;
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+};
+
 #ifdef COMPILER_MULTITHREADING
 
 struct Compiler::WorkerData {
-    // interconnects should not be shared among different threads
-    // have your own copy.
-    Interconnects interconnects;
+    // read-only view of the compiler's interconnects
+    // networks that are modified by route checks are replicated on demand
+    InterconnectsSnapshot interconnects;
 
+    // candidate banks of the current placement, owned by the compiler
     list<Bank *> *avail_x_banks;
     list<Bank *> *avail_w_banks;
     list<Bank *> *avail_pout_banks;
+    bool banks_changed = true;
+
+    // worker-local copies of the candidate banks, copied once per placement
+    // instead of walking the compiler's lists in every task
+    vector<Bank *> x_banks;
+    vector<Bank *> w_banks;
+    vector<Bank *> pout_banks;
 
     Op *in_op1;
     Op *in_op2;
+
+    void update_banks(){
+        if (!banks_changed) return;
+        auto copy = [](list<Bank *> *from, vector<Bank *> &to){
+            to.clear();
+            if (from != nullptr) to.insert(to.end(), from->begin(), from->end());
+        };
+        copy(avail_x_banks, x_banks);
+        copy(avail_w_banks, w_banks);
+        copy(avail_pout_banks, pout_banks);
+        banks_changed = false;
+    }
 };
 
 struct Compiler::PlacementClosure {
     // is this a placement operation for the postpp?
     bool pp = false;
 
-    // job-specific data
-    list<Array *>::iterator sa_it;
-    list<Bank *>::iterator x_bank_it;
-    list<Bank *>::iterator w_bank_it;
-    list<Bank *>::iterator p_bank_it;
+    // candidates of the placement, the search index selects one
+    vector<Array *> const *arrays = nullptr;
+    vector<PostProcessor *> const *pps = nullptr;
+
+    // banks found by the job
+    Bank *x_bank = nullptr;
+    Bank *w_bank = nullptr;
+    Bank *p_bank = nullptr;
 
-    list<PostProcessor *>::iterator pp_it;
-    list<Bank *>::iterator pout_it;
+    bool operator()(std::size_t idx, WorkerData &wd) {
+        PROFILE_COUNT(pls_tasks_run);
+        wd.update_banks();
 
-    bool operator()(std::size_t idx, const WorkerData &wd) {
         if (pp) {
             // closure for postprocessor op placement
-            if (!wd.interconnects.pp_in1_interconnect->is_route_free(wd.in_op1->pout_tile->bank, *pp_it)){
+            PostProcessor *pp = (*pps)[idx];
+            PROFILE_INTERCONNECT(is_route_free, pp_in1);
+            if (!wd.interconnects.pp_in1_interconnect()->is_route_free(wd.in_op1->pout_tile->bank, pp)){
                 return false;
             }
-            if (!wd.interconnects.pp_in2_interconnect->is_route_free(wd.in_op2->pout_tile->bank, *pp_it)){
+            PROFILE_INTERCONNECT(is_route_free, pp_in2);
+            if (!wd.interconnects.pp_in2_interconnect()->is_route_free(wd.in_op2->pout_tile->bank, pp)){
                 return false;
             }
 
-            for (auto pout_it = wd.avail_pout_banks->begin(); pout_it != wd.avail_pout_banks->end(); pout_it++){
-                if (!wd.interconnects.pp_out_interconnect->is_route_free(*pout_it, *pp_it)){
+            for (Bank *pout_bank: wd.pout_banks){
+                PROFILE_INTERCONNECT(is_route_free, pp_out);
+                if (!wd.interconnects.pp_out_interconnect()->is_route_free(pout_bank, pp)){
                     continue;
                 }
 
-                this->pout_it = pout_it;
+                this->p_bank = pout_bank;
                 
                 return true;
             }
@@ -55,24 +165,28 @@ struct Compiler::PlacementClosure {
         }
         else {
             // closure for op placement
-            for(auto x_bank_it = wd.avail_x_banks->begin(); x_bank_it != wd.avail_x_banks->end(); x_bank_it++){
-                if (!wd.interconnects.x_interconnect->is_route_free(*x_bank_it, *sa_it)){
+            Array *sa = (*arrays)[idx];
+            for(Bank *x_bank: wd.x_banks){
+                PROFILE_INTERCONNECT(is_route_free, x);
+                if (!wd.interconnects.x_interconnect()->is_route_free(x_bank, sa)){
                     continue;
                 }
 
-                for(auto w_bank_it = wd.avail_w_banks->begin(); w_bank_it != wd.avail_w_banks->end(); w_bank_it++){
-                    if (!wd.interconnects.w_interconnect->is_route_free(*w_bank_it, *sa_it)){
+                for(Bank *w_bank: wd.w_banks){
+                    PROFILE_INTERCONNECT(is_route_free, w);
+                    if (!wd.interconnects.w_interconnect()->is_route_free(w_bank, sa)){
                         continue;
                     }
 
-                    for(auto p_bank_it = wd.avail_pout_banks->begin(); p_bank_it != wd.avail_pout_banks->end(); p_bank_it++){
-                        if (!wd.interconnects.pout_interconnect->is_route_free(*p_bank_it, *sa_it)){
+                    for(Bank *p_bank: wd.pout_banks){
+                        PROFILE_INTERCONNECT(is_route_free, pout);
+                        if (!wd.interconnects.pout_interconnect()->is_route_free(p_bank, sa)){
                             continue;
                         }
 
-                        x_bank_it = x_bank_it;
-                        w_bank_it = w_bank_it;
-                        p_bank_it = p_bank_it;
+                        this->x_bank = x_bank;
+                        this->w_bank = w_bank;
+                        this->p_bank = p_bank;
 
                         return true;
                     }
@@ -84,6 +198,47 @@ struct Compiler::PlacementClosure {
     }
 };
 
+struct Compiler::RoundWorkerData {
+    // private interconnects of the worker, configured for the probed round
+    Interconnects* interconnects {nullptr};
+
+    // the compiler's interconnects and the prepared rounds of the window
+    Interconnects* owner {nullptr};
+    vector<OpCandidates>* window {nullptr};
+
+    // interconnects is copied from owner once per window, the slots before
+    // applied have been replayed on it since
+    bool copied {false};
+    std::size_t applied {0};
+
+    ~RoundWorkerData(){
+        delete interconnects;
+    }
+};
+
+struct Compiler::RoundClosure {
+    // position of the probed round in the window
+    std::size_t slot = 0;
+
+    bool operator()(std::size_t idx, RoundWorkerData &wd) {
+        PROFILE_COUNT(pls_tasks_run);
+        // a worker probes increasing slots, so the mappings applied before the
+        // probe in the sequential search are replayed incrementally
+        if (!wd.copied || slot < wd.applied){
+            wd.interconnects->copy_from(wd.owner);
+            wd.copied = true;
+            wd.applied = 0;
+        }
+        for (std::size_t i = wd.applied; i < slot; ++i){
+            if ((*wd.window)[i].feasible) (*wd.window)[i].replay(wd.interconnects);
+        }
+        (*wd.window)[slot].apply(wd.interconnects);
+        wd.applied = slot + 1;
+
+        return (*wd.window)[slot].search(wd.interconnects);
+    }
+};
+
 #endif
 
 
@@ -100,6 +255,8 @@ int no_unique_numbers(list<int> l){
 }
 
 
+Compiler::Compiler(){}
+
 Compiler::Compiler(Arrays* arrays, Banks* banks, Interconnects* interconnects, PostProcessors* post_processors, Dram* dram){
     this->arrays = arrays;
     this->banks = banks;
@@ -109,106 +266,80 @@ Compiler::Compiler(Arrays* arrays, Banks* banks, Interconnects* interconnects, P
 
     this->sram_round_trip = this->interconnects->x_interconnect->data_req_latency() + this->interconnects->x_interconnect->data_read_latency();
     this->pp_latency_offset = this->interconnects->pout_interconnect->data_write_latency();
+    this->no_cycles = 0;
     this->memory_stall_cycles = 0;
 }
 
+// Both totals are maintained by Arrays::traffic while ops are assigned
 float Compiler::interconn_total_mbytes(){
-    int no_rounds = this->no_main_rounds();
-
-    float total_interconn_bytes = 0; //in MB
-    
-    list<X_Tile*>* x_tiles;
-    list<W_Tile*>* w_tiles;
-    list<P_Tile*>* pin_tiles;
-    list<P_Tile*>* pout_tiles;
-
-    int r = 0;
-    while(r <= no_rounds){
-        x_tiles = this->arrays->get_x_tiles(r);
-        for (auto it=x_tiles->begin(); it!=x_tiles->end(); it++){
-            total_interconn_bytes += (*it)->memory_size / 1024.0 / 1024.0;
-        }
-        delete x_tiles;
-
-        w_tiles = this->arrays->get_w_tiles(r);
-        for(auto it=w_tiles->begin(); it != w_tiles->end(); it++){
-            total_interconn_bytes += (*it)->memory_size / 1024.0 / 1024.0;
-        }
-        delete w_tiles;
-
-        pin_tiles = this->arrays->get_pin_tiles(r);
-        for(auto it=pin_tiles->begin(); it != pin_tiles->end(); it++){
-            total_interconn_bytes += (*it)->memory_size / 1024.0 / 1024.0;
-        }
-        delete pin_tiles;
-
-        pout_tiles = this->arrays->get_pout_tiles(r);
-        for(auto it=pout_tiles->begin(); it != pout_tiles->end(); it++){
-            total_interconn_bytes += (*it)->memory_size / 1024.0 / 1024.0;
-        }
-        delete pout_tiles;
-
-        r++;
-    }
-    return total_interconn_bytes;
+    return this->arrays->traffic.total_bytes() / 1024.0 / 1024.0;
 }
-float Compiler::interconn_total_mbytes_with_multicast(){
-    int no_rounds = this->no_main_rounds();
-
-    float multicast_interconn_bytes = 0; //in MB
-    
-    list<X_Tile*>* x_tiles;
-    list<W_Tile*>* w_tiles;
-    list<P_Tile*>* pin_tiles;
-    list<P_Tile*>* pout_tiles;
-
-    int r = 0;
-    while(r <= no_rounds){
-        x_tiles = this->arrays->get_x_tiles(r);
-        set<X_Tile*> x_multi_casted{};
-        for (auto it=x_tiles->begin(); it!=x_tiles->end(); it++){
-            if (x_multi_casted.insert(*it).second){
-                multicast_interconn_bytes += (*it)->memory_size / 1024.0 / 1024.0;
-            }
-        }
-        delete x_tiles;
-
-        w_tiles = this->arrays->get_w_tiles(r);
-        set<W_Tile*> w_multi_casted{};
-        for(auto it=w_tiles->begin(); it != w_tiles->end(); it++){
-            if (w_multi_casted.insert(*it).second){
-                multicast_interconn_bytes += (*it)->memory_size / 1024.0 / 1024.0;
-            }
-        }
-        delete w_tiles;
-
-        pin_tiles = this->arrays->get_pin_tiles(r);
-        set<P_Tile*> pin_multi_casted{};
-        for(auto it=pin_tiles->begin(); it != pin_tiles->end(); it++){
-            if (pin_multi_casted.insert(*it).second){
-                multicast_interconn_bytes += (*it)->memory_size / 1024.0 / 1024.0;
-            }
-        }
-        delete pin_tiles;
 
-        pout_tiles = this->arrays->get_pout_tiles(r);
-        set<P_Tile*> pout_multi_casted{};
-        for(auto it=pout_tiles->begin(); it != pout_tiles->end(); it++){
-            if (pout_multi_casted.insert(*it).second){
-                multicast_interconn_bytes += (*it)->memory_size / 1024.0 / 1024.0;
-            }
-        }
-        delete pout_tiles;
+float Compiler::interconn_total_mbytes_with_multicast(){
+    return this->arrays->traffic.total_multicast_bytes() / 1024.0 / 1024.0;
+}
 
-        r++;
+json Compiler::sim_results(json const& config){
+    json jout(config);
+    jout["bandwidth"] = this->dram->bandwidth;
+    jout["prefetch"] = this->dram->prefetch_limit;
+    jout["no_cycles"] = this->no_cycles;
+    jout["no_main_rounds"] = this->no_main_rounds();
+    jout["no_post_rounds"] = this->no_post_rounds();
+    if (this->interconnects->clos.n > 0){
+        jout["clos_m"] = this->interconnects->clos.m;
+        jout["clos_n"] = this->interconnects->clos.n;
+        jout["clos_r"] = this->interconnects->clos.r;
     }
-
-    return multicast_interconn_bytes;
+    jout["interconnect_tdp"] = this->interconnects->tdp(this->arrays->array_map->begin()->second->no_cols);
+    jout["interconnect_energy"] = this->interconnects->energy_spent(); //J
+    // the energy per inference of a single model, see no_passes
+    jout["interconnect_energy_per_pass"] = this->interconnects->energy_spent() / this->no_passes; //J
+    jout["no_passes"] = this->no_passes;
+#define ACTIVITY(x) jout["interconnect_activity"][#x] = {{"energy", this->interconnects->x##_interconnect->energy_spent}, {"stage_bytes", this->interconnects->x##_interconnect->stage_bytes}, {"avg_fanout", this->interconnects->x##_interconnect->avg_fanout()}, {"max_fanout", this->interconnects->x##_interconnect->max_fanout}};
+    ACTIVITY(x)
+    ACTIVITY(w)
+    ACTIVITY(pin)
+    ACTIVITY(pout)
+    ACTIVITY(pp_in1)
+    ACTIVITY(pp_in2)
+    ACTIVITY(pp_out)
+#undef ACTIVITY
+    jout["x_tiles_bw_usage"] = this->dram->x_tiles_bw_usage;
+    jout["w_tiles_bw_usage"] = this->dram->w_tiles_bw_usage;
+    jout["p_tiles_bw_usage"] = this->dram->p_tiles_bw_usage;
+    jout["total_bw_usage"] = this->dram->x_tiles_bw_usage + this->dram->w_tiles_bw_usage + this->dram->p_tiles_bw_usage;
+    jout["no_post_ops"] = this->post_processors->total_no_ops(); //INT operation (elementwise)
+    jout["no_ops"] = this->arrays->total_no_ops(); //INT operation (elementwise)
+    jout["total_sram_read_bytes"] = this->arrays->total_sram_read_bytes() + this->post_processors->total_sram_read_bytes(); //Bytes
+    jout["total_sram_write_bytes"] = this->arrays->total_sram_write_bytes() + this->post_processors->total_sram_write_bytes(); //Bytes
+    jout["memory_stall_cycles"] = this->memory_stall_cycles;
+
+    jout["interconn_total_mbytes"] = this->interconn_total_mbytes();
+    jout["interconn_total_mbytes_with_multicast"] = this->interconn_total_mbytes_with_multicast();
+    InterconnectTraffic& traffic = this->arrays->traffic;
+    jout["interconn_bytes"] = {{"x", traffic.x_bytes}, {"w", traffic.w_bytes}, {"pin", traffic.pin_bytes}, {"pout", traffic.pout_bytes}};
+    jout["interconn_bytes_with_multicast"] = {{"x", traffic.x_multicast_bytes}, {"w", traffic.w_multicast_bytes}, {"pin", traffic.pin_multicast_bytes}, {"pout", traffic.pout_multicast_bytes}};
+    return jout;
 }
 
-
+// The partition size of the precompiler in config is kept for a model that it
+// tiled, its array_size is that of the tiles and may differ from the arrays.
+void Compiler::add_array_config(json& config){
+    Array* array = this->arrays->array_map->begin()->second;
+    config["array_rows"] = array->no_rows;
+    config["array_cols"] = array->no_cols;
+    if (this->tiled_partition_size > 0) config["partition_size"] = this->tiled_partition_size;
+}
 
 void Compiler::compile(Model* model){
+    // an untiled model is partitioned as the precompiler's split_mat would for these arrays
+    Array* array = this->arrays->array_map->begin()->second;
+    int partition_size = this->partition_size > 0 ? this->partition_size : array->no_rows;
+    if (model->tile(make_tuple(partition_size, array->no_rows, array->no_cols))){
+        this->tiled_partition_size = partition_size;
+    }
+
     while (!model->all_layers_scheduled()){
         for(auto it = model->begin(); it != model->end(); it++){
             if (it->is_scheduled) continue;
@@ -236,6 +367,8 @@ void Compiler::compile(Model* model){
 }
 
 void Compiler::compile_layer(Layer* layer, int init_round){
+    PROFILE_LAYER_TIMER(layer->layer_name);
+
     layer->create_main_ops();
     layer->init_banks(this->banks);
 
@@ -249,6 +382,10 @@ void Compiler::compile_layer(Layer* layer, int init_round){
 
                 int r = init_round;
                 while (true){
+#ifdef COMPILER_MULTITHREADING
+                    if (spec_pls_ && r > init_round) r = this->speculative_op_placement(r, op);
+                    else
+#endif
                     this->op_placement(r, op);
 
                     if (op->is_placed()){
@@ -337,16 +474,19 @@ void Compiler::post_op_placement(int r, AggrOp* op){
 
     unique_ptr< list<PostProcessor*> > avail_pps (this->post_processors->available_pps(r));
     if (avail_pps->empty()){
+        PROFILE_PLACEMENT(post_op_attempts, profile::post_op_no_pp);
         return;
     }
 
     unique_ptr< map<PostProcessor*, Bank*> > pin1_permute (this->post_processors->get_pin1_permute(r));
     if(this->post_processors->check_pin1_bank_conflict(r, in_op1->pout_tile)){
+        PROFILE_PLACEMENT(post_op_attempts, profile::post_op_bank_conflict);
         return;
     }
 
     unique_ptr< map<PostProcessor*, Bank*> > pin2_permute (this->post_processors->get_pin2_permute(r));
     if(this->post_processors->check_pin2_bank_conflict(r, in_op2->pout_tile)){
+        PROFILE_PLACEMENT(post_op_attempts, profile::post_op_bank_conflict);
         return;
     }
 
@@ -355,6 +495,7 @@ void Compiler::post_op_placement(int r, AggrOp* op){
     unique_ptr< list<Bank*> > avail_pout_banks;
     if (op->pout_tile->bank != nullptr){
         if(this->post_processors->check_pout_bank_conflict(r, op->pout_tile)){
+            PROFILE_PLACEMENT(post_op_attempts, profile::post_op_bank_conflict);
             return;
         }
         avail_pout_banks = unique_ptr< list<Bank*> >(new list<Bank*>());
@@ -366,62 +507,64 @@ void Compiler::post_op_placement(int r, AggrOp* op){
             avail_pout_banks->remove(it->second);
         }
     }
-    if(avail_pout_banks->empty()) return;
+    if(avail_pout_banks->empty()){
+        PROFILE_PLACEMENT(post_op_attempts, profile::post_op_no_bank);
+        return;
+    }
 
     this->interconnects->pp_in1_interconnect->apply_permute(pin1_permute.get());
     this->interconnects->pp_in2_interconnect->apply_permute(pin2_permute.get());
     this->interconnects->pp_out_interconnect->apply_permute(pout_permute.get());
+    PROFILE_INTERCONNECT(apply_permute, pp_in1);
+    PROFILE_INTERCONNECT(apply_permute, pp_in2);
+    PROFILE_INTERCONNECT(apply_permute, pp_out);
 
 #ifdef COMPILER_MULTITHREADING
-    if (pls_){
+    if (pls_ && avail_pps->size() >= min_parallel_candidates_){
         for (std::size_t i = 0; i < pls_->num_workers(); ++i) {
             auto &wd = pls_->worker_data(i);
-            wd.interconnects.copy_from(this->interconnects);
+            wd.avail_x_banks = nullptr;
+            wd.avail_w_banks = nullptr;
             wd.avail_pout_banks = avail_pout_banks.get();
+            wd.banks_changed = true;
             wd.in_op1 = in_op1;
             wd.in_op2 = in_op2;
         }
 
-        pls_->begin();
-
-        for (auto pp_it = avail_pps->begin(); pp_it != avail_pps->end() && (!pls_ || pls_->should_continue()); pp_it++){
-            pls_->append_job(PlacementClosure{
-                true,
-                {}, // sa_it
-                {}, // x_bank_it
-                {}, // w_bank_it
-                {}, // p_bank_it
-                pp_it, // pp_it
-                {} // pout_it
-            });
-        }
-        pls_->end();
-        auto result = pls_->result();
+        vector<PostProcessor *> pps(avail_pps->begin(), avail_pps->end());
+        PROFILE_ADD(pls_tasks_dispatched, pps.size());
+        auto result = pls_->search(pps.size(), PlacementClosure{true, nullptr, &pps});
 
         if (result) {
-            op->pout_tile->assign_bank(*result->closure.pout_it);
-            (*result->closure.pp_it)->assign_op(r, op);
+            PostProcessor *pp = pps[result->idx];
+            op->pout_tile->assign_bank(result->closure.p_bank);
+            pp->assign_op(r, op);
             
             BOOST_LOG_TRIVIAL(info) <<
                 "Post-op placed: layer_name: " << op->layer_name <<
-                "\tround: " << r << "\tsa: " << (*result->closure.pp_it)->id <<
-                "\tpout_bank: " << (*result->closure.pout_it)->id;
+                "\tround: " << r << "\tsa: " << pp->id <<
+                "\tpout_bank: " << result->closure.p_bank->id;
+            PROFILE_PLACEMENT(post_op_attempts, profile::post_op_placed);
             return ;
         }
 
+        PROFILE_PLACEMENT(post_op_attempts, profile::post_op_route_blocked);
         return ;
     }
 #endif
 
     for (auto pp_it = avail_pps->begin(); pp_it != avail_pps->end(); pp_it++){
+        PROFILE_INTERCONNECT(is_route_free, pp_in1);
         if (!this->interconnects->pp_in1_interconnect->is_route_free(in_op1->pout_tile->bank, *pp_it)){
             continue;
         }
+        PROFILE_INTERCONNECT(is_route_free, pp_in2);
         if (!this->interconnects->pp_in2_interconnect->is_route_free(in_op2->pout_tile->bank, *pp_it)){
             continue;
         }
 
         for (auto pout_it = avail_pout_banks->begin(); pout_it != avail_pout_banks->end(); pout_it++){
+            PROFILE_INTERCONNECT(is_route_free, pp_out);
             if (!this->interconnects->pp_out_interconnect->is_route_free(*pout_it, *pp_it)){
                 continue;
             }
@@ -433,158 +576,225 @@ void Compiler::post_op_placement(int r, AggrOp* op){
                 "Post-op placed: layer_name: " << op->layer_name <<
                 "\tround: " << r << "\tsa: " << (*pp_it)->id << "\tpout_bank: " << (*pout_it)->id;
 
+            PROFILE_PLACEMENT(post_op_attempts, profile::post_op_placed);
             return;
         }
     }
+
+    PROFILE_PLACEMENT(post_op_attempts, profile::post_op_route_blocked);
 }
 
-void Compiler::op_placement(int r, MultOp* op){
-    unique_ptr< list<Array*> > avail_arrays (this->arrays->available_arrays(r));
+void Compiler::prepare_op_placement(int r, MultOp* op, OpCandidates& candidates){
+    candidates.feasible = false;
+    candidates.avail_arrays = unique_ptr< list<Array*> >(this->arrays->available_arrays(r));
 
-    if (avail_arrays->empty()){
+    if (candidates.avail_arrays->empty()){
+        candidates.failure = profile::op_no_array;
         return;
     }
 
-    unique_ptr< map<Array*, Bank*> > pout_permute (this->arrays->get_pout_permute(r));
+    candidates.pout_permute = unique_ptr< map<Array*, Bank*> >(this->arrays->get_pout_permute(r));
 
-    unique_ptr< list<Bank*> > avail_pout_banks;
     if (op->pout_tile->bank != nullptr){
         if (this->arrays->check_pout_bank_conflict(r, op->pout_tile)){
+            candidates.failure = profile::op_bank_conflict;
             return;
         }
 
-        avail_pout_banks = unique_ptr< list<Bank*> >(new list<Bank*>());
-        avail_pout_banks->push_back(op->pout_tile->bank);
+        candidates.avail_pout_banks = unique_ptr< list<Bank*> >(new list<Bank*>());
+        candidates.avail_pout_banks->push_back(op->pout_tile->bank);
     }
     else{
-        avail_pout_banks = unique_ptr< list<Bank*> >(new list<Bank*>(*this->banks->get_p_banks()));
-        for (auto it = pout_permute->begin(); it != pout_permute->end(); it++){
-            avail_pout_banks->remove(it->second);
+        candidates.avail_pout_banks = unique_ptr< list<Bank*> >(new list<Bank*>(*this->banks->get_p_banks()));
+        for (auto it = candidates.pout_permute->begin(); it != candidates.pout_permute->end(); it++){
+            candidates.avail_pout_banks->remove(it->second);
         }
     }
-    if(avail_pout_banks->empty()) return;
+    if(candidates.avail_pout_banks->empty()){
+        candidates.failure = profile::op_no_bank;
+        return;
+    }
     
-    unique_ptr< map<Array*, Bank*> > x_permute (this->arrays->get_x_permute(r));
+    candidates.x_permute = unique_ptr< map<Array*, Bank*> >(this->arrays->get_x_permute(r));
 
-    unique_ptr< list<Bank*> > avail_x_banks;
     if (op->x_tile->bank != nullptr){
         if (this->arrays->check_x_bank_conflict(r, op->x_tile)){
+            candidates.failure = profile::op_bank_conflict;
             return;
         }
         
-        avail_x_banks = unique_ptr< list<Bank*> >(new list<Bank*>());
-        avail_x_banks->push_back(op->x_tile->bank);
+        candidates.avail_x_banks = unique_ptr< list<Bank*> >(new list<Bank*>());
+        candidates.avail_x_banks->push_back(op->x_tile->bank);
     }
     else{
-        avail_x_banks = unique_ptr< list<Bank*> >(new list<Bank*>(*this->banks->get_x_banks()));
-        for (auto it = x_permute->begin(); it != x_permute->end(); it++){
-            avail_x_banks->remove(it->second);
+        candidates.avail_x_banks = unique_ptr< list<Bank*> >(new list<Bank*>(*this->banks->get_x_banks()));
+        for (auto it = candidates.x_permute->begin(); it != candidates.x_permute->end(); it++){
+            candidates.avail_x_banks->remove(it->second);
         }
     }
-    if(avail_x_banks->empty()) return;
+    if(candidates.avail_x_banks->empty()){
+        candidates.failure = profile::op_no_bank;
+        return;
+    }
     
-    unique_ptr< map<Array*, Bank*> > w_permute (this->arrays->get_w_permute(r));
-    unique_ptr< list<Bank*> > avail_w_banks;
+    candidates.w_permute = unique_ptr< map<Array*, Bank*> >(this->arrays->get_w_permute(r));
+
     if (op->w_tile->bank != nullptr){
         if (this->arrays->check_w_bank_conflict(r, op->w_tile)){
+            candidates.failure = profile::op_bank_conflict;
             return;
         }
 
-        avail_w_banks = unique_ptr< list<Bank*> >(new list<Bank*>());
-        avail_w_banks->push_back(op->w_tile->bank);
+        candidates.avail_w_banks = unique_ptr< list<Bank*> >(new list<Bank*>());
+        candidates.avail_w_banks->push_back(op->w_tile->bank);
     }
     else{
-        avail_w_banks = unique_ptr< list<Bank*> >(new list<Bank*>(*this->banks->get_w_banks()));
-        for (auto it = w_permute->begin(); it != w_permute->end(); it++){
-            avail_w_banks->remove(it->second);
+        candidates.avail_w_banks = unique_ptr< list<Bank*> >(new list<Bank*>(*this->banks->get_w_banks()));
+        for (auto it = candidates.w_permute->begin(); it != candidates.w_permute->end(); it++){
+            candidates.avail_w_banks->remove(it->second);
         }
     }
-    if(avail_w_banks->empty()) return;
+    if(candidates.avail_w_banks->empty()){
+        candidates.failure = profile::op_no_bank;
+        return;
+    }
+
+    candidates.feasible = true;
+    candidates.failure = profile::op_route_blocked;
+}
 
-    this->interconnects->pout_interconnect->apply_permute(pout_permute.get());
-    this->interconnects->x_interconnect->apply_permute(x_permute.get());    
-    this->interconnects->w_interconnect->apply_permute(w_permute.get());    
+void Compiler::commit_op_placement(int r, MultOp* op, OpCandidates& candidates){
+    op->x_tile->assign_bank(candidates.x_bank);
+    op->w_tile->assign_bank(candidates.w_bank);
+    op->pout_tile->assign_bank(candidates.p_bank);
+    candidates.array->assign_op(r, op);
 
+    BOOST_LOG_TRIVIAL(info) << "Op placed: layer_name: " << op->layer_name << "\tind: " <<  get<0>(op->op_ind) << "-" << get<1>(op->op_ind) << "-" << get<2>(op->op_ind) << "\tround: " << r << "\tsa: " << candidates.array->id << "\tx bank id: " << (op->x_tile->bank->id);
+}
+
+void Compiler::op_placement(int r, MultOp* op){
+    OpCandidates candidates;
+    this->prepare_op_placement(r, op, candidates);
+    if (!candidates.feasible){
+        PROFILE_PLACEMENT(op_attempts, candidates.failure);
+        return;
+    }
+
+    candidates.apply(this->interconnects);
 
 #ifdef COMPILER_MULTITHREADING
-    if (pls_) {
+    if (pls_ && candidates.avail_arrays->size() >= min_parallel_candidates_) {
         for (std::size_t i = 0; i < pls_->num_workers(); ++i) {
             auto &wd = pls_->worker_data(i);
-            wd.interconnects.copy_from(this->interconnects);
-            wd.avail_x_banks = avail_x_banks.get();
-            wd.avail_w_banks = avail_w_banks.get();
-            wd.avail_pout_banks = avail_pout_banks.get();
+            wd.avail_x_banks = candidates.avail_x_banks.get();
+            wd.avail_w_banks = candidates.avail_w_banks.get();
+            wd.avail_pout_banks = candidates.avail_pout_banks.get();
+            wd.banks_changed = true;
         }
 
-        pls_->begin();
+        vector<Array *> arrays(candidates.avail_arrays->begin(), candidates.avail_arrays->end());
+        PROFILE_ADD(pls_tasks_dispatched, arrays.size());
+        auto result = pls_->search(arrays.size(), PlacementClosure{false, &arrays, nullptr});
 
-        for(auto sa_it = avail_arrays->begin(); sa_it != avail_arrays->end() && (!pls_ || pls_->should_continue()); sa_it++){
-            pls_->append_job(PlacementClosure{
-                true,
-                sa_it, // sa_it
-                {}, // x_bank_it
-                {}, // w_bank_it
-                {}, // p_bank_it
-                {}, // pp_it
-                {} // pout_it
-            });
+        if (result) {
+            candidates.array = arrays[result->idx];
+            candidates.x_bank = result->closure.x_bank;
+            candidates.w_bank = result->closure.w_bank;
+            candidates.p_bank = result->closure.p_bank;
+            this->commit_op_placement(r, op, candidates);
         }
+        PROFILE_PLACEMENT(op_attempts, result ? profile::op_placed : candidates.failure);
+        return ;
+    }
 
-        pls_->end();
-        auto result = pls_->result();
+#endif
 
-        if (result) {
-            op->x_tile->assign_bank(*result->closure.x_bank_it);
-            op->w_tile->assign_bank(*result->closure.w_bank_it);
-            op->pout_tile->assign_bank(*result->closure.p_bank_it);
-            (*result->closure.sa_it)->assign_op(r, op);
+    bool placed = candidates.search(this->interconnects);
+    if (placed){
+        this->commit_op_placement(r, op, candidates);
+    }
+    PROFILE_PLACEMENT(op_attempts, placed ? profile::op_placed : candidates.failure);
+}
 
-            BOOST_LOG_TRIVIAL(info) <<
-                "Op placed: layer_name: " << op->layer_name <<
-                "\tind: " <<  get<0>(op->op_ind) <<
-                "-" << get<1>(op->op_ind) <<
-                "-" << get<2>(op->op_ind) <<
-                "\tround: " << r <<
-                "\tsa: " << (*result->closure.sa_it)->id <<
-                "\tx bank id: " << (op->x_tile->bank->id);
+#ifdef COMPILER_MULTITHREADING
 
-            return ;
-        }
+// Probes rounds r .. r + window - 1 and places op at the smallest feasible one.
+// The rounds are independent until an op is assigned, so each probe is run on
+// a private copy of the interconnects that is configured with the same
+// sequence of mappings as the sequential search would apply before it.
+// Returns the round that is placed, or the last probed round.
+int Compiler::speculative_op_placement(int r, MultOp* op){
+    vector<OpCandidates> window(spec_window_);
+    for (std::size_t i = 0; i < window.size(); ++i){
+        this->prepare_op_placement(r + i, op, window[i]);
     }
 
-#endif
+    for (std::size_t i = 0; i < spec_pls_->num_workers(); ++i) {
+        auto &wd = spec_pls_->worker_data(i);
+        wd.owner = this->interconnects;
+        wd.window = &window;
+        wd.copied = false;
+    }
 
-    for(auto sa_it = avail_arrays->begin(); sa_it != avail_arrays->end(); sa_it++){
-        for(auto x_bank_it = avail_x_banks->begin(); x_bank_it != avail_x_banks->end(); x_bank_it++){
-            if (!this->interconnects->x_interconnect->is_route_free(*x_bank_it, *sa_it)){
-                continue;
-            }
+    spec_pls_->begin(window.size());
+    for (std::size_t i = 0; i < window.size() && spec_pls_->should_continue(); ++i){
+        if (!window[i].feasible) continue;
+        PROFILE_COUNT(pls_tasks_dispatched);
+        spec_pls_->append_job(RoundClosure{i});
+    }
+    spec_pls_->end();
+    auto result = spec_pls_->result();
 
-            for(auto w_bank_it = avail_w_banks->begin(); w_bank_it != avail_w_banks->end(); w_bank_it++){
-                if (!this->interconnects->w_interconnect->is_route_free(*w_bank_it, *sa_it)){
-                    continue;
-                }
+    std::size_t last = result ? result->closure.slot : window.size() - 1;
 
-                for(auto p_bank_it = avail_pout_banks->begin(); p_bank_it != avail_pout_banks->end(); p_bank_it++){
-                    if (!this->interconnects->pout_interconnect->is_route_free(*p_bank_it, *sa_it)){
-                        continue;
-                    }
+    // leave the interconnects as the sequential search would
+    for (std::size_t i = 0; i <= last; ++i){
+        if (window[i].feasible) window[i].apply(this->interconnects);
+        PROFILE_PLACEMENT(op_attempts, result && i == last ? profile::op_placed : window[i].failure);
+    }
 
-                    op->x_tile->assign_bank(*x_bank_it);
-                    op->w_tile->assign_bank(*w_bank_it);
-                    op->pout_tile->assign_bank(*p_bank_it);
-                    (*sa_it)->assign_op(r, op);
+    if (result){
+        this->commit_op_placement(r + last, op, window[last]);
+    }
+    return r + last;
+}
 
-                    BOOST_LOG_TRIVIAL(info) << "Op placed: layer_name: " << op->layer_name << "\tind: " <<  get<0>(op->op_ind) << "-" << get<1>(op->op_ind) << "-" << get<2>(op->op_ind) << "\tround: " << r << "\tsa: " << (*sa_it)->id << "\tx bank id: " << (op->x_tile->bank->id);
+#endif
 
-                    return;
-                }
-            }
+// Re-routes the complete mapping of every round on each interconnect and pushes
+// all of its packets through the configured network in a single pass.
+// Returns the number of rounds that cannot be delivered as scheduled.
+int Compiler::verify_schedule(){
+    int no_rounds = this->no_main_rounds();
+    if (this->no_post_rounds() > no_rounds) no_rounds = this->no_post_rounds();
+
+    int no_failed_rounds = 0;
+    for (int r = 0; r <= no_rounds; r++){
+        unique_ptr< map<Array*, Bank*> > x_permute (this->arrays->get_x_permute(r));
+        unique_ptr< map<Array*, Bank*> > w_permute (this->arrays->get_w_permute(r));
+        unique_ptr< map<Array*, Bank*> > pout_permute (this->arrays->get_pout_permute(r));
+        unique_ptr< map<Array*, Bank*> > pin_permute (this->arrays->get_pin_permute(r));
+        unique_ptr< map<PostProcessor*, Bank*> > pp_pin1_permute (this->post_processors->get_pin1_permute(r));
+        unique_ptr< map<PostProcessor*, Bank*> > pp_pin2_permute (this->post_processors->get_pin2_permute(r));
+        unique_ptr< map<PostProcessor*, Bank*> > pp_pout_permute (this->post_processors->get_pout_permute(r));
+
+        bool verified = true;
+        verified &= this->interconnects->x_interconnect->verify_round(x_permute.get());
+        verified &= this->interconnects->w_interconnect->verify_round(w_permute.get());
+        verified &= this->interconnects->pout_interconnect->verify_round(pout_permute.get());
+        verified &= this->interconnects->pin_interconnect->verify_round(pin_permute.get());
+        verified &= this->interconnects->pp_in1_interconnect->verify_round(pp_pin1_permute.get());
+        verified &= this->interconnects->pp_in2_interconnect->verify_round(pp_pin2_permute.get());
+        verified &= this->interconnects->pp_out_interconnect->verify_round(pp_pout_permute.get());
+
+        if (!verified){
+            BOOST_LOG_TRIVIAL(warning) << "Round " << r << " cannot be delivered by the interconnects as scheduled";
+            no_failed_rounds++;
         }
     }
-}
-
 
+    return no_failed_rounds;
+}
 
 int Compiler::no_main_rounds(){
     int max_rounds = 0;
@@ -608,11 +818,13 @@ int Compiler::no_post_rounds(){
 
 
 void Compiler::duplicate_schedule(Model* model, int no_repeat){
+    PROFILE_TIMER(duplicate_schedule);
     int no_layers = model->layer_list->size();
 
     int no_main_rounds = this->no_main_rounds();
     int no_post_rounds = this->no_post_rounds();
     int max_no_rounds = no_main_rounds > no_post_rounds ? no_main_rounds : no_post_rounds;
+    this->no_passes = max(this->no_passes, no_repeat);
 
     for (int i = 1; i < no_repeat; i++){
 
@@ -633,11 +845,12 @@ void Compiler::duplicate_schedule(Model* model, int no_repeat){
 
                 int old_round = op_old->round_placed;
                 int new_round = old_round + i*(max_no_rounds+1) + 1;
-                op_old->array_placed->assign_op(new_round, op_new);
-
+                // pin is set before the op is assigned so that its traffic is counted
                 if (op_old->pin_op != nullptr){
                     op_new->assign_pin(new_layer.main_ops[op_old->pin_op->op_ind]);
                 }
+
+                op_old->array_placed->assign_op(new_round, op_new);
                 
             }
 
@@ -659,7 +872,7 @@ void Compiler::duplicate_schedule(Model* model, int no_repeat){
                 }
             }
 
-            model->layer_list->push_back(new_layer);
+            model->layer_list->push_back(std::move(new_layer));
             layer_it++;
         }
     }
@@ -718,6 +931,7 @@ bool Compiler::is_all_data_ready(Arrays* arrays, PostProcessors* post_processors
 }
 
 void Compiler::create_memory_fifo(){
+    PROFILE_TIMER(create_memory_fifo);
     int no_rounds = this->no_main_rounds();
     if (this->no_post_rounds() > no_rounds) no_rounds = this->no_post_rounds();
 
@@ -761,6 +975,7 @@ void Compiler::create_memory_fifo(){
 }
 
 void Compiler::run_cycle_model(){
+    PROFILE_TIMER(run_cycle_model);
     this->create_memory_fifo();
 
     int main_rounds = this->no_main_rounds();
@@ -771,6 +986,9 @@ void Compiler::run_cycle_model(){
     int arr_cycle = 0;
     int pp_cycle = 0;
 
+    trace::Ring* rounds_trace = this->trace != nullptr ? this->trace->rounds() : nullptr;
+    if (rounds_trace != nullptr) rounds_trace->record(trace::EventType::warmup_begin);
+
     // Warm-up
     while (!this->arrays->is_weights_buffered(r)){
         list<W_Tile*>* w_tiles = this->arrays->get_w_tiles(r);
@@ -783,6 +1001,7 @@ void Compiler::run_cycle_model(){
         this->arrays->update();
         this->dram->update(this->banks->get_p_banks(), r);
         arr_cycle++;
+        if (this->trace != nullptr) this->trace->clock = arr_cycle;
     }
 
     this->banks->spawn(r);
@@ -791,24 +1010,31 @@ void Compiler::run_cycle_model(){
         this->dram->update(this->banks->get_p_banks(), r);
         arr_cycle++;
         this->memory_stall_cycles++;
+        if (this->trace != nullptr) this->trace->clock = arr_cycle;
     }
 
     pp_cycle = arr_cycle + this->pp_latency_offset;
+    if (this->trace != nullptr) this->trace->pp_clock = pp_cycle;
+    if (rounds_trace != nullptr) rounds_trace->record(trace::EventType::warmup_end);
 
     int memory_stall = 0;
     //int max_mem_size;
 
     int round_clk = 0;
+    int round_start = 0;
     bool new_round = true;
     //while(r < max_rounds || !this->banks->is_write_back_empty()){
     while(r < max_rounds){
         if (new_round){
             // Round start
             round_clk = 0;
+            round_start = arr_cycle;
+            if (rounds_trace != nullptr) rounds_trace->record(trace::EventType::round_begin, r);
             
             this->arrays->init_tile_op(r);
             this->arrays->init_weight_buffering(r+1);
             this->post_processors->init_tile_op(r);
+            this->record_interconnect_activity(r);
 
             new_round = false;
 
@@ -833,6 +1059,15 @@ void Compiler::run_cycle_model(){
 
                 this->banks->garbage_collect(r);
 
+                if (rounds_trace != nullptr){
+                    if (memory_stall > 0) rounds_trace->record(trace::EventType::stall_end, r);
+                    rounds_trace->record(trace::EventType::round_end, r);
+                }
+                if (this->round_stats != nullptr){
+                    this->round_stats->write_round(this, r, round_start, round_clk + 1, memory_stall);
+                }
+                this->dram->end_round();
+
                 r++;
                 new_round = true;
                 memory_stall = 0;
@@ -842,6 +1077,7 @@ void Compiler::run_cycle_model(){
             else{
                 memory_stall++;
                 this->memory_stall_cycles++;
+                if (rounds_trace != nullptr && memory_stall == 1) rounds_trace->record(trace::EventType::stall_begin, r);
 
                 BOOST_LOG_TRIVIAL(info) << "Memory stalling: " << memory_stall << " at r: " << r << " clk: " << arr_cycle;
 
@@ -857,30 +1093,168 @@ void Compiler::run_cycle_model(){
         arr_cycle++;
         pp_cycle++;
         round_clk++;
+        if (this->trace != nullptr){
+            this->trace->clock = arr_cycle;
+            this->trace->pp_clock = pp_cycle;
+        }
     }
 
     this->no_cycles = arr_cycle > pp_cycle ? arr_cycle : pp_cycle;
 }
 
-#ifdef COMPILER_MULTITHREADING
+void Compiler::save_cycle_model_state(){
+    this->cycle_model_tiles_.clear();
+    this->cycle_model_ops_.clear();
+
+    set<Tile*> tiles;
+    auto add_tile = [&](Tile* tile){
+        if (tile != nullptr && tiles.insert(tile).second){
+            this->cycle_model_tiles_.push_back(make_pair(tile, tile->is_allocated_on_sram));
+        }
+    };
+
+    int no_rounds = max(this->no_main_rounds(), this->no_post_rounds());
+    for (int r = 0; r <= no_rounds; r++){
+        unique_ptr< list<MultOp*> > sch (this->arrays->get_schedule(r));
+        for (MultOp* op: *sch){
+            if (op == nullptr) continue;
+            this->cycle_model_ops_.push_back(op);
+            add_tile(op->x_tile);
+            add_tile(op->w_tile);
+            add_tile(op->pout_tile);
+            if (op->pin_op != nullptr) add_tile(op->pin_op->pout_tile);
+        }
+
+        unique_ptr< list<AggrOp*> > postops (this->post_processors->get_schedule(r));
+        for (AggrOp* op: *postops){
+            if (op == nullptr) continue;
+            this->cycle_model_ops_.push_back(op);
+            add_tile(op->pin1_tile);
+            add_tile(op->pin2_tile);
+            add_tile(op->pout_tile);
+        }
+    }
+
+    this->cycle_model_state_saved_ = true;
+}
+
+void Compiler::reset_cycle_model(){
+    if (!this->cycle_model_state_saved_){
+        throw runtime_error("The state of the cycle model is not saved.");
+    }
+
+    for (auto it = this->cycle_model_tiles_.begin(); it != this->cycle_model_tiles_.end(); it++){
+        it->first->reset(it->second);
+    }
+    for (Op* op: this->cycle_model_ops_){
+        op->retired = false;
+    }
 
-void Compiler::enable_multithreading(std::size_t num_workers) {
-    pls_ = std::make_unique<multithreading::ParallelLinearSearch<PlacementClosure, WorkerData>>(num_workers);
-    for (std::size_t i = 0; i < num_workers; ++i) {
-        pls_->worker_data(i).interconnects.construct(interconnects->N, interconnects->type);
+    this->arrays->reset();
+    this->post_processors->reset();
+    this->banks->reset();
+    this->dram->reset();
+    this->interconnects->reset_activity();
+
+    this->no_cycles = 0;
+    this->memory_stall_cycles = 0;
+}
+
+void record_round_activity(InterconnectBase* interconnect, list<pair<int, Tile*>>& routes, float freq){
+    vector<Int> inverse_mapping(interconnect->num_ports(), -1);
+    vector<long> src_bytes(interconnect->num_ports(), 0);
+    for (auto it = routes.begin(); it != routes.end(); it++){
+        Tile* tile = it->second;
+        if (tile == nullptr || tile->bank == nullptr) continue;
+        inverse_mapping[it->first] = tile->bank->id;
+        src_bytes[tile->bank->id] = tile->memory_size;
     }
+    interconnect->record_activity(&inverse_mapping[0], &src_bytes[0], freq);
+}
+
+// Routes the tiles of round r through every interconnect and accumulates the
+// switch activity and the dynamic energy of each network.
+void Compiler::record_interconnect_activity(int r){
+    list<pair<int, Tile*>> x_routes, w_routes, pin_routes, pout_routes;
+    for (auto it = this->arrays->array_map->begin(); it != this->arrays->array_map->end(); it++){
+        MultOp* op = it->second->get_op(r);
+        if (op == nullptr) continue;
+        x_routes.push_back({it->first, op->x_tile});
+        w_routes.push_back({it->first, op->w_tile});
+        pout_routes.push_back({it->first, op->pout_tile});
+        if (op->pin_op != nullptr){
+            pin_routes.push_back({it->first, op->pin_op->pout_tile});
+        }
+    }
+
+    list<pair<int, Tile*>> pp_in1_routes, pp_in2_routes, pp_out_routes;
+    for (auto it = this->post_processors->pp_map->begin(); it != this->post_processors->pp_map->end(); it++){
+        AggrOp* op = it->second->get_op(r);
+        if (op == nullptr) continue;
+        if (op->get_op1() != nullptr){
+            pp_in1_routes.push_back({it->second->id, op->get_op1()->pout_tile});
+        }
+        if (op->get_op2() != nullptr){
+            pp_in2_routes.push_back({it->second->id, op->get_op2()->pout_tile});
+        }
+        pp_out_routes.push_back({it->second->id, op->pout_tile});
+    }
+
+    record_round_activity(this->interconnects->x_interconnect, x_routes, this->freq);
+    record_round_activity(this->interconnects->w_interconnect, w_routes, this->freq);
+    record_round_activity(this->interconnects->pin_interconnect, pin_routes, this->freq);
+    record_round_activity(this->interconnects->pout_interconnect, pout_routes, this->freq);
+    record_round_activity(this->interconnects->pp_in1_interconnect, pp_in1_routes, this->freq);
+    record_round_activity(this->interconnects->pp_in2_interconnect, pp_in2_routes, this->freq);
+    record_round_activity(this->interconnects->pp_out_interconnect, pp_out_routes, this->freq);
+}
+
+#ifdef COMPILER_MULTITHREADING
+
+// cpus of the pinned workers, or none
+static vector<int> worker_cpus(std::size_t num_workers, bool pin_workers) {
+    if (!pin_workers) return {};
+    return multithreading::CpuTopology::detect().worker_cpus(num_workers);
+}
+
+void Compiler::enable_multithreading(std::size_t num_workers, std::size_t min_candidates, bool pin_workers) {
+    // joins the workers of the previous pool first
+    pls_ = nullptr;
+    pls_ = std::make_unique<multithreading::ParallelRangeSearch<PlacementClosure, WorkerData>>(num_workers, worker_cpus(num_workers, pin_workers));
+    // the replicas are allocated by the workers, on their own NUMA nodes
+    pls_->run_on_workers([this](WorkerData &wd, std::size_t) {
+        wd.interconnects.attach(this->interconnects);
+        wd.x_banks.reserve(this->banks->get_x_banks()->size());
+        wd.w_banks.reserve(this->banks->get_w_banks()->size());
+        wd.pout_banks.reserve(this->banks->get_p_banks()->size());
+    });
+    min_parallel_candidates_ = min_candidates ? min_candidates : num_workers;
 }
 
 void Compiler::disable_multithreading() {
     pls_ = nullptr;
 }
 
+void Compiler::enable_speculation(std::size_t num_workers, std::size_t window, bool pin_workers) {
+    spec_pls_ = nullptr;
+    spec_pls_ = std::make_unique<multithreading::ParallelLinearSearch<RoundClosure, RoundWorkerData>>(num_workers, worker_cpus(num_workers, pin_workers));
+    spec_pls_->run_on_workers([this](RoundWorkerData &wd, std::size_t) {
+        wd.interconnects = this->interconnects->clone();
+    });
+    spec_window_ = std::max<std::size_t>(window, 1);
+}
+
+void Compiler::disable_speculation() {
+    spec_pls_ = nullptr;
+    spec_window_ = 0;
+}
+
 #endif
 
 Compiler::~Compiler() {
     #ifdef COMPILER_MULTITHREADING
-    for (std::size_t i = 0; i < pls_->num_workers(); ++i) {
-        delete std::any_cast<Interconnects *>(pls_->worker_data(i));
-    }
+    // stops and joins the workers before the members they refer to are gone
+    disable_speculation();
+    disable_multithreading();
     #endif
 }
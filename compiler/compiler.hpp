@@ -15,16 +15,15 @@
 #include "interconnect.hpp"
 #include "post_processor.hpp"
 #include "dram.hpp"
+#include "trace.hpp"
+#include "profile.hpp"
+#include "round_stats.hpp"
 
 #include "parallel_linear_search.hpp"
 #include <memory>
 
 #include <boost/log/trivial.hpp>
 
-#include <boost/serialization/map.hpp>
-#include <boost/archive/text_oarchive.hpp>
-#include <boost/archive/text_iarchive.hpp>
-
 using namespace std;
 
 class Compiler{
@@ -41,9 +40,23 @@ class Compiler{
         int pp_latency_offset;
         bool livelock_detected {false};
         int memory_stall_cycles;
-
-
-        Compiler(){};
+        float freq {1e9};
+        // rows of the input tiles of an untiled model, no_rows of the arrays if 0
+        int partition_size {0};
+        // rows of the input tiles the untiled layers were tiled with, 0 if there were none
+        int tiled_partition_size {0};
+        // passes of the schedule, the largest no_repeat of duplicate_schedule. The
+        // models of a schedule may repeat a different number of times, so a pass
+        // is one inference only for a schedule of a single model.
+        int no_passes {1};
+
+        // event trace of run_cycle_model, set by trace::Recorder
+        trace::Recorder* trace {nullptr};
+        // per-round statistics of run_cycle_model, not owned
+        RoundStats* round_stats {nullptr};
+
+
+        Compiler();
         Compiler(Arrays* arrays, Banks* banks, Interconnects* interconnects, PostProcessors* post_processors, Dram* dram);
         void compile(Model* model);
         void compile_layer(Layer* layer, int init_round);
@@ -54,42 +67,69 @@ class Compiler{
         void create_memory_fifo();
         void run_cycle_model();
         void run_cycle_model2();
+        // save_cycle_model_state records the tiles and ops of the compiled
+        // schedule and which tiles start on the sram, reset_cycle_model
+        // returns them and the hardware to that state after a run, so that
+        // the cycle model can run again (e.g. with another memory bandwidth)
+        // without compiling the models again.
+        void save_cycle_model_state();
+        void reset_cycle_model();
+        void record_interconnect_activity(int r);
         bool is_all_data_ready(Arrays* arrays, PostProcessors* post_processors, int r);
         void check_if_livelock(list<P_Tile*>* p_tiles);
         float interconn_total_mbytes();
         float interconn_total_mbytes_with_multicast();
+        int verify_schedule();
+        // results of run_cycle_model added to config (the args and hardware of the compilation)
+        json sim_results(json const& config);
+        // adds the array shape and the partition size of the compiled schedule to config
+        void add_array_config(json& config);
 
         void duplicate_schedule(Model* model, int no_repeat);
 
-        friend class boost::serialization::access;
-
-        template<class Archive>
-        void serialize(Archive & ar, const unsigned int version){
-            ar & this->no_cycles;
-            ar & this->arrays;
-            ar & this->banks;
-            ar & this->post_processors;
-            //ar & this->interconnects;
-            ar & this->dram;
-            ar & this->sram_round_trip;
-            ar & this->pp_latency_offset;
-        }
-
         #ifdef COMPILER_MULTITHREADING
 
-        void enable_multithreading(std::size_t num_workers);
+        // Placements with fewer candidates than min_candidates are searched
+        // sequentially, 0 selects the number of workers. Pinned workers are
+        // packed onto as few NUMA nodes as possible (see CpuTopology).
+        void enable_multithreading(std::size_t num_workers, std::size_t min_candidates = 0, bool pin_workers = false);
         void disable_multithreading();
 
+        // An op that does not fit at its initial round is probed at the next
+        // `window` rounds in parallel, the smallest feasible one is committed.
+        void enable_speculation(std::size_t num_workers, std::size_t window, bool pin_workers = false);
+        void disable_speculation();
+
         #endif
 
         ~Compiler();
     private:
+        struct OpCandidates;
+
+        // of save_cycle_model_state, the tiles with their is_allocated_on_sram
+        vector<pair<Tile*, bool>> cycle_model_tiles_;
+        vector<Op*> cycle_model_ops_;
+        bool cycle_model_state_saved_ {false};
+
+        void prepare_op_placement(int r, MultOp* op, OpCandidates& candidates);
+        void commit_op_placement(int r, MultOp* op, OpCandidates& candidates);
+
         #ifdef COMPILER_MULTITHREADING
 
         struct PlacementClosure;
         struct WorkerData;
         
-        std::unique_ptr<multithreading::ParallelLinearSearch<PlacementClosure, WorkerData>> pls_;
+        // the candidates of a placement are known up front and split among the workers
+        std::unique_ptr<multithreading::ParallelRangeSearch<PlacementClosure, WorkerData>> pls_;
+        std::size_t min_parallel_candidates_ {0};
+
+        struct RoundClosure;
+        struct RoundWorkerData;
+
+        int speculative_op_placement(int r, MultOp* op);
+
+        std::unique_ptr<multithreading::ParallelLinearSearch<RoundClosure, RoundWorkerData>> spec_pls_;
+        std::size_t spec_window_ {0};
         
         #endif
 };
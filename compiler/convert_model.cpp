@@ -0,0 +1,29 @@
+
+#include <iostream>
+#include <fstream>
+
+#include "model_format.hpp"
+
+using namespace std;
+
+// Converts precompiled_model.json into the binary format read by the compiler.
+int main(int ac, char* av[]){
+    if (ac != 3){
+        cout << "Usage: " << av[0] << " precompiled_model.json precompiled_model.bin" << endl;
+        return 1;
+    }
+
+    json jin;
+    ifstream input_file;
+    input_file.open(av[1], ifstream::in);
+    if(!input_file.is_open()){
+        cout << "Input file " << av[1] << " cannot be opened." << endl;
+        return 1;
+    }
+    input_file >> jin;
+    input_file.close();
+
+    model_format::write_model_file(jin, av[2]);
+
+    return 0;
+}
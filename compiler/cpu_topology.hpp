@@ -0,0 +1,165 @@
+/**
+ * @file cpu_topology.hpp
+ * @brief CPU and NUMA node layout of the host, and thread pinning.
+ *
+ */
+
+#ifndef CPU_TOPOLOGY_HPP_INCLUDED
+#define CPU_TOPOLOGY_HPP_INCLUDED
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace multithreading {
+
+// parses a kernel cpu list such as "0-3,8,10-11"
+inline std::vector<int> parse_cpu_list(std::string const &s) {
+    std::vector<int> cpus;
+    std::istringstream in{s};
+    std::string range;
+    while (std::getline(in, range, ',')) {
+        if (range.empty() || range == "\n")
+            continue;
+        auto dash = range.find('-');
+        int first = std::stoi(range.substr(0, dash));
+        int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; ++cpu)
+            cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+// cpus the process may run on (sched_getaffinity), empty if unknown
+inline std::vector<int> allowed_cpus() {
+    std::vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0)
+        return cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE && (int) cpus.size() < CPU_COUNT(&set); ++cpu) {
+        if (CPU_ISSET(cpu, &set))
+            cpus.push_back(cpu);
+    }
+#endif
+    return cpus;
+}
+
+struct CpuTopology {
+    struct Cpu {
+        int id;
+        // false for the additional hardware threads of an SMT core
+        bool primary;
+    };
+
+    // cpus of each NUMA node
+    std::vector<std::vector<Cpu>> nodes;
+
+    // Reads the layout from sysfs, keeping only the allowed cpus (all if
+    // empty). The first allowed thread of a core counts as its physical core.
+    // Without sysfs, the allowed cpus, or else all the cpus reported by the
+    // standard library, are assumed to be physical cores on a single node.
+    static CpuTopology detect(std::string const &sysfs = "/sys/devices/system",
+                              std::vector<int> const &allowed = allowed_cpus()) {
+        auto is_allowed = [&allowed](int cpu) {
+            return allowed.empty() || std::find(allowed.begin(), allowed.end(), cpu) != allowed.end();
+        };
+
+        CpuTopology topology;
+        for (int node = 0;; ++node) {
+            std::ifstream cpulist{sysfs + "/node/node" + std::to_string(node) + "/cpulist"};
+            if (!cpulist)
+                break;
+            std::string s;
+            std::getline(cpulist, s);
+
+            std::vector<Cpu> cpus;
+            for (int cpu: parse_cpu_list(s)) {
+                if (!is_allowed(cpu))
+                    continue;
+                std::ifstream siblings{sysfs + "/cpu/cpu" + std::to_string(cpu) + "/topology/thread_siblings_list"};
+                std::string t;
+                std::vector<int> thread_siblings;
+                if (siblings && std::getline(siblings, t))
+                    thread_siblings = parse_cpu_list(t);
+                auto first = std::find_if(thread_siblings.begin(), thread_siblings.end(), is_allowed);
+                bool primary = first == thread_siblings.end() || *first == cpu;
+                cpus.push_back({cpu, primary});
+            }
+            if (!cpus.empty())
+                topology.nodes.push_back(cpus);
+        }
+
+        if (topology.nodes.empty()) {
+            std::vector<Cpu> cpus;
+            for (int cpu: allowed)
+                cpus.push_back({cpu, true});
+            for (unsigned cpu = 0; allowed.empty() && cpu < std::max(1u, std::thread::hardware_concurrency()); ++cpu)
+                cpus.push_back({(int) cpu, true});
+            topology.nodes.push_back(cpus);
+        }
+        return topology;
+    }
+
+    std::size_t num_cpus() const {
+        std::size_t n = 0;
+        for (auto &node: nodes)
+            n += node.size();
+        return n;
+    }
+
+    std::size_t num_physical_cores() const {
+        std::size_t n = 0;
+        for (auto &node: nodes)
+            n += std::count_if(node.begin(), node.end(), [](Cpu const &cpu) { return cpu.primary; });
+        return n;
+    }
+
+    // Cpus for num_workers pinned workers. A node is filled before the next
+    // one is used, physical cores before their SMT siblings, so that workers
+    // share as few sockets as possible. Wraps around if there are more
+    // workers than cpus.
+    std::vector<int> worker_cpus(std::size_t num_workers) const {
+        std::vector<int> order;
+        for (auto &node: nodes) {
+            for (bool primary: {true, false}) {
+                for (auto &cpu: node) {
+                    if (cpu.primary == primary)
+                        order.push_back(cpu.id);
+                }
+            }
+        }
+
+        std::vector<int> cpus;
+        for (std::size_t i = 0; i < num_workers; ++i)
+            cpus.push_back(order[i % order.size()]);
+        return cpus;
+    }
+};
+
+// Restricts the calling thread to the given cpu. Returns false if the cpu
+// cannot be used or pinning is not supported on the platform.
+inline bool pin_current_thread(int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void) cpu;
+    return false;
+#endif
+}
+
+} // namespace multithreading
+
+#endif // CPU_TOPOLOGY_HPP_INCLUDED
@@ -1,41 +1,139 @@
 
 #include <iostream>
+#include <fstream>
+#include <vector>
 
 #include "compiler.hpp"
+#include "results_store.hpp"
+#include "schedule_file.hpp"
+#include "trace.hpp"
 #include "logger_setup.hpp"
 
 #include <boost/log/trivial.hpp>
+#include <boost/program_options.hpp>
 
 using namespace std;
 
+namespace po = boost::program_options;
+
+// Runs the cycle model on a schedule saved by the compiler (--save_schedule),
+// once for every memory bandwidth and prefetch limit given.
 int main(int ac, char* av[]){
-    boost::log::trivial::severity_level log_level = boost::log::trivial::info;
+    string schedule_path;
+    vector<float> bandwidths;
+    vector<int> prefetch_limits;
+    string work_dir;
+    string trace_file;
+    int trace_capacity;
+    string round_stats_file;
+    string results_store_file;
+    boost::log::trivial::severity_level log_level;
+
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help", "show options")
+        ("schedule,s", po::value<string>(&schedule_path)->default_value(""), "schedule file, defaults to schedule.bin in work_dir")
+        ("memory_bw,M", po::value<vector<float>>(&bandwidths)->multitoken(), "memory bandwidths in GB/s, defaults to the one of the compilation")
+        ("prefetch,P", po::value<vector<int>>(&prefetch_limits)->multitoken(), "No of rounds allowed for prefetching, defaults to the one of the compilation")
+        ("work_dir,d", po::value<string>(&work_dir)->default_value("experiments/tmp"), "directory for input/output files")
+        ("trace", po::value<string>(&trace_file)->default_value(""), "write a Chrome/Perfetto trace of each run to this file, numbered if there are several runs")
+        ("trace_capacity", po::value<int>(&trace_capacity)->default_value(1 << 16), "events kept per component in the trace, older ones are dropped")
+        ("round_stats", po::value<string>(&round_stats_file)->default_value(""), "write the statistics of every round of each run to this CSV file, numbered if there are several runs")
+        ("results_store", po::value<string>(&results_store_file)->default_value(""), "also append the results of every run to this columnar results store (see results_store.py)")
+        ("log_level,l", po::value<boost::log::trivial::severity_level>(&log_level)->default_value(boost::log::trivial::severity_level::error), "log level");
+    po::variables_map vm;
+    po::store(po::parse_command_line(ac, av, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        cout << desc << "\n";
+        return 1;
+    }
+
     logger_setup(log_level);
 
-    //TODO: Does not produce the same results because op->retire never free any tiles. 
-    //That is because serialization of tile->input_of does not work correctly so setting op->retired = True does not change the op in input_of.
-    //Fix this first before using this code.
+    if (schedule_path.empty()) schedule_path = work_dir + "/schedule.bin";
 
-    Compiler* compiler;
-    {
-        // create and open an archive for input
-        std::ifstream ifs("../experiments/tmp/schedule1.dat");
-        if (ifs.fail()){
-            cout << "Input file could not be opened." << endl;
-        }
+    // a bandwidth of 0 and a prefetch limit of -1 keep the settings of the compilation
+    if (bandwidths.empty()) bandwidths.push_back(0);
+    if (prefetch_limits.empty()) prefetch_limits.push_back(-1);
+
+    // the schedule is loaded once, a run after the first resets the state of the cycle model
+    schedule_file::Schedule* schedule = schedule_file::load(schedule_path);
+    Compiler* compiler = schedule->compiler;
+    compiler->save_cycle_model_state();
+    float compile_bandwidth = compiler->dram->bandwidth;
+    int compile_prefetch_limit = compiler->dram->prefetch_limit;
+
+    json results = json::array();
+    for (float bandwidth: bandwidths){
+        for (int prefetch_limit: prefetch_limits){
+            if (!results.empty()) compiler->reset_cycle_model();
+            profile::current().reset();
+
+            //Convert GB/s to Bytes per cycle
+            compiler->dram->bandwidth = bandwidth > 0 ? bandwidth * ((1 << 30) / compiler->freq) : compile_bandwidth;
+            compiler->dram->prefetch_limit = prefetch_limit >= 0 ? prefetch_limit : compile_prefetch_limit;
 
-        boost::archive::text_iarchive ia(ifs);
-        // read class state from archive
-        ia >> compiler;
-        // archive and stream closed when destructors are called
+            std::cout << "Running with: " <<
+                "memory bandwidth = " << compiler->dram->bandwidth << " B/cycle " <<
+                "prefetch = " << compiler->dram->prefetch_limit << " " <<
+                "\n";
+
+            // the output files of a run are numbered if there are several runs
+            bool numbered = bandwidths.size() * prefetch_limits.size() > 1;
+            string suffix = numbered ? "." + to_string(results.size()) : "";
+
+            trace::Recorder* recorder = nullptr;
+            if (!trace_file.empty()){
+                recorder = new trace::Recorder(compiler, trace_capacity);
+            }
+
+            RoundStats* round_stats = nullptr;
+            if (!round_stats_file.empty()){
+                round_stats = new RoundStats(round_stats_file + suffix);
+                compiler->round_stats = round_stats;
+            }
+
+            compiler->run_cycle_model();
+            cout << "Total no. of cycles: " << compiler->no_cycles << endl;
+
+            if (recorder != nullptr){
+                trace::save_chrome_trace(*recorder, compiler->freq, trace_file + suffix);
+                cout << "Trace saved to " << trace_file + suffix << endl;
+                delete recorder;
+            }
+
+            if (round_stats != nullptr){
+                compiler->round_stats = nullptr;
+                delete round_stats;
+                cout << "Round statistics saved to " << round_stats_file + suffix << endl;
+            }
+
+            json jout = compiler->sim_results(schedule->meta);
+            #ifdef COMPILER_PROFILE
+            jout["profile"] = profile::current().to_json();
+            #endif
+            results.push_back(jout);
+            if (!results_store_file.empty()) results_store::append(results_store_file, jout);
+        }
     }
+    delete schedule;
 
-    cout << compiler->sram_round_trip << endl;
-    cout << compiler->pp_latency_offset << endl;
+    // Save results in the JSON format, an array if more than one configuration is simulated
+    ofstream output_file;
+    string ofname = work_dir + "/sim_results.json";
+    output_file.open(ofname, ofstream::out);
+    if(!output_file.is_open()){
+        cout << "Output file " << ofname << " cannot be opened." << endl;
+        exit(1);
+    }
 
-    compiler->run_cycle_model();
+    json jout = results.size() == 1 ? results[0] : results;
+    cout << jout.dump() << endl;
 
-    cout << "no_cycles: " << compiler->no_cycles << endl;
+    output_file << jout.dump();
+    output_file.close();
 
     return 0;
-}
\ No newline at end of file
+}
@@ -16,6 +16,21 @@ Dram::Dram(float bandwidth, int prefetch_limit){
     this->load_queue = new list<pair<int, Tile*>>();
 }
 
+void Dram::reset(){
+    this->x_tiles_bw_usage = 0;
+    this->w_tiles_bw_usage = 0;
+    this->p_tiles_bw_usage = 0;
+
+    this->load_queue->clear();
+    this->end_round();
+}
+
+void Dram::end_round(){
+    this->x_round_bytes = 0;
+    this->w_round_bytes = 0;
+    this->p_round_bytes = 0;
+}
+
 void Dram::update(list<Bank*>* p_banks, int r){
     float bw_used = 0;
 
@@ -35,19 +50,31 @@ void Dram::update(list<Bank*>* p_banks, int r){
         }
 
         if (front.first - r >= this->prefetch_limit) return;
+        bool fetch_begins = front.second->bytes_fetched_from_memory == 0;
+        long fetched = (long) front.second->bytes_fetched_from_memory;
         float bw_used_ = front.second->fetch_from_memory(r, front.first, this->bandwidth-bw_used);
+        fetched = (long) front.second->bytes_fetched_from_memory - fetched;
         if (bw_used_ == 0){ //bank is full, continue with processing to free the banks
             break;
         }
 
+        if (this->trace != nullptr){
+            Tile* tile = front.second;
+            if (fetch_begins) this->trace->record(trace::EventType::fetch_begin, front.first, (int) tile->type, tile->bank->id, tile->memory_size);
+            if (tile->is_allocated()) this->trace->record(trace::EventType::fetch_end, front.first, (int) tile->type, tile->bank->id, tile->memory_size);
+        }
+
         if (front.second->type == data_type::X){
             this->x_tiles_bw_usage += bw_used_;
+            this->x_round_bytes += fetched;
         }
         else if (front.second->type == data_type::W){
             this->w_tiles_bw_usage += bw_used_;
+            this->w_round_bytes += fetched;
         }
         else{
             this->p_tiles_bw_usage += bw_used_;
+            this->p_round_bytes += fetched;
         }
 
         bw_used += bw_used_;
@@ -56,8 +83,18 @@ void Dram::update(list<Bank*>* p_banks, int r){
     for (auto it = p_banks->begin(); it != p_banks->end(); it++){
         while( !(*it)->write_back_queue->empty() ){
             Tile* front_tile =  (*it)->write_back_queue->front();
+            bool write_back_begins = front_tile->bytes_written_to_memory == 0;
+            long written = (long) front_tile->bytes_written_to_memory;
             float bw_used_ = front_tile->write_to_memory(this->bandwidth-bw_used);
+            bool write_back_ends = front_tile->bytes_written_to_memory == front_tile->memory_size;
+
+            if (this->trace != nullptr){
+                // nothing is written if the reads used up the bandwidth, the write back begins on a later cycle
+                if (write_back_begins && (bw_used_ > 0 || write_back_ends)) this->trace->record(trace::EventType::write_back_begin, r, (int) front_tile->type, (*it)->id, front_tile->memory_size);
+                if (write_back_ends) this->trace->record(trace::EventType::write_back_end, r, (int) front_tile->type, (*it)->id, front_tile->memory_size);
+            }
             this->p_tiles_bw_usage += bw_used_;
+            this->p_round_bytes += (long) front_tile->bytes_written_to_memory - written;
 
             bw_used += bw_used_;
 
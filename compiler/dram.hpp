@@ -5,11 +5,7 @@
 
 #include "tiles.hpp"
 #include "bank.hpp"
-
-#include <boost/serialization/deque.hpp>
-#include <boost/serialization/queue.hpp>
-#include <boost/archive/text_oarchive.hpp>
-#include <boost/archive/text_iarchive.hpp>
+#include "trace.hpp"
 
 using namespace std;
 
@@ -23,21 +19,26 @@ class Dram{
         float w_tiles_bw_usage;
         float p_tiles_bw_usage;
 
-        list<pair<int, Tile*>>* load_queue;
+        // bytes moved since the last end_round(), counted in whole bytes of the
+        // tiles so that the rounds add up to the tile sizes without rounding
+        long x_round_bytes {0};
+        long w_round_bytes {0};
+        long p_round_bytes {0};
+
+        // owned by the dram, the tiles by the layers
+        list<pair<int, Tile*>>* load_queue {nullptr};
+
+        trace::Ring* trace {nullptr};
 
         Dram(){};
         Dram(float bandwidth, int prefetch_limit);
-        ~Dram(){};
+        ~Dram(){ delete this->load_queue; };
 
         void update(list<Bank*>* p_banks, int r);
-
-        friend class boost::serialization::access;
-
-        template<class Archive>
-        void serialize(Archive & ar, const unsigned int version){
-            ar & this->bandwidth;
-            ar & this->load_queue;
-        }
+        // clears the load queue and the bandwidth usage, the settings are kept
+        void reset();
+        // starts counting the bytes of the next round
+        void end_round();
 
     private:
 
@@ -2,8 +2,44 @@
 #include "interconnect.hpp"
 
 #include <cmath>
+#include <stdexcept>
+#include <string>
 
-InterconnectBase *generate_interconnect(UnsignedInt n, InterconnectType type) {
+ClosParams resolve_clos_params(UnsignedInt n_log2, InterconnectType type, ClosParams params) {
+    if (!(((unsigned) type) & (unsigned) InterconnectType::clos)) {
+        return {};
+    }
+
+    long ports = 1l << n_log2;
+    if (params.m < 0 || params.n < 0 || params.r < 0) {
+        throw std::invalid_argument("Clos parameters must not be negative.");
+    }
+    if (params.n == 0 && params.r == 0) {
+        params.n = 1 << (n_log2 / 2);
+    }
+    if (params.n == 0) {
+        params.n = ports / params.r;
+    }
+    if (params.r == 0) {
+        params.r = ports / params.n;
+    }
+    if ((long) params.n * params.r != ports) {
+        throw std::invalid_argument("Clos network with n = " + std::to_string(params.n) + " and r = " +
+            std::to_string(params.r) + " does not have " + std::to_string(ports) + " ports.");
+    }
+
+    bool strict = ((unsigned) type & 0x0Fu) == 1;
+    if (params.m == 0) {
+        params.m = strict ? 2 * params.n - 1 : params.n;
+    }
+    if (params.m < params.n) {
+        throw std::invalid_argument("Clos network with m = " + std::to_string(params.m) +
+            " middle switches is blocking for n = " + std::to_string(params.n) + ".");
+    }
+    return params;
+}
+
+InterconnectBase *generate_interconnect(UnsignedInt n, InterconnectType type, ClosParams params) {
 #define XYZ(id, class) \
     if (((unsigned) type) & (unsigned) InterconnectType :: id) \
         return new class (n);
@@ -19,6 +55,11 @@ InterconnectBase *generate_interconnect(UnsignedInt n, InterconnectType type) {
         banyan->set_expansion(expansion);
         return banyan;
     }
+    if (((unsigned) type) & (unsigned) InterconnectType::clos) {
+        ClosParams clos = resolve_clos_params(n, type, params);
+        bool strict = ((unsigned) type & 0x0Fu) == 1;
+        return new Clos(clos.m, clos.n, clos.r, !strict);
+    }
 
     // TODO add crossbar here
     return nullptr;
@@ -44,10 +85,13 @@ Interconnects::Interconnects(Interconnects const &other) {
     CLONE(pp_in2_interconnect)
     CLONE(pp_out_interconnect)
 #undef CLONE
+    this->N = other.N;
+    this->type = other.type;
+    this->clos = other.clos;
 }
 
-Interconnects::Interconnects(int N, InterconnectType interconnect_type) {
-    construct(N, interconnect_type);
+Interconnects::Interconnects(int N, InterconnectType interconnect_type, ClosParams clos_params) {
+    construct(N, interconnect_type, clos_params);
 }
 
 float Interconnects::tdp(int switch_width){
@@ -62,19 +106,44 @@ float Interconnects::tdp(int switch_width){
     return tdp;
 }
 
-void Interconnects::construct(int N, InterconnectType interconnect_type) {
+float Interconnects::energy_spent(){
+    float energy = 0;
+    energy += this->x_interconnect->energy_spent;
+    energy += this->w_interconnect->energy_spent;
+    energy += this->pin_interconnect->energy_spent;
+    energy += this->pout_interconnect->energy_spent;
+    energy += this->pp_in1_interconnect->energy_spent;
+    energy += this->pp_in2_interconnect->energy_spent;
+    energy += this->pp_out_interconnect->energy_spent;
+    return energy;
+}
+
+void Interconnects::reset_activity(){
+    this->x_interconnect->reset_activity();
+    this->w_interconnect->reset_activity();
+    this->pin_interconnect->reset_activity();
+    this->pout_interconnect->reset_activity();
+    this->pp_in1_interconnect->reset_activity();
+    this->pp_in2_interconnect->reset_activity();
+    this->pp_out_interconnect->reset_activity();
+}
+
+void Interconnects::construct(int N, InterconnectType interconnect_type, ClosParams clos_params) {
     int n = std::ceil(std::log2(N));
+    // checked before any network is allocated
+    clos_params = resolve_clos_params(n, interconnect_type, clos_params);
 
-    x_interconnect = generate_interconnect(n, interconnect_type);
-    w_interconnect = generate_interconnect(n, interconnect_type);
-    pin_interconnect = generate_interconnect(n, interconnect_type);
-    pout_interconnect = generate_interconnect(n, interconnect_type);
-    pp_in1_interconnect = generate_interconnect(n, interconnect_type);
-    pp_in2_interconnect = generate_interconnect(n, interconnect_type);
-    pp_out_interconnect = generate_interconnect(n, interconnect_type);
+    x_interconnect = generate_interconnect(n, interconnect_type, clos_params);
+    w_interconnect = generate_interconnect(n, interconnect_type, clos_params);
+    pin_interconnect = generate_interconnect(n, interconnect_type, clos_params);
+    pout_interconnect = generate_interconnect(n, interconnect_type, clos_params);
+    pp_in1_interconnect = generate_interconnect(n, interconnect_type, clos_params);
+    pp_in2_interconnect = generate_interconnect(n, interconnect_type, clos_params);
+    pp_out_interconnect = generate_interconnect(n, interconnect_type, clos_params);
 
     this->N = N;
     this->type = interconnect_type;
+    this->clos = clos_params;
 }
 
 std::istream &operator>>(std::istream &in, InterconnectType &interconnect_type) {
@@ -92,6 +161,9 @@ std::istream &operator>>(std::istream &in, InterconnectType &interconnect_type)
     XYZ(banyan_exp_4)
     XYZ(crossbar)
     XYZ(bus)
+    XYZ(clos)
+    XYZ(clos_rearrangeable)
+    XYZ(clos_strict)
     else {
         in.setstate(std::ios_base::failbit);
     }
@@ -107,6 +179,8 @@ std::ostream &operator<<(std::ostream &out, InterconnectType interconnect_type)
     XYZ(banyan)
     XYZ(crossbar)
     XYZ(bus)
+    XYZ(clos_rearrangeable)
+    XYZ(clos_strict)
 #undef XYZ
     else if ((unsigned) interconnect_type & (unsigned) InterconnectType::banyan) {
         out << "banyan_exp_" << ((unsigned) interconnect_type & 0x0Fu);
@@ -144,3 +218,45 @@ Interconnects::~Interconnects() {
     DELETE(pp_out_interconnect)
 #undef DELETE
 }
+
+InterconnectsSnapshot::InterconnectsSnapshot() {
+    owner_ = nullptr;
+}
+
+void InterconnectsSnapshot::attach(Interconnects *owner) {
+#define REPLICATE(x) \
+    delete replicas_.x; \
+    replicas_.x = owner->x->is_route_check_mutating() ? owner->x->clone() : nullptr;
+    REPLICATE(x_interconnect)
+    REPLICATE(w_interconnect)
+    REPLICATE(pin_interconnect)
+    REPLICATE(pout_interconnect)
+    REPLICATE(pp_in1_interconnect)
+    REPLICATE(pp_in2_interconnect)
+    REPLICATE(pp_out_interconnect)
+#undef REPLICATE
+    owner_ = owner;
+}
+
+InterconnectBase *InterconnectsSnapshot::acquire(InterconnectBase *shared, InterconnectBase *replica) {
+    if (replica == nullptr) {
+        return shared;
+    }
+    if (replica->config_version != shared->config_version) {
+        replica->copy_delta_from(shared);
+    }
+    return replica;
+}
+
+#define ACQUIRE(x) \
+    InterconnectBase *InterconnectsSnapshot::x() { \
+        return acquire(owner_->x, replicas_.x); \
+    }
+ACQUIRE(x_interconnect)
+ACQUIRE(w_interconnect)
+ACQUIRE(pin_interconnect)
+ACQUIRE(pout_interconnect)
+ACQUIRE(pp_in1_interconnect)
+ACQUIRE(pp_in2_interconnect)
+ACQUIRE(pp_out_interconnect)
+#undef ACQUIRE
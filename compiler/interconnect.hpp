@@ -19,13 +19,31 @@ enum class InterconnectType : unsigned {
     banyan_exp_2 = banyan | 2, // 4 Banyan networks
     banyan_exp_3 = banyan | 3, // 8 Banyan networks
     banyan_exp_4 = banyan | 4,  // 16 Banyan networks,
-    bus = 16 << 4
+    bus = 16 << 4,
+    clos = 32 << 4, // three-stage Clos network, see ClosParams
+    // the default number of middle switches and the routing are selected by the variant
+    clos_rearrangeable = clos | 0, // m = n
+    clos_strict = clos | 1 // m = 2n - 1
 };
 
 std::istream &operator>>(std::istream &in, InterconnectType &interconnect_type);
 std::ostream &operator<<(std::ostream &out, InterconnectType interconnect_type);
 
-InterconnectBase *generate_interconnect(UnsignedInt n, InterconnectType type);
+// Shape of a Clos network: r ingress and egress switches of n ports each and
+// m middle switches. A parameter that is 0 is derived from the others and the
+// number of ports: n = 2^floor(log2(ports) / 2), r = ports / n, and m = n for
+// clos_rearrangeable or 2n - 1 for clos_strict.
+struct ClosParams {
+    int m {0};
+    int n {0};
+    int r {0};
+};
+
+// the parameters of a network with 2^n_log2 ports, throws std::invalid_argument
+// unless m >= n and n * r is the number of ports; all 0 for the other types
+ClosParams resolve_clos_params(UnsignedInt n_log2, InterconnectType type, ClosParams params);
+
+InterconnectBase *generate_interconnect(UnsignedInt n, InterconnectType type, ClosParams params = {});
 
 class Interconnects{
     public:
@@ -38,13 +56,16 @@ class Interconnects{
         InterconnectBase * pp_out_interconnect;
         int N;
         InterconnectType type;
+        ClosParams clos;
         
         Interconnects();
         Interconnects(Interconnects const &other);
-        Interconnects(int N, InterconnectType interconnect_type);
+        Interconnects(int N, InterconnectType interconnect_type, ClosParams clos_params = {});
         float tdp(int switch_width);
+        float energy_spent();
+        void reset_activity();
 
-        void construct(int N, InterconnectType interconnect_type);
+        void construct(int N, InterconnectType interconnect_type, ClosParams clos_params = {});
         void copy_from(Interconnects *other);
         Interconnects *clone() const;
 
@@ -54,4 +75,29 @@ class Interconnects{
 
 };
 
+// Read-only view of an Interconnects instance for the placement workers.
+// Networks with non-mutating route checks are shared with the owner. The
+// others are replicated once, and a replica is refreshed with the owner's
+// delta only when it is used after the owner applied a new mapping.
+// The owner must not be modified while the snapshot is in use.
+class InterconnectsSnapshot{
+    public:
+        InterconnectsSnapshot();
+
+        void attach(Interconnects *owner);
+
+        InterconnectBase *x_interconnect();
+        InterconnectBase *w_interconnect();
+        InterconnectBase *pin_interconnect();
+        InterconnectBase *pout_interconnect();
+        InterconnectBase *pp_in1_interconnect();
+        InterconnectBase *pp_in2_interconnect();
+        InterconnectBase *pp_out_interconnect();
+    private:
+        InterconnectBase *acquire(InterconnectBase *shared, InterconnectBase *replica);
+
+        Interconnects *owner_;
+        Interconnects replicas_;
+};
+
 #endif /* INTERCONNECT_HPP */
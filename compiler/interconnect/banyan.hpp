@@ -22,6 +22,9 @@ struct Banyan {
     do_connections_first_last_stages();
     do_connections(n, 0);
 
+    for (auto &interstage : interstages)
+      interstage.update_inverse();
+
     return *this;
   }
 
@@ -57,6 +60,41 @@ struct Banyan {
     return last;
   }
 
+  // Allocation-free propagation: output and scratch (both of size 2^n) are
+  // used as double buffers, and the result ends up in output.
+  template <typename T>
+  void propagate(T const *input, T *output, T *scratch,
+                 T invalid = T(-1)) const {
+    propagate(input, output, scratch, invalid, [](UnsignedInt, T const *) {});
+  }
+
+  // Same as above, visit(k, values) is called with the outputs of stage k.
+  template <typename T, typename Visitor>
+  void propagate(T const *input, T *output, T *scratch, T invalid,
+                 Visitor &&visit) const {
+    const std::size_t num_steps = stages.size() + interstages.size();
+    T *dst = (num_steps % 2) ? output : scratch;
+    T *other = (num_steps % 2) ? scratch : output;
+    T const *src = input;
+
+    auto it = interstages.begin();
+    it->propagate(src, dst);
+    src = dst;
+    std::swap(dst, other);
+    ++it;
+    UnsignedInt k = 0;
+    for (auto const &stage : stages) {
+      stage.propagate(src, dst, invalid);
+      visit(k++, static_cast<T const *>(dst));
+      src = dst;
+      std::swap(dst, other);
+      it->propagate(src, dst);
+      src = dst;
+      std::swap(dst, other);
+      ++it;
+    }
+  }
+
   bool bit_follow(UnsignedInt src_port, UnsignedInt dest_port,
                   bool msb_to_lsb = true, bool set_path = true) {
     auto last = src_port;
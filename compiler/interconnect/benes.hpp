@@ -25,6 +25,9 @@ struct Benes {
     do_connections_half(n, 0);
     do_connections_full();
 
+    for (auto &interstage : interstages)
+      interstage.update_inverse();
+
     return *this;
   }
 
@@ -51,6 +54,39 @@ struct Benes {
     return last;
   }
 
+  // Allocation-free propagation: output and scratch (both of size 2^n) are
+  // used as double buffers, and the result ends up in output.
+  template <typename T>
+  void propagate(T const *input, T *output, T *scratch,
+                 T invalid = T(-1)) const {
+    propagate(input, output, scratch, invalid, [](UnsignedInt, T const *) {});
+  }
+
+  // Same as above, visit(k, values) is called with the outputs of stage k.
+  template <typename T, typename Visitor>
+  void propagate(T const *input, T *output, T *scratch, T invalid,
+                 Visitor &&visit) const {
+    const std::size_t num_steps = stages.size() + interstages.size();
+    T *dst = (num_steps % 2) ? output : scratch;
+    T *other = (num_steps % 2) ? scratch : output;
+    T const *src = input;
+
+    UnsignedInt k = 0;
+    auto it = interstages.begin();
+    for (auto const &stage : stages) {
+      stage.propagate(src, dst, invalid);
+      visit(k++, static_cast<T const *>(dst));
+      src = dst;
+      std::swap(dst, other);
+      if (it != interstages.end()) {
+        it->propagate(src, dst);
+        src = dst;
+        std::swap(dst, other);
+        ++it;
+      }
+    }
+  }
+
   Benes &looping(std::vector<UnsignedInt> const &permutation) {
 #ifndef MIN_NO_SIMPLE_CHECKS
     MIN_REQUIRE(permutation.size() == (1u << n_))
@@ -186,7 +222,10 @@ struct Benes {
   }
 
   void follow_and_set_inputs_srcs() {
-    auto last = std::vector<Int>(1 << n_, 0);
+    // double buffers, reused across the looping trials
+    thread_local std::vector<Int> last, next;
+    last.resize(1 << n_);
+    next.resize(1 << n_);
     for (Int i = 0; i < (1 << n_); ++i)
       last[i] = i;
 
@@ -198,10 +237,12 @@ struct Benes {
         }
       }
 
-      last = stage.propagate(last, -1);
+      stage.propagate(last.data(), next.data(), -1);
+      last.swap(next);
 
       if (it != interstages.end()) {
-        last = it->propagate(last);
+        it->propagate(last.data(), next.data());
+        last.swap(next);
         ++it;
       }
     }
@@ -239,7 +280,8 @@ struct Benes {
   bool looping_multicast(Int const *inverse_mapping, Int k = 16) {
     // randomness
     // it must be the same throughout the same round for routing consistency
-    static std::mt19937_64 mt(
+    // one generator per thread, placement workers do not share it
+    static thread_local std::mt19937_64 mt(
         0
         // std::chrono::high_resolution_clock::now().time_since_epoch().count()
     );
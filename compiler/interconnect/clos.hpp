@@ -0,0 +1,285 @@
+#ifndef CLOS_HPP_INCLUDED
+#define CLOS_HPP_INCLUDED
+
+#include <algorithm>
+#include "multistage_interconnect.hpp"
+
+namespace multistage_interconnect {
+
+// Three-stage Clos network C(m, n, r):
+//  * r ingress switches of size n x m
+//  * m middle switches of size r x r
+//  * r egress switches of size m x n
+// Each link is owned by at most one source, and a source may fan out at
+// any stage (multicast). Port p belongs to ingress/egress switch p / n.
+//  * m >= n: rearrangeably nonblocking for unicast, routing may move
+//    existing connections to other middle switches
+//  * m >= 2n - 1: strict-sense nonblocking for unicast, existing connections
+//    are never moved
+struct Clos {
+  // ingress_links[i * m + k]: source on the link from ingress i to middle k
+  std::vector<Int> ingress_links;
+  // egress_links[k * r + j]: source on the link from middle k to egress j
+  std::vector<Int> egress_links;
+  // egress_selects[dest]: middle switch whose link feeds the output port
+  std::vector<Int> egress_selects;
+
+  explicit Clos(UnsignedInt m = 1, UnsignedInt n = 1, UnsignedInt r = 1,
+                bool rearrangeable = true) {
+    construct(m, n, r, rearrangeable);
+  }
+
+  Clos &construct(UnsignedInt m, UnsignedInt n, UnsignedInt r,
+                  bool rearrangeable) {
+#ifndef MIN_NO_SIMPLE_CHECKS
+    MIN_REQUIRE(m >= 1 && n >= 1 && r >= 1)
+#endif
+    m_ = m;
+    n_ = n;
+    r_ = r;
+    rearrangeable_ = rearrangeable;
+    ingress_links = std::vector<Int>(r * m, -1);
+    egress_links = std::vector<Int>(m * r, -1);
+    egress_selects = std::vector<Int>(n * r, -1);
+    return *this;
+  }
+
+  Clos &reset() {
+    std::fill(ingress_links.begin(), ingress_links.end(), -1);
+    std::fill(egress_links.begin(), egress_links.end(), -1);
+    std::fill(egress_selects.begin(), egress_selects.end(), -1);
+    return *this;
+  }
+
+  // checks whether src can be connected to dest without modifying the network
+  bool is_route_free(UnsignedInt src, UnsignedInt dest) const {
+    const UnsignedInt i = src / n_;
+    const UnsignedInt j = dest / n_;
+    if (find_fanout(j, src) >= 0 || find_middle(i, j, src) >= 0)
+      return true;
+    UnsignedInt a, b;
+    return rearrangeable_ && find_exchange(i, j, src, a, b);
+  }
+
+  // connects src to dest, rearranging the existing connections if allowed
+  bool route(UnsignedInt src, UnsignedInt dest) {
+    const UnsignedInt i = src / n_;
+    const UnsignedInt j = dest / n_;
+
+    // the source already reaches the egress switch, fan out there
+    Int k = find_fanout(j, src);
+    if (k >= 0) {
+      egress_selects[dest] = k;
+      return true;
+    }
+
+    k = find_middle(i, j, src);
+    if (k < 0 && rearrangeable_ && rearrange(i, j, src))
+      k = find_middle(i, j, src);
+    if (k < 0)
+      return false;
+
+    ingress_links[i * m_ + k] = src;
+    egress_links[k * r_ + j] = src;
+    egress_selects[dest] = k;
+    return true;
+  }
+
+  // routes a complete mapping from scratch
+  bool route(Int const *inverse_mapping) {
+    reset();
+    for (UnsignedInt dest = 0; dest < n_ * r_; ++dest) {
+      if (inverse_mapping[dest] == -1)
+        continue;
+      if (!route(inverse_mapping[dest], dest))
+        return false;
+    }
+    return true;
+  }
+
+  // propagates the packets through the three stages
+  // input and output must not overlap
+  template <typename T>
+  void propagate(T const *input, T *output, T invalid = T(-1)) const {
+    propagate(input, output, invalid, [](UnsignedInt, T const *) {});
+  }
+
+  // Same as above, visit(k, values) is called with the outputs of stage k:
+  // r * m ingress links, m * r middle links and n * r output ports
+  template <typename T, typename Visitor>
+  void propagate(T const *input, T *output, T invalid, Visitor &&visit) const {
+    thread_local std::vector<T> ingress_out, middle_out;
+    ingress_out.resize(r_ * m_);
+    middle_out.resize(m_ * r_);
+
+    // ingress switch i forwards its local input port src % n to middle k
+    for (UnsignedInt x = 0; x < r_ * m_; ++x) {
+      const Int src = ingress_links[x];
+      ingress_out[x] = src < 0 ? invalid : input[src];
+    }
+    visit(0, static_cast<T const *>(ingress_out.data()));
+
+    // middle switch k forwards the link from ingress src / n to egress j
+    for (UnsignedInt k = 0; k < m_; ++k) {
+      for (UnsignedInt j = 0; j < r_; ++j) {
+        const Int src = egress_links[k * r_ + j];
+        middle_out[k * r_ + j] =
+            src < 0 ? invalid : ingress_out[(src / n_) * m_ + k];
+      }
+    }
+    visit(1, static_cast<T const *>(middle_out.data()));
+
+    // egress switch dest / n forwards one of its middle links
+    for (UnsignedInt dest = 0; dest < n_ * r_; ++dest) {
+      const Int k = egress_selects[dest];
+      output[dest] = k < 0 ? invalid : middle_out[k * r_ + dest / n_];
+    }
+    visit(2, static_cast<T const *>(output));
+  }
+
+  UnsignedInt num_crosspoints() const {
+    return 2 * r_ * n_ * m_ + m_ * r_ * r_;
+  }
+
+  UnsignedInt m() const { return m_; }
+  UnsignedInt n() const { return n_; }
+  UnsignedInt r() const { return r_; }
+  bool rearrangeable() const { return rearrangeable_; }
+
+private:
+  UnsignedInt m_, n_, r_;
+  bool rearrangeable_;
+
+  // middle switch that already carries src to egress j
+  Int find_fanout(UnsignedInt j, UnsignedInt src) const {
+    for (UnsignedInt k = 0; k < m_; ++k) {
+      if (egress_links[k * r_ + j] == (Int)src)
+        return k;
+    }
+    return -1;
+  }
+
+  bool is_ingress_free(UnsignedInt i, UnsignedInt k, UnsignedInt src) const {
+    const Int x = ingress_links[i * m_ + k];
+    return x == -1 || x == (Int)src;
+  }
+
+  bool is_egress_free(UnsignedInt k, UnsignedInt j) const {
+    return egress_links[k * r_ + j] == -1;
+  }
+
+  // a middle switch with free links to both sides, the ones that src already
+  // uses at its ingress switch are preferred
+  Int find_middle(UnsignedInt i, UnsignedInt j, UnsignedInt src) const {
+    Int found = -1;
+    for (UnsignedInt k = 0; k < m_; ++k) {
+      if (!is_egress_free(k, j) || !is_ingress_free(i, k, src))
+        continue;
+      if (ingress_links[i * m_ + k] == (Int)src)
+        return k;
+      if (found < 0)
+        found = k;
+    }
+    return found;
+  }
+
+  // Marks the ingress and egress switches of the component of egress j0 in
+  // the subgraph of the links that use middle switch a or b
+  void find_component(UnsignedInt a, UnsignedInt b, UnsignedInt j0,
+                      std::vector<int> &ingress_seen,
+                      std::vector<int> &egress_seen) const {
+    thread_local std::vector<UnsignedInt> ingress_queue, egress_queue;
+    ingress_seen.assign(r_, false);
+    egress_seen.assign(r_, false);
+    ingress_queue.clear();
+    egress_queue.assign(1, j0);
+    egress_seen[j0] = true;
+
+    while (!ingress_queue.empty() || !egress_queue.empty()) {
+      if (!egress_queue.empty()) {
+        const UnsignedInt j = egress_queue.back();
+        egress_queue.pop_back();
+        for (auto k : {a, b}) {
+          const Int src = egress_links[k * r_ + j];
+          if (src >= 0 && !ingress_seen[src / n_]) {
+            ingress_seen[src / n_] = true;
+            ingress_queue.push_back(src / n_);
+          }
+        }
+      } else {
+        const UnsignedInt i = ingress_queue.back();
+        ingress_queue.pop_back();
+        for (auto k : {a, b}) {
+          const Int src = ingress_links[i * m_ + k];
+          if (src < 0)
+            continue;
+          for (UnsignedInt j = 0; j < r_; ++j) {
+            if (egress_links[k * r_ + j] == src && !egress_seen[j]) {
+              egress_seen[j] = true;
+              egress_queue.push_back(j);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // Kempe chain exchange: swaps middle switches a and b for every connection
+  // in the component of egress j0 in the subgraph of links using a or b
+  void swap_middles(UnsignedInt a, UnsignedInt b, UnsignedInt j0) {
+    thread_local std::vector<int> ingress_seen, egress_seen;
+    find_component(a, b, j0, ingress_seen, egress_seen);
+
+    for (UnsignedInt i = 0; i < r_; ++i) {
+      if (ingress_seen[i])
+        std::swap(ingress_links[i * m_ + a], ingress_links[i * m_ + b]);
+    }
+    for (UnsignedInt j = 0; j < r_; ++j) {
+      if (!egress_seen[j])
+        continue;
+      std::swap(egress_links[a * r_ + j], egress_links[b * r_ + j]);
+      for (UnsignedInt dest = j * n_; dest < (j + 1) * n_; ++dest) {
+        if (egress_selects[dest] == (Int)a)
+          egress_selects[dest] = b;
+        else if (egress_selects[dest] == (Int)b)
+          egress_selects[dest] = a;
+      }
+    }
+  }
+
+  // Finds the first middle switches a and b whose exchange in the component
+  // of egress j makes a available for src between ingress i and egress j.
+  // The exchange moves the link from b to egress j, which is free, onto a,
+  // and swaps the ingress links of a and b only if ingress i is in the
+  // component, so the result is read from the current occupancy.
+  bool find_exchange(UnsignedInt i, UnsignedInt j, UnsignedInt src,
+                     UnsignedInt &a, UnsignedInt &b) const {
+    thread_local std::vector<int> ingress_seen, egress_seen;
+    for (a = 0; a < m_; ++a) {
+      if (!is_ingress_free(i, a, src))
+        continue;
+      for (b = 0; b < m_; ++b) {
+        if (b == a || !is_egress_free(b, j))
+          continue;
+        find_component(a, b, j, ingress_seen, egress_seen);
+        if (!ingress_seen[i] || is_ingress_free(i, b, src))
+          return true;
+      }
+    }
+    return false;
+  }
+
+  // moves existing connections so that a middle switch becomes available
+  // for src between ingress i and egress j
+  bool rearrange(UnsignedInt i, UnsignedInt j, UnsignedInt src) {
+    UnsignedInt a, b;
+    if (!find_exchange(i, j, src, a, b))
+      return false;
+    swap_middles(a, b, j);
+    return true;
+  }
+};
+
+} // namespace multistage_interconnect
+
+#endif // CLOS_HPP_INCLUDED
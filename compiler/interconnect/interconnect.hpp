@@ -3,8 +3,11 @@
 
 #include "banyan.hpp"
 #include "benes.hpp"
+#include "clos.hpp"
+#include <algorithm>
 #include <cassert>
 #include <map>
+#include <memory>
 #include <boost/log/trivial.hpp>
 #include <sstream>
 #include <cmath>
@@ -18,26 +21,138 @@ using multistage_interconnect::UnsignedInt;
 template <typename Interconnect>
 inline void propagate_impl(Interconnect &interconnect, Int const *packets,
                            Int *output, Int invalid) {
-  auto N = 1 << interconnect.n();
-  std::vector<Int> packets_vector(packets, packets + N);
-  auto &&propagated = interconnect.propagate(packets_vector, invalid);
-  for (UnsignedInt i = 0; i < (UnsignedInt) N; ++i) {
-    output[i] = propagated[i];
+  // second buffer of the double-buffered propagation, reused across calls
+  thread_local std::vector<Int> scratch;
+  scratch.resize(1ul << interconnect.n());
+  interconnect.propagate(packets, output, scratch.data(), invalid);
+}
+
+// The id of every one of the N source ports as its packet, pushed through a
+// configured network to find the source that reaches each link. output is
+// resized to N for the result.
+inline Int const *source_packets(UnsignedInt N, std::vector<Int> &output) {
+  thread_local std::vector<Int> packets;
+  if (packets.size() != N) {
+    packets.resize(N);
+    for (UnsignedInt i = 0; i < N; ++i) {
+      packets[i] = i;
+    }
+  }
+  output.resize(N);
+  return packets.data();
+}
+
+// whether each destination of the inverse mapping received its source; with
+// an expansion, logical output i is found at physical output i << expansion
+inline bool delivers(Int const *output, Int const *inverse_mapping,
+                     UnsignedInt N, UnsignedInt expansion = 0) {
+  for (UnsignedInt i = 0; i < (N >> expansion); ++i) {
+    if (inverse_mapping[i] != -1 && output[i << expansion] != inverse_mapping[i])
+      return false;
   }
+  return true;
+}
+
+// Pushes every source port's id through the configured network in one pass
+// and checks that each destination of the inverse mapping receives its source.
+template <typename Interconnect>
+inline bool verify_round_impl(Interconnect &interconnect,
+                              Int const *inverse_mapping,
+                              UnsignedInt expansion = 0) {
+  const UnsignedInt N = 1ul << interconnect.n();
+  thread_local std::vector<Int> output;
+  Int const *packets = source_packets(N, output);
+  propagate_impl(interconnect, packets, output.data(), -1);
+  return delivers(output.data(), inverse_mapping, N, expansion);
+}
+
+// Pushes every source port's id through the configured network and adds the
+// bytes of the source to each stage output that carries it.
+template <typename Interconnect>
+inline void stage_activity_impl(Interconnect &interconnect,
+                                long const *src_bytes, double *stage_bytes) {
+  const UnsignedInt N = 1ul << interconnect.n();
+  thread_local std::vector<Int> output, scratch;
+  Int const *packets = source_packets(N, output);
+  scratch.resize(N);
+
+  interconnect.propagate(packets, output.data(), scratch.data(), -1,
+                         [&](UnsignedInt k, Int const *values) {
+                           for (UnsignedInt i = 0; i < N; ++i) {
+                             if (values[i] != -1)
+                               stage_bytes[k] += src_bytes[values[i]];
+                           }
+                         });
 }
 
 struct InterconnectBase {
+  // incremented whenever a new mapping is applied
+  UnsignedInt config_version = 0;
+
+  // switch activity recorded by the cycle model
+  float energy_spent = 0; // J
+  std::vector<double> stage_bytes; // bytes that left each stage
+  UnsignedInt no_deliveries = 0; // destinations served, over all rounds
+  UnsignedInt no_sources = 0; // distinct sources per round, over all rounds
+  UnsignedInt max_fanout = 0;
+
+  // activity of the last round recorded, added again without routing while
+  // the mapping, the bytes and the configuration do not change
+  std::vector<Int> activity_mapping;
+  std::vector<long> activity_src_bytes;
+  std::vector<double> activity_round_bytes;
+  UnsignedInt activity_deliveries = 0;
+  UnsignedInt activity_sources = 0;
+  UnsignedInt activity_version = 0;
+
+  // A private copy of the network that verify_round and the cycle model
+  // configure, so that the compiled state is left alone. Copies of the interconnect make their
+  // own scratch network on first use.
+  struct Scratch {
+    std::unique_ptr<InterconnectBase> network;
+    bool synced = false;
+    UnsignedInt version = 0; // config_version the network was copied at
+
+    Scratch() = default;
+    Scratch(Scratch const &) {}
+    Scratch &operator=(Scratch const &) {
+      network.reset();
+      synced = false;
+      return *this;
+    }
+  };
+  Scratch scratch_;
+
   virtual float power(int switch_width) const = 0;
   virtual UnsignedInt num_ports() const = 0;
   virtual UnsignedInt latency() const = 0;
   virtual const char *name() const = 0;
-  virtual void reset() = 0;
+  virtual void do_reset() = 0;
+  // packets and output must not overlap
   virtual void propagate(Int const *packets, Int *output,
                          Int invalid) const = 0;
   virtual bool do_apply_permute(Int const *inverse_mapping) = 0;
   virtual bool do_is_route_free(UnsignedInt src, UnsignedInt dest) = 0;
   virtual void copy_from(InterconnectBase *other) = 0;
   virtual InterconnectBase *clone() const = 0;
+
+  // whether do_is_route_free uses the network as scratch space
+  // such networks cannot be shared among threads
+  virtual bool is_route_check_mutating() const {
+    return false;
+  }
+
+  // whether do_apply_permute routes on top of the previously applied mapping
+  // otherwise the state after it depends only on the given mapping
+  virtual bool is_apply_incremental() const {
+    return false;
+  }
+
+  // copies only the state that can change after construction
+  // other must have the same type and size
+  virtual void copy_delta_from(InterconnectBase *other) {
+    copy_from(other);
+  }
   virtual ~InterconnectBase() = default;
 
   virtual UnsignedInt data_req_latency() const {
@@ -56,6 +171,131 @@ struct InterconnectBase {
     return data_req_latency() + data_read_latency();
   }
 
+  // checks the current configuration against the mapping that was applied
+  // networks without a switch-level model have nothing to verify
+  virtual bool do_verify_round(Int const *) const {
+    return true;
+  }
+
+  virtual UnsignedInt num_stages() const {
+    return latency();
+  }
+
+  // links of a stage that can carry data in the same cycle
+  virtual UnsignedInt stage_width() const {
+    return num_ports();
+  }
+
+  // Adds the bytes leaving each stage when src_bytes[src] bytes are sent from
+  // every source of the mapping. Without a switch-level model every stage is
+  // assumed to carry one copy per destination.
+  virtual void do_stage_activity(Int const *inverse_mapping,
+                                 long const *src_bytes,
+                                 double *stage_bytes) const {
+    double total = 0;
+    for (UnsignedInt i = 0; i < num_ports(); ++i) {
+      if (inverse_mapping[i] != -1)
+        total += src_bytes[inverse_mapping[i]];
+    }
+    for (UnsignedInt k = 0; k < num_stages(); ++k) {
+      stage_bytes[k] += total;
+    }
+  }
+
+  // a byte crossing one stage, scaled so that a network busy on every link of
+  // every stage dissipates power(switch_width)
+  float energy_per_byte_stage(float freq) const {
+    return power(1) / (stage_width() * num_stages()) / freq;
+  }
+
+  float avg_fanout() const {
+    return no_sources ? (float) no_deliveries / no_sources : 0;
+  }
+
+  // the scratch network, copied from this one if it changed since
+  InterconnectBase &scratch() {
+    if (!scratch_.network)
+      scratch_.network.reset(clone());
+    else if (!scratch_.synced || scratch_.version != config_version)
+      scratch_.network->copy_delta_from(this);
+    scratch_.synced = true;
+    scratch_.version = config_version;
+    return *scratch_.network;
+  }
+
+  // clears the activity recorded by the cycle model
+  void reset_activity() {
+    energy_spent = 0;
+    stage_bytes.clear();
+    no_deliveries = 0;
+    no_sources = 0;
+    max_fanout = 0;
+    activity_mapping.clear();
+    activity_src_bytes.clear();
+    scratch_.synced = false;
+  }
+
+  // Configures the scratch network for one round of the cycle model and
+  // accumulates the bytes crossing its stages, the fan-out of its sources and
+  // the resulting dynamic energy. src_bytes is indexed by source port. A round
+  // with the same mapping and bytes as the previous one is not routed again.
+  void record_activity(Int const *inverse_mapping, long const *src_bytes,
+                       float freq) {
+    const UnsignedInt N = num_ports();
+    bool repeated = activity_version == config_version &&
+                    activity_mapping.size() == N &&
+                    std::equal(inverse_mapping, inverse_mapping + N,
+                               activity_mapping.begin()) &&
+                    std::equal(src_bytes, src_bytes + N,
+                               activity_src_bytes.begin());
+
+    if (!repeated) {
+      InterconnectBase &network = scratch();
+      auto routed = network.do_apply_permute(inverse_mapping);
+
+      activity_round_bytes.assign(num_stages(), 0);
+      if (routed)
+        network.do_stage_activity(inverse_mapping, src_bytes,
+                                  activity_round_bytes.data());
+      else
+        InterconnectBase::do_stage_activity(inverse_mapping, src_bytes,
+                                            activity_round_bytes.data());
+
+      thread_local std::vector<UnsignedInt> fanout;
+      fanout.assign(N, 0);
+      activity_deliveries = 0;
+      activity_sources = 0;
+      for (UnsignedInt i = 0; i < N; ++i) {
+        if (inverse_mapping[i] == -1)
+          continue;
+        ++activity_deliveries;
+        if (fanout[inverse_mapping[i]]++ == 0)
+          ++activity_sources;
+        max_fanout = std::max(max_fanout, fanout[inverse_mapping[i]]);
+      }
+
+      activity_mapping.assign(inverse_mapping, inverse_mapping + N);
+      activity_src_bytes.assign(src_bytes, src_bytes + N);
+      activity_version = config_version;
+    }
+
+    stage_bytes.resize(num_stages(), 0);
+    double total = 0;
+    for (UnsignedInt k = 0; k < num_stages(); ++k) {
+      stage_bytes[k] += activity_round_bytes[k];
+      total += activity_round_bytes[k];
+    }
+    energy_spent += energy_per_byte_stage(freq) * total;
+    no_deliveries += activity_deliveries;
+    no_sources += activity_sources;
+  }
+
+  // clears the routing state, replicas of the network are refreshed on next use
+  void reset() {
+    do_reset();
+    ++config_version;
+  }
+
   template <typename BankType, typename TargetType>
   bool apply_permute(std::map<BankType *, TargetType *> *permute) {
     std::vector<Int> v(num_ports(), -1);
@@ -63,6 +303,7 @@ struct InterconnectBase {
       v[it->first->id] = it->second->id;
     }
     auto result = do_apply_permute(&v[0]);
+    ++config_version;
     #ifdef INTERCONNECT_LOGS
     BOOST_LOG_TRIVIAL(info) <<
       "apply_permute: this = " << this <<
@@ -76,6 +317,23 @@ struct InterconnectBase {
     return result;
   }
 
+  // Configures the scratch network for all the packets of a round and pushes
+  // them through it in one pass, the network itself is left as it is.
+  // Returns false if the mapping cannot be routed or the configured switches
+  // do not deliver it.
+  template <typename BankType, typename TargetType>
+  bool verify_round(std::map<BankType *, TargetType *> *permute) {
+    std::vector<Int> v(num_ports(), -1);
+    for (auto it = cbegin(*permute); it != cend(*permute); ++it) {
+      v[it->first->id] = it->second->id;
+    }
+    InterconnectBase &network = scratch();
+    auto verified = network.do_apply_permute(&v[0]) && network.do_verify_round(&v[0]);
+    // the cycle model starts from the compiled state
+    scratch_.synced = false;
+    return verified;
+  }
+
   template <typename BankType, typename TargetType>
   bool is_route_free(BankType *bank, TargetType * target) {
     auto result = do_is_route_free(bank->id, target->id);
@@ -97,7 +355,6 @@ struct Benes : InterconnectBase {
     ALGO_LOOPING_MULTICAST = 2
   };
 
-  float energy_spent = 0;
   multistage_interconnect::Benes impl;
   std::vector<Int> current_inverse_mapping;
   Algo algorithm = ALGO_LOOPING_MULTICAST;
@@ -123,7 +380,7 @@ struct Benes : InterconnectBase {
     return "benes";
   }
 
-  void reset() override {
+  void do_reset() override {
     impl.reset();
     for (auto &x : current_inverse_mapping)
       x = -1;
@@ -133,6 +390,15 @@ struct Benes : InterconnectBase {
     propagate_impl(impl, packets, output, invalid);
   }
 
+  bool do_verify_round(Int const *inverse_mapping) const override {
+    return verify_round_impl(impl, inverse_mapping);
+  }
+
+  void do_stage_activity(Int const *, long const *src_bytes,
+                         double *stage_bytes) const override {
+    stage_activity_impl(impl, src_bytes, stage_bytes);
+  }
+
   void set_algorithm(Algo algorithm) { this->algorithm = algorithm; }
 
   void set_trials(UnsignedInt trials) { this->trials = trials; }
@@ -189,13 +455,27 @@ struct Benes : InterconnectBase {
     }
   }
 
+  bool is_route_check_mutating() const override {
+    return true;
+  }
+
+  // impl is rerouted from scratch on every check, only the mapping matters
+  void copy_delta_from(InterconnectBase *other) override {
+    auto benes = (Benes *) other;
+    if (this != benes) {
+      current_inverse_mapping = benes->current_inverse_mapping;
+      algorithm = benes->algorithm;
+      trials = benes->trials;
+      config_version = benes->config_version;
+    }
+  }
+
   Benes *clone() const override { return new Benes(*this); }
 };
 
 struct BenesWithCopy : InterconnectBase {
   BenesWithCopy(UnsignedInt n) : n_{n} {}
 
-  float energy_spent = 0;
 
   float power(int switch_width) const override {
     float I_0 = 2.875e-5; //W per byte
@@ -213,7 +493,7 @@ struct BenesWithCopy : InterconnectBase {
 
   UnsignedInt num_ports() const override { return 1 << n_; }
 
-  void reset() override {}
+  void do_reset() override {}
 
   void propagate(Int const *, Int *, Int) const override {}
 
@@ -241,7 +521,6 @@ struct Bus : InterconnectBase {
 
   std::vector<Int> current_inverse_mapping;
 
-  float energy_spent = 0;
 
   float power(int switch_width) const override {
     float I_0 = 2.875e-5; //W per byte
@@ -256,7 +535,22 @@ struct Bus : InterconnectBase {
 
   UnsignedInt num_ports() const override { return 1 << n_; }
 
-  void reset() override {
+  UnsignedInt stage_width() const override { return 1; }
+
+  // a source is broadcast once to all of its destinations
+  void do_stage_activity(Int const *inverse_mapping, long const *src_bytes,
+                         double *stage_bytes) const override {
+    thread_local std::vector<bool> sent;
+    sent.assign(num_ports(), false);
+    for (UnsignedInt i = 0; i < num_ports(); ++i) {
+      if (inverse_mapping[i] == -1 || sent[inverse_mapping[i]])
+        continue;
+      sent[inverse_mapping[i]] = true;
+      stage_bytes[0] += src_bytes[inverse_mapping[i]];
+    }
+  }
+
+  void do_reset() override {
     for (auto &x : current_inverse_mapping)
       x = -1;
   }
@@ -310,7 +604,6 @@ struct Bus : InterconnectBase {
 struct Crossbar : InterconnectBase {
   Crossbar(UnsignedInt n) : n_{n} {}
 
-  float energy_spent = 0;
 
   float power(int switch_width) const override {
     float I_0 = 2.875e-5; //W per byte
@@ -328,7 +621,7 @@ struct Crossbar : InterconnectBase {
 
   UnsignedInt num_ports() const override { return 1 << n_; }
 
-  void reset() override {}
+  void do_reset() override {}
 
   void propagate(Int const *, Int *, Int) const override {}
 
@@ -359,7 +652,6 @@ struct Banyan : InterconnectBase {
 
   Banyan(UnsignedInt n) : impl{n}, current_inverse_mapping(1 << n, -1) {}
 
-  float energy_spent = 0;
   
   float power(int switch_width) const override {
     float I_0 = 2.875e-5; //W per byte
@@ -379,7 +671,7 @@ struct Banyan : InterconnectBase {
     return current_inverse_mapping.size();
   }
 
-  void reset() override {
+  void do_reset() override {
     impl.reset();
     for (auto &x : current_inverse_mapping)
       x = -1;
@@ -389,6 +681,18 @@ struct Banyan : InterconnectBase {
     propagate_impl(impl, packets, output, invalid);
   }
 
+  bool do_verify_round(Int const *inverse_mapping) const override {
+    return verify_round_impl(impl, inverse_mapping, expansion);
+  }
+
+  // impl already includes the stages of the expansion
+  UnsignedInt num_stages() const override { return impl.n(); }
+
+  void do_stage_activity(Int const *, long const *src_bytes,
+                         double *stage_bytes) const override {
+    stage_activity_impl(impl, src_bytes, stage_bytes);
+  }
+
   void set_expansion(UnsignedInt expansion) { this->expansion = expansion; }
 
   // TODO most probably, we can do it in a faster way without
@@ -422,4 +726,115 @@ struct Banyan : InterconnectBase {
   Banyan *clone() const override { return new Banyan(*this); }
 };
 
+struct Clos : InterconnectBase {
+  multistage_interconnect::Clos impl;
+  std::vector<Int> current_inverse_mapping;
+
+  Clos(UnsignedInt m, UnsignedInt n, UnsignedInt r, bool rearrangeable)
+      : impl{m, n, r, rearrangeable}, current_inverse_mapping(n * r, -1) {}
+
+
+  float power(int switch_width) const override {
+    float I_0 = 2.875e-5; //W per byte
+
+    return I_0 * impl.num_crosspoints() * switch_width;
+  }
+
+  // ingress, middle and egress switches
+  UnsignedInt latency() const override { return 3; }
+
+  const char *name() const override {
+    return "clos";
+  }
+
+  UnsignedInt num_ports() const override {
+    return current_inverse_mapping.size();
+  }
+
+  void do_reset() override {
+    impl.reset();
+    for (auto &x : current_inverse_mapping)
+      x = -1;
+  }
+
+  void propagate(Int const *packets, Int *output, Int invalid) const override {
+    impl.propagate(packets, output, invalid);
+  }
+
+  bool do_verify_round(Int const *inverse_mapping) const override {
+    const UnsignedInt N = num_ports();
+    thread_local std::vector<Int> output;
+    Int const *packets = source_packets(N, output);
+    impl.propagate(packets, output.data(), -1);
+    return delivers(output.data(), inverse_mapping, N);
+  }
+
+  void do_stage_activity(Int const *, long const *src_bytes,
+                         double *stage_bytes) const override {
+    const UnsignedInt N = num_ports();
+    thread_local std::vector<Int> output;
+    Int const *packets = source_packets(N, output);
+
+    impl.propagate(packets, output.data(), -1,
+                   [&](UnsignedInt k, Int const *values) {
+                     const UnsignedInt size = k == 2 ? N : impl.m() * impl.r();
+                     for (UnsignedInt i = 0; i < size; ++i) {
+                       if (values[i] != -1)
+                         stage_bytes[k] += src_bytes[values[i]];
+                     }
+                   });
+  }
+
+  // A mapping that only adds destinations to the current one is routed on top
+  // of the current switch states, like is_route_free does. Anything else is
+  // routed from scratch.
+  bool do_apply_permute(Int const *inverse_mapping) override {
+    bool extends = true;
+    for (UnsignedInt i = 0; i < current_inverse_mapping.size(); ++i) {
+      if (current_inverse_mapping[i] != -1 &&
+          current_inverse_mapping[i] != inverse_mapping[i]) {
+        extends = false;
+        break;
+      }
+    }
+
+    if (!extends) {
+      for (UnsignedInt i = 0; i < current_inverse_mapping.size(); ++i) {
+        current_inverse_mapping[i] = inverse_mapping[i];
+      }
+      return impl.route(&current_inverse_mapping[0]);
+    }
+
+    bool result = true;
+    for (UnsignedInt i = 0; i < current_inverse_mapping.size(); ++i) {
+      if (current_inverse_mapping[i] != -1 || inverse_mapping[i] == -1)
+        continue;
+      current_inverse_mapping[i] = inverse_mapping[i];
+      result = impl.route(inverse_mapping[i], i) && result;
+    }
+    return result;
+  }
+
+  bool is_apply_incremental() const override {
+    return true;
+  }
+
+  // checks against the switch states of the applied mapping, for the
+  // rearrangeable variant including the connections that could be moved
+  bool do_is_route_free(UnsignedInt src, UnsignedInt dest) override {
+    if (current_inverse_mapping[dest] != -1)
+      return false;
+
+    return impl.is_route_free(src, dest);
+  }
+
+  void copy_from(InterconnectBase *other) override {
+    if (this != (Clos *) other) {
+      *this = *((Clos *) other);
+    }
+  }
+
+  Clos *clone() const override { return new Clos(*this); }
+};
+
 #endif // ENTRY_HPP_INCLUDED
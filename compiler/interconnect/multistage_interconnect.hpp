@@ -4,8 +4,14 @@
 #include "defs.hpp"
 #include "exception.hpp"
 #include "utility.hpp"
+#include <cstdint>
+#include <type_traits>
 #include <vector>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 namespace multistage_interconnect {
 
 struct SwitchState {
@@ -87,7 +93,21 @@ struct FixedPermutation {
   // to?
   std::vector<UnsignedInt> mapping;
 
-  explicit FixedPermutation(UnsignedInt N = 0) : mapping(N, 0) {}
+  // gather form of the mapping, inverse_mapping[output] = input
+  // kept as 32-bit indices so that it can be fed to vector gathers
+  // call update_inverse() after modifying the mapping
+  std::vector<std::int32_t> inverse_mapping;
+
+  explicit FixedPermutation(UnsignedInt N = 0)
+      : mapping(N, 0), inverse_mapping(N, 0) {}
+
+  FixedPermutation &update_inverse() {
+    inverse_mapping.resize(mapping.size());
+    for (std::size_t i = 0; i < mapping.size(); ++i) {
+      inverse_mapping[mapping[i]] = i;
+    }
+    return *this;
+  }
 
   template <typename T>
   std::vector<T> propagate(std::vector<T> const &input) const {
@@ -105,10 +125,33 @@ struct FixedPermutation {
     return result;
   }
 
+  // allocation-free version, input and output must not overlap
+  template <typename T> void propagate(T const *input, T *output) const {
+    const std::size_t N = mapping.size();
+    std::size_t i = 0;
+
+#if defined(__AVX2__)
+    if constexpr (sizeof(T) == 4 && std::is_integral_v<T>) {
+      for (; i + 8 <= N; i += 8) {
+        const __m256i idx = _mm256_loadu_si256(
+            reinterpret_cast<__m256i const *>(&inverse_mapping[i]));
+        const __m256i v = _mm256_i32gather_epi32(
+            reinterpret_cast<int const *>(input), idx, 4);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(&output[i]), v);
+      }
+    }
+#endif
+
+    for (; i < N; ++i) {
+      output[i] = input[inverse_mapping[i]];
+    }
+  }
+
   [[nodiscard]] FixedPermutation inversed() const {
     FixedPermutation result(mapping.size());
     utility::inverse_permutation(&mapping[0], &result.mapping[0],
                                  mapping.size());
+    result.update_inverse();
     return result;
   }
 
@@ -154,6 +197,18 @@ struct Stage {
 
     return result;
   }
+
+  // allocation-free version, input and output must not overlap
+  // unconnected outputs are set without branching on the switch state
+  template <typename T>
+  void propagate(T const *input, T *output, T invalid = T(-1)) const {
+    const std::size_t N = switch_states.size() << 1;
+    for (std::size_t i = 0; i < N; ++i) {
+      const Int sel = switch_states[i >> 1].outputs[i & 1];
+      const T v = input[(i & ~std::size_t(1)) + (sel & 1)];
+      output[i] = sel < 0 ? invalid : v;
+    }
+  }
 };
 
 } // namespace multistage_interconnect
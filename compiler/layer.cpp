@@ -1,11 +1,12 @@
 
 #include "layer.hpp"
+#include "profile.hpp"
 
 using namespace std;
 
 Layer::Layer(string layer_name, 
-                tile_dim_map* x_tile_dims, 
-                tile_dim_map* w_tile_dims, 
+                TileDims x_tile_dims, 
+                TileDims w_tile_dims, 
                 tuple<int, int, int> no_tiles, 
                 tuple<int, int> input_size, 
                 tuple<int, int> weight_size,
@@ -131,42 +132,113 @@ Layer Layer::create_copy(string suffix){
     return new_layer;
 }
 
-Layer::~Layer(){}
+Layer::Layer(Layer&& other){
+    this->layer_name = std::move(other.layer_name);
+    this->x_tile_dims = other.x_tile_dims;
+    this->w_tile_dims = other.w_tile_dims;
+    this->no_tiles = other.no_tiles;
+    this->input_size = other.input_size;
+    this->weight_size = other.weight_size;
+    this->no_gemm_ops = other.no_gemm_ops;
+    this->raw_input = other.raw_input;
+    this->is_conv = other.is_conv;
+    this->conv_kernel_size = other.conv_kernel_size;
+    this->is_scheduled = other.is_scheduled;
+    this->start_round = other.start_round;
+    this->end_round = other.end_round;
+
+    this->x_tiles = other.x_tiles;
+    this->w_tiles = other.w_tiles;
+    this->p_tiles = other.p_tiles;
+    this->dependencies = other.dependencies;
+    this->main_ops = std::move(other.main_ops);
+    this->post_ops = std::move(other.post_ops);
+
+    other.x_tiles = nullptr;
+    other.w_tiles = nullptr;
+    other.p_tiles = nullptr;
+    other.dependencies = nullptr;
+    other.main_ops.clear();
+    other.post_ops.clear();
+}
+
+Layer::~Layer(){
+    for (auto it = this->post_ops.begin(); it != this->post_ops.end(); it++){
+        for (AggrOp* op: it->second){
+            // the pair of an aggregation shares its output tile
+            if (!op->flip) delete op->pout_tile;
+            delete op;
+        }
+    }
+    for (auto it = this->main_ops.begin(); it != this->main_ops.end(); it++){
+        delete it->second;
+    }
+
+    if (this->x_tiles != nullptr){
+        for (auto it = this->x_tiles->begin(); it != this->x_tiles->end(); it++) delete it->second;
+        delete this->x_tiles;
+    }
+    if (this->w_tiles != nullptr){
+        for (auto it = this->w_tiles->begin(); it != this->w_tiles->end(); it++) delete it->second;
+        delete this->w_tiles;
+    }
+    if (this->p_tiles != nullptr){
+        for (auto it = this->p_tiles->begin(); it != this->p_tiles->end(); it++) delete it->second;
+        delete this->p_tiles;
+    }
+    delete this->dependencies;
+}
 
-void Model::import_layers(json j){
-    for (json::iterator it = j["order"].begin(); it != j["order"].end(); ++it) {
-        string layer_name = it.value();
-        auto deps = j["layers"][layer_name]["deps"];
-        auto gemm_op = j["layers"][layer_name]["gemm_op"];
+void Layer::tile(tuple<int, int, int> tile_size){
+    auto ceil_div = [](int a, int b){ return (a + b - 1) / b; };
+    this->no_tiles = make_tuple(ceil_div(get<0>(this->input_size), get<0>(tile_size)),
+                                ceil_div(get<0>(this->weight_size), get<1>(tile_size)),
+                                ceil_div(get<1>(this->weight_size), get<2>(tile_size)));
+    uniform_gemm_tiling(this->input_size, this->weight_size, tile_size, this->x_tile_dims, this->w_tile_dims);
+}
 
-        tile_dim_map* x_tile_dim = new tile_dim_map();
-        tile_dim_map* w_tile_dim = new tile_dim_map();
+void Model::import_layers(json const& j){
+    for (auto it = j.at("order").begin(); it != j.at("order").end(); ++it) {
+        string layer_name = it->get<string>();
+        json const& jl = j.at("layers").at(layer_name);
+        json const& deps = jl.at("deps");
+        json const& gemm_op = jl.at("gemm_op");
+
+        TileDims x_tile_dim;
+        TileDims w_tile_dim;
         tuple<int, int, int> no_tiles = make_tuple(0,0,0);
         tuple<int, int> input_size = make_tuple(0,0);
         tuple<int, int> weight_size = make_tuple(0,0);
 
         if (!gemm_op.is_null()){
-            auto val = gemm_op["x_tile_dim"];
-            for (json::iterator it2 = val.begin(); it2 != val.end(); it2++){
-                auto key_ind1 = it2.key();
-                for (json::iterator it3 = val[key_ind1].begin(); it3 != val[key_ind1].end(); it3++){
-                    auto key_ind2 = it3.key();
-                    (*x_tile_dim)[make_tuple(stoi(key_ind1), stoi(key_ind2))] = make_tuple(val[key_ind1][key_ind2][0].get<int>(), val[key_ind1][key_ind2][1].get<int>());
-                }
+            input_size = make_tuple(gemm_op.at("input_size")[0].get<int>(), gemm_op.at("input_size")[1].get<int>());
+            weight_size = make_tuple(gemm_op.at("weight_size")[0].get<int>(), gemm_op.at("weight_size")[1].get<int>());
+
+            // an untiled model has only the GEMM shape, the compiler tiles the layer for its arrays
+            if (gemm_op.contains("no_tiles")){
+                no_tiles = make_tuple(gemm_op.at("no_tiles")[0].get<int>(), gemm_op.at("no_tiles")[1].get<int>(), gemm_op.at("no_tiles")[2].get<int>());
             }
 
-            val = gemm_op["w_tile_dim"];
-            for (json::iterator it2 = val.begin(); it2 != val.end(); it2++){
-                auto key_ind1 = it2.key();
-                for (json::iterator it3 = val[key_ind1].begin(); it3 != val[key_ind1].end(); it3++){
-                    auto key_ind2 = it3.key();
-                    (*w_tile_dim)[make_tuple(stoi(key_ind1), stoi(key_ind2))] = make_tuple(val[key_ind1][key_ind2][0].get<int>(), val[key_ind1][key_ind2][1].get<int>());
-                }
+            if (gemm_op.contains("tile_size")){
+                auto const& tile_size = gemm_op["tile_size"];
+                uniform_gemm_tiling(input_size, weight_size, make_tuple(tile_size.at(0).get<int>(), tile_size.at(1).get<int>(), tile_size.at(2).get<int>()), x_tile_dim, w_tile_dim);
             }
+            else if (gemm_op.contains("x_tile_dim")){
+                // explicit dims of every tile
+                x_tile_dim = TileDims(new tile_dim_map());
+                for (auto it2 = gemm_op.at("x_tile_dim").begin(); it2 != gemm_op.at("x_tile_dim").end(); it2++){
+                    for (auto it3 = it2->begin(); it3 != it2->end(); it3++){
+                        (*x_tile_dim.dims)[make_tuple(stoi(it2.key()), stoi(it3.key()))] = make_tuple(it3->at(0).get<int>(), it3->at(1).get<int>());
+                    }
+                }
 
-            no_tiles = make_tuple(gemm_op["no_tiles"][0].get<int>(), gemm_op["no_tiles"][1].get<int>(), gemm_op["no_tiles"][2].get<int>());
-            input_size = make_tuple(gemm_op["input_size"][0].get<int>(), gemm_op["input_size"][1].get<int>());
-            weight_size = make_tuple(gemm_op["weight_size"][0].get<int>(), gemm_op["weight_size"][1].get<int>());
+                w_tile_dim = TileDims(new tile_dim_map());
+                for (auto it2 = gemm_op.at("w_tile_dim").begin(); it2 != gemm_op.at("w_tile_dim").end(); it2++){
+                    for (auto it3 = it2->begin(); it3 != it2->end(); it3++){
+                        (*w_tile_dim.dims)[make_tuple(stoi(it2.key()), stoi(it3.key()))] = make_tuple(it3->at(0).get<int>(), it3->at(1).get<int>());
+                    }
+                }
+            }
         }
 
         list<string>* dependencies = new list<string>();
@@ -177,29 +249,89 @@ void Model::import_layers(json j){
 
         bool is_conv = false;
         tuple<int,int> conv_kernel_size (-1,-1);
-        string layer_type =  j["layers"][layer_name]["layer_type"].get<string>();
+        string layer_type = jl.at("layer_type").get<string>();
 
         if (layer_type == "Conv2D"){
             is_conv = true;
-            conv_kernel_size = make_tuple(gemm_op["kernel_size"][0].get<int>(), gemm_op["kernel_size"][1].get<int>());
+            conv_kernel_size = make_tuple(gemm_op.at("kernel_size")[0].get<int>(), gemm_op.at("kernel_size")[1].get<int>());
         }
 
-        bool raw_input = j["layers"][layer_name]["raw_input"].get<int>();
+        bool raw_input = jl.at("raw_input").get<int>();
         Layer layer(model_name+":"+layer_name, x_tile_dim, w_tile_dim, no_tiles, input_size, weight_size, raw_input, is_conv, conv_kernel_size, dependencies);
-        this->layer_list->push_back(layer);
+        this->layer_list->push_back(std::move(layer));
     }        
 
-    this->no_repeat = j["no_repeat"].get<int>();
+    this->no_repeat = j.at("no_repeat").get<int>();
 
     //cout << "Layers for model" << this->model_name << " are successfully parsed" << endl;
 
 }
 
+void Model::import_layers(model_format::ModelFile const& file, size_t index){
+    model_format::ModelRecord const& m = file.model(index);
+    int32_t const* dims = file.dims();
+
+    for (uint32_t l = m.first_layer; l < m.first_layer + m.no_layers; l++){
+        model_format::LayerRecord const& rec = file.layer(l);
+
+        TileDims x_tile_dim;
+        TileDims w_tile_dim;
+        tuple<int, int, int> no_tiles = make_tuple(0,0,0);
+        tuple<int, int> input_size = make_tuple(0,0);
+        tuple<int, int> weight_size = make_tuple(0,0);
+
+        if (rec.has_gemm){
+            no_tiles = make_tuple(rec.no_tiles[0], rec.no_tiles[1], rec.no_tiles[2]);
+            input_size = make_tuple(rec.input_size[0], rec.input_size[1]);
+            weight_size = make_tuple(rec.weight_size[0], rec.weight_size[1]);
+
+            if (rec.tiling == model_format::uniform_tiling){
+                int32_t const* tile_size = dims + rec.x_dims;
+                uniform_gemm_tiling(input_size, weight_size, make_tuple(tile_size[0], tile_size[1], tile_size[2]), x_tile_dim, w_tile_dim);
+            }
+            else if (rec.tiling == model_format::explicit_tiling){
+                x_tile_dim = TileDims(new tile_dim_map());
+                int32_t const* x = dims + rec.x_dims;
+                for (int i = 0; i < rec.no_tiles[0]; i++){
+                    for (int j = 0; j < rec.no_tiles[1]; j++, x += 2){
+                        (*x_tile_dim.dims)[make_tuple(i, j)] = make_tuple(x[0], x[1]);
+                    }
+                }
+
+                w_tile_dim = TileDims(new tile_dim_map());
+                int32_t const* w = dims + rec.w_dims;
+                for (int i = 0; i < rec.no_tiles[1]; i++){
+                    for (int j = 0; j < rec.no_tiles[2]; j++, w += 2){
+                        (*w_tile_dim.dims)[make_tuple(i, j)] = make_tuple(w[0], w[1]);
+                    }
+                }
+            }
+        }
+
+        list<string>* dependencies = new list<string>();
+        for (uint32_t d = rec.first_dep; d < rec.first_dep + rec.no_deps; d++){
+            dependencies->push_back(model_name+":"+string(file.str(file.dep(d))));
+        }
+
+        bool is_conv = false;
+        tuple<int,int> conv_kernel_size (-1,-1);
+        if (file.str(rec.layer_type) == "Conv2D"){
+            is_conv = true;
+            conv_kernel_size = make_tuple(rec.kernel_size[0], rec.kernel_size[1]);
+        }
+
+        Layer layer(model_name+":"+string(file.str(rec.name)), x_tile_dim, w_tile_dim, no_tiles, input_size, weight_size, rec.raw_input, is_conv, conv_kernel_size, dependencies);
+        this->layer_list->push_back(std::move(layer));
+    }
+
+    this->no_repeat = m.no_repeat;
+}
+
 void Layer::create_main_ops(){
     for (int j = 0; j < get<1>(this->no_tiles); j++){
         for (int i = 0; i < get<0>(this->no_tiles); i++){
             int precision = 1;
-            tuple<int, int> dims = (*this->x_tile_dims)[make_tuple(i, j)];
+            tuple<int, int> dims = this->x_tile_dims.at(i, j);
             int memory_size = get<0>(dims) * get<1>(dims) * precision;
             if (this->is_conv){
                 memory_size = memory_size / (get<0>(this->conv_kernel_size) * get<1>(this->conv_kernel_size));
@@ -219,7 +351,7 @@ void Layer::create_main_ops(){
     for (int j = 0; j < get<1>(this->no_tiles); j++){
         for (int k = 0; k < get<2>(this->no_tiles); k++){
             int precision = 1;
-            tuple<int, int> dims = (*this->w_tile_dims)[make_tuple(j, k)];
+            tuple<int, int> dims = this->w_tile_dims.at(j, k);
             int memory_size = get<0>(dims) * get<1>(dims) * precision;
             W_Tile* w_tile = new W_Tile(this->layer_name, make_tuple(j,k), dims, precision, memory_size);
             (*this->w_tiles)[make_tuple(j,k)] = w_tile;
@@ -230,7 +362,7 @@ void Layer::create_main_ops(){
         for (int i = 0; i < get<0>(this->no_tiles); i++){
             for (int k = 0; k < get<2>(this->no_tiles); k++){
                 int precision = 2;
-                tuple<int, int> dims = make_tuple(get<0>((*this->x_tile_dims)[make_tuple(i, j)]), get<1>((*this->w_tile_dims)[make_tuple(j, k)]));
+                tuple<int, int> dims = make_tuple(get<0>(this->x_tile_dims.at(i, j)), get<1>(this->w_tile_dims.at(j, k)));
                 int memory_size = get<0>(dims) * get<1>(dims) * precision;
                 P_Tile* pout_tile = new P_Tile(this->layer_name, make_tuple(i,j,k), dims, precision, memory_size);
                 (*this->p_tiles)[make_tuple(i,j,k)] = pout_tile;
@@ -284,12 +416,16 @@ void Layer::create_post_ops(Arrays* arrays, Interconnects* interconnects){
                         continue;
                     }
 
-                    interconnects->pin_interconnect->apply_permute(arrays->get_pin_permute(r2));
+                    unique_ptr< map<Array*, Bank*> > pin_permute (arrays->get_pin_permute(r2));
+                    interconnects->pin_interconnect->apply_permute(pin_permute.get());
+                    PROFILE_INTERCONNECT(apply_permute, pin);
+                    PROFILE_INTERCONNECT(is_route_free, pin);
                     if(!interconnects->pin_interconnect->is_route_free(op1->pout_tile->bank, op2->array_placed)){
                         continue;
                     }
 
                     op2->assign_pin(op1);
+                    arrays->traffic.add_pin(r2, op2);
                     unconsumed_ops.remove(op1);
                     break;
                 }
@@ -398,6 +534,17 @@ ostream& operator<<(ostream& os, const Model& model)
 }
 
 
+bool Model::tile(tuple<int, int, int> tile_size){
+    bool tiled = false;
+    for (auto it = this->begin(); it != this->end(); it++){
+        if (it->is_untiled()){
+            it->tile(tile_size);
+            tiled = true;
+        }
+    }
+    return tiled;
+}
+
 int Model::total_no_gemm_ops(){
     int total_no_gemm_ops = 0;
     for (auto it = this->begin(); it != this->end(); it++){
@@ -8,11 +8,14 @@
 #include <tuple>
 #include <list>
 #include <iterator>
+#include <algorithm>
+#include <memory>
 
 #include "ops.hpp"
 #include "bank.hpp"
 #include "array.hpp"
 #include "interconnect.hpp"
+#include "model_format.hpp"
 
 #include "nlohmann/json.hpp"
 
@@ -21,11 +24,55 @@ using namespace std;
 
 typedef map<tuple<int, int>, tuple<int, int>> tile_dim_map;
 
+// Dimensions of the tiles of a GEMM operand. Either an explicit map with an
+// entry per tile, or uniform tiles of tile_size over a tensor_size matrix
+// where only the last row/column of tiles is smaller. The explicit map is
+// shared by the copies of a layer.
+class TileDims {
+    public:
+        shared_ptr<tile_dim_map> dims;
+        tuple<int, int> tensor_size;
+        tuple<int, int> tile_size;
+
+        TileDims() : dims(nullptr), tensor_size(0, 0), tile_size(0, 0) {};
+        explicit TileDims(tile_dim_map* dims) : dims(dims), tensor_size(0, 0), tile_size(0, 0) {};
+        TileDims(tuple<int, int> tensor_size, tuple<int, int> tile_size) : dims(nullptr), tensor_size(tensor_size), tile_size(tile_size) {};
+
+        bool is_uniform() const { return this->dims == nullptr; }
+
+        tuple<int, int> at(int i, int j) const {
+            if (this->dims != nullptr){
+                auto it = this->dims->find(make_tuple(i, j));
+                return it == this->dims->end() ? make_tuple(0, 0) : it->second;
+            }
+            return make_tuple(min(get<0>(this->tile_size), get<0>(this->tensor_size) - i * get<0>(this->tile_size)),
+                              min(get<1>(this->tile_size), get<1>(this->tensor_size) - j * get<1>(this->tile_size)));
+        }
+
+        // explicit map of a rows x cols grid of tiles
+        tile_dim_map to_map(int rows, int cols) const {
+            tile_dim_map m;
+            for (int i = 0; i < rows; i++){
+                for (int j = 0; j < cols; j++){
+                    m[make_tuple(i, j)] = this->at(i, j);
+                }
+            }
+            return m;
+        }
+};
+
+// Uniform tiles of tile_size (m, k, n) for the (M x K) * (K x N) GEMM of a
+// layer. The edge tiles follow the precompiler's split_mat.
+inline void uniform_gemm_tiling(tuple<int, int> input_size, tuple<int, int> weight_size, tuple<int, int, int> tile_size, TileDims& x_tile_dims, TileDims& w_tile_dims){
+    x_tile_dims = TileDims(make_tuple(get<0>(input_size), get<0>(weight_size)), make_tuple(get<0>(tile_size), get<1>(tile_size)));
+    w_tile_dims = TileDims(weight_size, make_tuple(get<1>(tile_size), get<2>(tile_size)));
+}
+
 class Layer {
     public:
         string layer_name;
-        tile_dim_map* x_tile_dims;
-        tile_dim_map* w_tile_dims;
+        TileDims x_tile_dims;
+        TileDims w_tile_dims;
         tuple<int, int, int> no_tiles;
         tuple<int, int> input_size;
         tuple<int, int> weight_size;
@@ -45,8 +92,17 @@ class Layer {
         int end_round;
         list<string>* dependencies;
 
-        Layer(string, tile_dim_map*, tile_dim_map*, tuple<int, int, int>, tuple<int, int>, tuple<int, int>, bool, bool, tuple<int, int>, list<string>*);
+        // the layer owns its tiles, ops and dependencies
+        Layer(string, TileDims, TileDims, tuple<int, int, int>, tuple<int, int>, tuple<int, int>, bool, bool, tuple<int, int>, list<string>*);
+        Layer(Layer&& other);
+        Layer(Layer const&) = delete;
+        Layer& operator=(Layer const&) = delete;
         ~Layer();
+
+        // a GEMM layer of an untiled precompiled model, only the GEMM shape is known
+        bool is_untiled() const { return get<0>(this->no_tiles) == 0 && get<0>(this->input_size) > 0; }
+        // Partitions the GEMM into uniform tiles of tile_size (m, k, n).
+        void tile(tuple<int, int, int> tile_size);
         
         void create_main_ops();
         void create_post_ops(Arrays* arrays, Interconnects* interconnects);
@@ -73,23 +129,41 @@ class Model {
         list<Layer>::iterator end() { return layer_list->end(); }
 
         Model(){};
-        Model(string model_name, json j){
+        Model(Model const&) = delete;
+        Model& operator=(Model const&) = delete;
+        // empty model, the layers are appended by the importer
+        explicit Model(string model_name){
+            this->model_name = model_name;
+            this->no_repeat = 1;
+            this->layer_list = new list<Layer>();
+        };
+        Model(string model_name, json const& j){
             this->model_name = model_name;
             this->layer_list = new list<Layer>();
 
             this->import_layers(j);
 
         };
+        // model at index of a mapped binary precompiled model
+        Model(model_format::ModelFile const& file, size_t index){
+            this->model_name = string(file.str(file.model(index).name));
+            this->layer_list = new list<Layer>();
+
+            this->import_layers(file, index);
+        };
         ~Model(){delete this->layer_list;};
 
-        void import_layers(json j);
+        void import_layers(json const& j);
+        void import_layers(model_format::ModelFile const& file, size_t index);
         bool all_layers_scheduled();
         Layer* get_layer_by_name(string layer_name);
         friend ostream& operator<<(ostream& os, const Model& model);
         int total_no_gemm_ops();
+        // tiles the untiled layers, see Layer::tile, returns false if there were none
+        bool tile(tuple<int, int, int> tile_size);
 
 
-        list<Layer>* layer_list;
+        list<Layer>* layer_list {nullptr};
 
 
 };
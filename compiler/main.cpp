@@ -5,8 +5,18 @@
 #include <tuple>
 #include <string>
 #include <list>
+#include <filesystem>
+#include <thread>
+#include <cmath>
 
 #include "compiler.hpp"
+#include "model_format.hpp"
+#include "model_reader.hpp"
+#include "results_store.hpp"
+#include "schedule_file.hpp"
+#include "sweep.hpp"
+#include "trace.hpp"
+#include "cpu_topology.hpp"
 #include "array.hpp"
 #include "interconnect.hpp"
 #include "post_processor.hpp"
@@ -15,8 +25,6 @@
 
 #include <boost/log/trivial.hpp>
 #include <boost/program_options.hpp>
-#include <boost/archive/text_oarchive.hpp>
-#include <boost/archive/text_iarchive.hpp>
 
 using namespace std;
 
@@ -25,11 +33,28 @@ namespace po = boost::program_options;
 int main(int ac, char* av[]){
     int no_array, no_rows, no_cols;
     int bank_size;
+    int partition_size;
     float bandwidth;
     int prefetch_limit;
     InterconnectType interconnect_type;
+    ClosParams clos;
+    bool verify_schedule;
+    int no_threads {1};
+    #ifdef COMPILER_MULTITHREADING
+    int speculative_rounds;
+    bool pin_workers;
+    #endif
     boost::log::trivial::severity_level log_level;
     string work_dir;
+    string model_file;
+    string save_schedule;
+    string schedule_cache;
+    string trace_file;
+    int trace_capacity;
+    string round_stats_file;
+    string results_store_file;
+    string sweep_file;
+    int sweep_threads;
 
     po::options_description desc("Allowed options");
     desc.add_options()
@@ -39,11 +64,32 @@ int main(int ac, char* av[]){
         ("no_array,N", po::value<int>(&no_array)->default_value(128), "number of systolic arrays")
         ("memory_bw,M", po::value<float>(&bandwidth)->default_value(1200), "memory bandwidth in GB/s")
         ("prefetch,P", po::value<int>(&prefetch_limit)->default_value(100), "No of rounds allowed for prefetching")
+        ("partition_size", po::value<int>(&partition_size)->default_value(0), "rows of the input tiles of an untiled precompiled model, no_rows if 0")
         ("bank_size,S", po::value<int>(&bank_size)->default_value(524288), "SRAM bank size")
         ("ict_type,I", po::value<InterconnectType>(&interconnect_type)->default_value(InterconnectType::banyan_exp_1), "interconnect type (see enum members)")
-        //Possible options for ict_type: crossbar, benes_copy, benes_vanilla, banyan_exp_0, banyan_exp_1, banyan_exp_2, banyan_exp_3, banyan_exp_4
+        //Possible options for ict_type: crossbar, benes_copy, benes_vanilla, banyan_exp_0, banyan_exp_1, banyan_exp_2, banyan_exp_3, banyan_exp_4, bus, clos_rearrangeable, clos_strict
+        ("clos_n", po::value<int>(&clos.n)->default_value(0), "ports of an ingress/egress switch of a Clos network, derived from the no. of ports if 0")
+        ("clos_r", po::value<int>(&clos.r)->default_value(0), "ingress/egress switches of a Clos network, derived from the no. of ports if 0")
+        ("clos_m", po::value<int>(&clos.m)->default_value(0), "middle switches of a Clos network, n or 2n - 1 depending on ict_type if 0")
+        ("verify_schedule", po::value<bool>(&verify_schedule)->default_value(false), "push every round through the configured interconnects after compilation")
         ("work_dir,d", po::value<string>(&work_dir)->default_value("experiments/tmp"), "directory for input/output files")
+        ("model_file", po::value<string>(&model_file)->default_value(""), "precompiled model (.json or .bin), defaults to the newer of precompiled_model.bin/.json in work_dir")
+        ("save_schedule", po::value<string>(&save_schedule)->default_value(""), "save the compiled schedule to this file for run_cycle_model")
+        ("schedule_cache", po::value<string>(&schedule_cache)->default_value(""), "directory of compiled schedules, reused when only the memory bandwidth or prefetch changes")
+        ("trace", po::value<string>(&trace_file)->default_value(""), "write a Chrome/Perfetto trace of the cycle model to this file")
+        ("trace_capacity", po::value<int>(&trace_capacity)->default_value(1 << 16), "events kept per component in the trace, older ones are dropped")
+        ("round_stats", po::value<string>(&round_stats_file)->default_value(""), "write the statistics of every round of the cycle model to this CSV file")
+        ("results_store", po::value<string>(&results_store_file)->default_value(""), "also append the results to this columnar results store (see results_store.py)")
+        ("sweep", po::value<string>(&sweep_file)->default_value(""), "JSON list of configurations to run in this process, the other options are their defaults; the results go to sweep_results.json")
+        ("sweep_threads", po::value<int>(&sweep_threads)->default_value((int) std::max(1u, std::thread::hardware_concurrency())), "number of configurations of a sweep run in parallel")
         ("log_level,l", po::value<boost::log::trivial::severity_level>(&log_level)->default_value(boost::log::trivial::severity_level::error), "log level");
+    #ifdef COMPILER_MULTITHREADING
+    desc.add_options()
+        // SMT siblings share the caches that the placement is bound by, one worker per physical core by default
+        ("threads,t", po::value<int>(&no_threads)->default_value((int) multithreading::CpuTopology::detect().num_physical_cores()), "number of placement workers, 1 runs the placement sequentially")
+        ("pin_workers", po::value<bool>(&pin_workers)->default_value(false), "pin each worker to a cpu, filling one NUMA node before the next")
+        ("speculative_rounds", po::value<int>(&speculative_rounds)->default_value(0), "rounds probed in parallel for an op that does not fit at its initial round");
+    #endif
     po::variables_map vm;
     po::store(po::parse_command_line(ac, av, desc), vm);
     po::notify(vm);
@@ -55,6 +101,14 @@ int main(int ac, char* av[]){
 
     logger_setup(log_level);
 
+    try {
+        resolve_clos_params(std::ceil(std::log2(no_array)), interconnect_type, clos);
+    }
+    catch (invalid_argument& e){
+        cout << e.what() << endl;
+        exit(1);
+    }
+
     std::cout << (unsigned) interconnect_type << "\n";
 
     std::cout << "Running with: " <<
@@ -65,24 +119,56 @@ int main(int ac, char* av[]){
         "bank size = " << bank_size << " " <<
         "prefetch = " << prefetch_limit << " " <<
         "interconnect_type = " << interconnect_type << " " <<
+        "threads = " << no_threads << " " <<
         "\n";
 
-    // Load the precompiled model in the JSON format. Precompiler must be invoked first to generate this file.
-    json jin;
-    ifstream input_file;
-    string ifname = work_dir + "/precompiled_model.json";
-    input_file.open(ifname, ifstream::in);
-    if(!input_file.is_open()){
-        cout << "Input file " << ifname << " cannot be opened." << endl;
-        exit(1);
+    // Load the precompiled model. Precompiler must be invoked first to generate this file.
+    // The binary format is mapped into memory instead of being parsed.
+    if (model_file.empty()){
+        namespace fs = std::filesystem;
+        string bin_name = work_dir + "/precompiled_model.bin";
+        string json_name = work_dir + "/precompiled_model.json";
+        std::error_code ec;
+        bool use_bin = fs::exists(bin_name, ec) && (!fs::exists(json_name, ec) || fs::last_write_time(bin_name, ec) >= fs::last_write_time(json_name, ec));
+        model_file = use_bin ? bin_name : json_name;
     }
-    input_file >> jin;
-    input_file.close();
 
-    Arrays* arrays = new Arrays(no_array, no_rows, no_cols);
-    PostProcessors* post_processors = new PostProcessors(no_array);
-    Banks* banks = new Banks(no_array, bank_size);
-    Interconnects* interconnects = new Interconnects(no_array, interconnect_type);
+    if (!sweep_file.empty()){
+        ifstream sweep_input(sweep_file, ifstream::in);
+        if(!sweep_input.is_open()){
+            cout << "Sweep file " << sweep_file << " cannot be opened." << endl;
+            exit(1);
+        }
+        json jsweep = json::parse(sweep_input);
+
+        sweep::Config defaults {no_array, no_rows, no_cols, bank_size, bandwidth, prefetch_limit, interconnect_type, partition_size, clos};
+        vector<sweep::Config> configs;
+        for (auto& j: jsweep){
+            configs.push_back(sweep::parse_config(j, defaults));
+        }
+
+        sweep::ModelDescription* models = sweep::ModelDescription::load(model_file);
+        vector<json> results = sweep::run(*models, configs, sweep_threads);
+        delete models;
+
+        string ofname = work_dir + "/sweep_results.json";
+        ofstream output_file(ofname, ofstream::out);
+        if(!output_file.is_open()){
+            cout << "Output file " << ofname << " cannot be opened." << endl;
+            exit(1);
+        }
+        output_file << json(results).dump();
+        output_file.close();
+        cout << configs.size() << " configurations saved to " << ofname << endl;
+
+        if (!results_store_file.empty()){
+            for (auto& jout: results){
+                if (!jout.contains("error")) results_store::append(results_store_file, jout);
+            }
+            cout << "Results appended to " << results_store_file << endl;
+        }
+        return 0;
+    }
 
     //TODO: Make this parametric
     float freq = 1e9;
@@ -90,38 +176,149 @@ int main(int ac, char* av[]){
     //Convert GB/s to Bytes per cycle
     bandwidth = bandwidth * ((1 << 30) / freq);
 
-    Dram* dram = new Dram(bandwidth, prefetch_limit);
+    // The memory bandwidth and the prefetch limit do not change the schedule,
+    // a cached schedule goes straight to the cycle model.
+    string cache_file;
+    schedule_file::Schedule* cached = nullptr;
+    if (!schedule_cache.empty()){
+        json options = {{"no_array", no_array}, {"no_rows", no_rows}, {"no_cols", no_cols}, {"bank_size", bank_size},
+            {"interconnect_type", interconnect_type}, {"verify_schedule", verify_schedule}, {"partition_size", partition_size},
+            {"clos", {clos.m, clos.n, clos.r}}};
+        ifstream model_data(model_file, ifstream::in | ifstream::binary);
+        if(!model_data.is_open()){
+            cout << "Input file " << model_file << " cannot be opened." << endl;
+            exit(1);
+        }
+        cache_file = schedule_file::cache_path(schedule_cache, model_data, options);
 
-    Compiler* compiler = new Compiler(arrays, banks, interconnects, post_processors, dram);
+        if (std::filesystem::exists(cache_file)){
+            try {
+                cached = schedule_file::load(cache_file);
+                cout << "Schedule loaded from " << cache_file << endl;
+            }
+            catch (runtime_error& e){
+                BOOST_LOG_TRIVIAL(warning) << "Cached schedule is not used: " << e.what();
+            }
+        }
+    }
 
-    #ifdef COMPILER_MULTITHREADING
-    // TODO enable passing the number of workers as a command-line argument argument
-    compiler->enable_multithreading(48);
-    #endif
+    Compiler* compiler;
+    json config;
+    // the layers own the tiles and ops of the schedule, the models are deleted after the compiler
+    vector<Model*> models;
+    if (cached != nullptr){
+        compiler = cached->compiler;
+        compiler->dram->bandwidth = bandwidth;
+        compiler->dram->prefetch_limit = prefetch_limit;
+        config = cached->meta;
+    }
+    else {
+        json args;
+        if (model_format::is_model_file(model_file)){
+            model_format::ModelFile bin_model(model_file);
+            args = json::parse(bin_model.str(bin_model.header().args));
+            for (size_t i = 0; i < bin_model.no_models(); i++){
+                models.push_back(new Model(bin_model, i));
+            }
+        }
+        else {
+            // the layers are built while the file is parsed, the JSON document is never held in memory
+            ifstream input_file;
+            input_file.open(model_file, ifstream::in);
+            if(!input_file.is_open()){
+                cout << "Input file " << model_file << " cannot be opened." << endl;
+                exit(1);
+            }
+            models = import_models(input_file, args);
+            input_file.close();
+        }
+
+        Arrays* arrays = new Arrays(no_array, no_rows, no_cols);
+        PostProcessors* post_processors = new PostProcessors(no_array);
+        Banks* banks = new Banks(no_array, bank_size);
+        Interconnects* interconnects = new Interconnects(no_array, interconnect_type, clos);
+
+        Dram* dram = new Dram(bandwidth, prefetch_limit);
+
+        compiler = new Compiler(arrays, banks, interconnects, post_processors, dram);
+        compiler->freq = freq;
+        compiler->partition_size = partition_size;
 
-    // Run the compilation for each DNN model provided
-    Model* model = new Model();
-    for (json::iterator it = jin.begin(); it != jin.end(); ++it) {
-        string key = it.key();
-        if (!key.compare("args")) continue;
+        #ifdef COMPILER_MULTITHREADING
+        if (no_threads > 1){
+            compiler->enable_multithreading(no_threads, 0, pin_workers);
+            if (speculative_rounds > 1) compiler->enable_speculation(no_threads, speculative_rounds, pin_workers);
+        }
+        #endif
 
-        string model_name (key);
-        json j (jin[model_name]);
+        // Run the compilation for each DNN model provided
+        Model* model = nullptr;
+        for (Model* m: models) {
+            model = m;
 
-        model = new Model(model_name, j);
+            compiler->compile(model);
 
-        compiler->compile(model);
-        
-        compiler->duplicate_schedule(model, model->no_repeat);
+            compiler->duplicate_schedule(model, model->no_repeat);
+        }
+
+        cout << "Finished succesfully" << endl;
+        cout << "# of main rounds: " << compiler->no_main_rounds() << endl;
+        cout << "# of post rounds: " << compiler->no_post_rounds() << endl;
+
+        int no_unverified_rounds = -1;
+        if (verify_schedule){
+            no_unverified_rounds = compiler->verify_schedule();
+            cout << "# of rounds failing interconnect verification: " << no_unverified_rounds << endl;
+        }
+
+        // compile settings of the schedule, the results are added to them
+        config = args;
+        config["no_array"] = no_array;
+        config["interconnect_type"] = interconnect_type; //TODO: Replace with string value
+        config["bank_size"] = bank_size;
+        config["no_layers"] = model->layer_list->size();
+        config["total_no_gemm_ops"] = model->total_no_gemm_ops();
+        compiler->add_array_config(config);
+        if (verify_schedule){
+            config["no_unverified_rounds"] = no_unverified_rounds;
+        }
+
+        if (!cache_file.empty()){
+            schedule_file::save(compiler, config, cache_file);
+        }
+    }
+
+    if (!save_schedule.empty()){
+        schedule_file::save(compiler, config, save_schedule);
+        cout << "Schedule saved to " << save_schedule << endl;
+    }
+
+    trace::Recorder* recorder = nullptr;
+    if (!trace_file.empty()){
+        recorder = new trace::Recorder(compiler, trace_capacity);
+    }
+
+    RoundStats* round_stats = nullptr;
+    if (!round_stats_file.empty()){
+        round_stats = new RoundStats(round_stats_file);
+        compiler->round_stats = round_stats;
     }
-    
-    cout << "Finished succesfully" << endl;
-    cout << "# of main rounds: " << compiler->no_main_rounds() << endl;
-    cout << "# of post rounds: " << compiler->no_post_rounds() << endl;
 
     compiler->run_cycle_model();
     cout << "Total no. of cycles: " << compiler->no_cycles << endl;
 
+    if (round_stats != nullptr){
+        compiler->round_stats = nullptr;
+        delete round_stats;
+        cout << "Round statistics saved to " << round_stats_file << endl;
+    }
+
+    if (recorder != nullptr){
+        trace::save_chrome_trace(*recorder, compiler->freq, trace_file);
+        cout << "Trace saved to " << trace_file << endl;
+        delete recorder;
+    }
+
     // Save results in the JSON format
     ofstream output_file;
     string ofname = work_dir + "/sim_results.json";
@@ -131,46 +328,41 @@ int main(int ac, char* av[]){
         exit(1);
     }
 
-    json jout(jin["args"]);
-    jout["no_array"] = no_array;
-    jout["interconnect_type"] = interconnect_type; //TODO: Replace with string value
-    jout["bank_size"] = bank_size;
-    jout["bandwidth"] = bandwidth;
-    jout["no_cycles"] = compiler->no_cycles;
-    jout["no_main_rounds"] = compiler->no_main_rounds();
-    jout["no_post_rounds"] = compiler->no_post_rounds();
-    jout["interconnect_tdp"] = interconnects->tdp(no_cols);
-    //jout["no_ops"] = jin["no_ops"].get<long>();
-    jout["x_tiles_bw_usage"] = dram->x_tiles_bw_usage;
-    jout["w_tiles_bw_usage"] = dram->w_tiles_bw_usage;
-    jout["p_tiles_bw_usage"] = dram->p_tiles_bw_usage;
-    jout["total_bw_usage"] = dram->x_tiles_bw_usage + dram->w_tiles_bw_usage + dram->p_tiles_bw_usage;
-    jout["no_post_ops"] = post_processors->total_no_ops(); //INT operation (elementwise)
-    jout["no_ops"] = arrays->total_no_ops(); //INT operation (elementwise)
-    jout["total_sram_read_bytes"] = arrays->total_sram_read_bytes() + post_processors->total_sram_read_bytes(); //Bytes
-    jout["total_sram_write_bytes"] = arrays->total_sram_write_bytes() + post_processors->total_sram_write_bytes(); //Bytes
-    jout["memory_stall_cycles"] = compiler->memory_stall_cycles;
-    jout["no_layers"] = model->layer_list->size();
-    jout["total_no_gemm_ops"] = model->total_no_gemm_ops();
-
-    cout << "Computing interconn_total_mbytes..." << endl;
-    jout["interconn_total_mbytes"] = compiler->interconn_total_mbytes();
-
-    cout << "Computing interconn_total_mbytes_with_multicast..." << endl;
-    jout["interconn_total_mbytes_with_multicast"] = compiler->interconn_total_mbytes_with_multicast();
-
-    cout << "total_no_gemm_ops: " << model->total_no_gemm_ops() << endl;
+    json jout = compiler->sim_results(config);
+    #ifdef COMPILER_PROFILE
+    jout["profile"] = profile::current().to_json();
+    #endif
+
+    cout << "total_no_gemm_ops: " << config["total_no_gemm_ops"] << endl;
 
     cout << jout.dump() << endl;
 
     output_file << jout.dump();
     output_file.close();
 
+    if (!results_store_file.empty()){
+        results_store::append(results_store_file, jout);
+        cout << "Results appended to " << results_store_file << endl;
+    }
+
+    if (cached != nullptr){
+        delete cached;
+        return 0;
+    }
+
+    // the placement workers refer to the interconnects
+    Arrays* arrays = compiler->arrays;
+    PostProcessors* post_processors = compiler->post_processors;
+    Banks* banks = compiler->banks;
+    Interconnects* interconnects = compiler->interconnects;
+    Dram* dram = compiler->dram;
+    delete compiler;
     delete arrays;
     delete post_processors;
     delete banks;
     delete interconnects;
-    delete compiler;
+    delete dram;
+    for (Model* model: models) delete model;
 
     return 0;
 }
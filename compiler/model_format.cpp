@@ -0,0 +1,286 @@
+
+#include "model_format.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace model_format {
+
+ModelFile::ModelFile(string const &path){
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0){
+        throw runtime_error("Model file " + path + " cannot be opened.");
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(Header)){
+        close(fd);
+        throw runtime_error("Model file " + path + " is too small.");
+    }
+
+    this->size_ = st.st_size;
+    this->data_ = mmap(nullptr, this->size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (this->data_ == MAP_FAILED){
+        this->data_ = nullptr;
+        throw runtime_error("Model file " + path + " cannot be mapped.");
+    }
+
+    auto base = (char const *) this->data_;
+    this->header_ = (Header const *) base;
+    try {
+        this->validate();
+    }
+    catch (...) {
+        munmap(this->data_, this->size_);
+        throw;
+    }
+
+    this->models_ = (ModelRecord const *) (base + this->header_->models_offset);
+    this->layers_ = (LayerRecord const *) (base + this->header_->layers_offset);
+    this->deps_ = (StrRef const *) (base + this->header_->deps_offset);
+    this->dims_ = (int32_t const *) (base + this->header_->dims_offset);
+    this->strings_ = base + this->header_->strings_offset;
+}
+
+ModelFile::~ModelFile(){
+    if (this->data_ != nullptr) munmap(this->data_, this->size_);
+}
+
+void ModelFile::validate() const {
+    Header const &h = *this->header_;
+    if (memcmp(h.magic, magic, sizeof(magic)) != 0){
+        throw runtime_error("Not a binary precompiled model.");
+    }
+    if (h.byte_order != byte_order){
+        throw runtime_error("Binary precompiled model has a different byte order.");
+    }
+    if (h.version < 1 || h.version > version){
+        throw runtime_error("Unsupported binary precompiled model version " + to_string(h.version) + ".");
+    }
+    if (h.file_size != this->size_){
+        throw runtime_error("Binary precompiled model is truncated.");
+    }
+
+    auto check_section = [&](uint64_t offset, uint64_t count, uint64_t size){
+        if (offset % 8 != 0 || offset > this->size_ || count > (this->size_ - offset) / size){
+            throw runtime_error("Binary precompiled model has a corrupt section.");
+        }
+    };
+    check_section(h.models_offset, h.no_models, sizeof(ModelRecord));
+    check_section(h.layers_offset, h.no_layers, sizeof(LayerRecord));
+    check_section(h.deps_offset, h.no_deps, sizeof(StrRef));
+    check_section(h.dims_offset, h.no_dims, sizeof(int32_t));
+    check_section(h.strings_offset, h.strings_size, 1);
+
+    auto base = (char const *) this->data_;
+    auto check_str = [&](StrRef ref){
+        if (ref.offset > h.strings_size || ref.size > h.strings_size - ref.offset){
+            throw runtime_error("Binary precompiled model has a corrupt string.");
+        }
+    };
+    check_str(h.args);
+
+    auto models = (ModelRecord const *) (base + h.models_offset);
+    for (uint32_t i = 0; i < h.no_models; i++){
+        check_str(models[i].name);
+        if (models[i].first_layer > h.no_layers || models[i].no_layers > h.no_layers - models[i].first_layer){
+            throw runtime_error("Binary precompiled model has a corrupt model record.");
+        }
+    }
+
+    auto layers = (LayerRecord const *) (base + h.layers_offset);
+    auto deps = (StrRef const *) (base + h.deps_offset);
+    for (uint32_t i = 0; i < h.no_layers; i++){
+        LayerRecord const &l = layers[i];
+        check_str(l.name);
+        check_str(l.layer_type);
+        if (l.first_dep > h.no_deps || l.no_deps > h.no_deps - l.first_dep){
+            throw runtime_error("Binary precompiled model has a corrupt layer record.");
+        }
+        for (uint32_t d = 0; d < l.no_deps; d++){
+            check_str(deps[l.first_dep + d]);
+        }
+        if (!l.has_gemm) continue;
+        for (int k = 0; k < 3; k++){
+            if (l.no_tiles[k] < 0){
+                throw runtime_error("Binary precompiled model has a corrupt layer record.");
+            }
+        }
+        uint64_t no_x_dims = 2 * (uint64_t) l.no_tiles[0] * l.no_tiles[1];
+        uint64_t no_w_dims = 2 * (uint64_t) l.no_tiles[1] * l.no_tiles[2];
+        if (l.tiling == uniform_tiling){
+            no_x_dims = no_w_dims = 3;
+        }
+        else if (l.tiling == untiled){
+            no_x_dims = no_w_dims = 0;
+        }
+        else if (l.tiling != explicit_tiling){
+            throw runtime_error("Binary precompiled model has an unknown tiling.");
+        }
+        if (l.x_dims > h.no_dims || no_x_dims > h.no_dims - l.x_dims || l.w_dims > h.no_dims || no_w_dims > h.no_dims - l.w_dims){
+            throw runtime_error("Binary precompiled model has corrupt tile dimensions.");
+        }
+    }
+}
+
+size_t ModelFile::find_model(string_view name) const {
+    for (size_t i = 0; i < this->no_models(); i++){
+        if (this->str(this->models_[i].name) == name) return i;
+    }
+    return this->no_models();
+}
+
+namespace {
+
+struct Writer {
+    vector<ModelRecord> models;
+    vector<LayerRecord> layers;
+    vector<StrRef> deps;
+    vector<int32_t> dims;
+    string strings;
+
+    StrRef add_string(string const &s){
+        StrRef ref {(uint32_t) this->strings.size(), (uint32_t) s.size()};
+        this->strings += s;
+        return ref;
+    }
+
+    // appends the tile dimensions of a rows x cols grid, every tile must be present
+    uint64_t add_dims(json const &tile_dim, int rows, int cols){
+        uint64_t first = this->dims.size();
+        for (int i = 0; i < rows; i++){
+            for (int j = 0; j < cols; j++){
+                json const &d = tile_dim.at(to_string(i)).at(to_string(j));
+                this->dims.push_back(d.at(0).get<int32_t>());
+                this->dims.push_back(d.at(1).get<int32_t>());
+            }
+        }
+        return first;
+    }
+
+    void add_layer(json const &jl, string const &layer_name){
+        LayerRecord l {};
+        l.name = this->add_string(layer_name);
+        l.layer_type = this->add_string(jl.at("layer_type").get<string>());
+        l.raw_input = jl.at("raw_input").get<int32_t>();
+        l.kernel_size[0] = l.kernel_size[1] = -1;
+
+        l.first_dep = this->deps.size();
+        for (auto const &dep: jl.at("deps")){
+            this->deps.push_back(this->add_string(dep.get<string>()));
+        }
+        l.no_deps = this->deps.size() - l.first_dep;
+
+        json const &gemm_op = jl.at("gemm_op");
+        if (!gemm_op.is_null()){
+            l.has_gemm = 1;
+            for (int k = 0; k < 2; k++){
+                l.input_size[k] = gemm_op.at("input_size").at(k).get<int32_t>();
+                l.weight_size[k] = gemm_op.at("weight_size").at(k).get<int32_t>();
+            }
+            for (int k = 0; k < 3 && gemm_op.contains("no_tiles"); k++){
+                l.no_tiles[k] = gemm_op.at("no_tiles").at(k).get<int32_t>();
+            }
+            if (gemm_op.contains("kernel_size")){
+                l.kernel_size[0] = gemm_op["kernel_size"].at(0).get<int32_t>();
+                l.kernel_size[1] = gemm_op["kernel_size"].at(1).get<int32_t>();
+            }
+            if (!gemm_op.contains("no_tiles")){
+                // only the GEMM shape
+                l.tiling = untiled;
+            }
+            else if (gemm_op.contains("tile_size")){
+                l.tiling = uniform_tiling;
+                l.x_dims = l.w_dims = this->dims.size();
+                for (int k = 0; k < 3; k++){
+                    this->dims.push_back(gemm_op["tile_size"].at(k).get<int32_t>());
+                }
+            }
+            else {
+                l.x_dims = this->add_dims(gemm_op.at("x_tile_dim"), l.no_tiles[0], l.no_tiles[1]);
+                l.w_dims = this->add_dims(gemm_op.at("w_tile_dim"), l.no_tiles[1], l.no_tiles[2]);
+            }
+        }
+        this->layers.push_back(l);
+    }
+
+    void add_model(json const &j, string const &model_name){
+        ModelRecord m {};
+        m.name = this->add_string(model_name);
+        m.no_repeat = j.at("no_repeat").get<int32_t>();
+        m.no_ops = j.contains("no_ops") ? (int64_t) j["no_ops"].get<double>() : 0;
+        m.first_layer = this->layers.size();
+        for (auto const &layer_name: j.at("order")){
+            this->add_layer(j.at("layers").at(layer_name.get<string>()), layer_name.get<string>());
+        }
+        m.no_layers = this->layers.size() - m.first_layer;
+        this->models.push_back(m);
+    }
+};
+
+uint64_t align8(uint64_t offset){
+    return (offset + 7) & ~(uint64_t) 7;
+}
+
+} // namespace
+
+void write_model_file(json const &jin, string const &path){
+    Writer w;
+    Header h {};
+    memcpy(h.magic, magic, sizeof(magic));
+    h.byte_order = byte_order;
+    h.version = version;
+    h.args = w.add_string(jin.contains("args") ? jin["args"].dump() : "{}");
+
+    // same order as the models are compiled from the JSON
+    for (auto it = jin.begin(); it != jin.end(); ++it){
+        if (it.key() == "args") continue;
+        w.add_model(it.value(), it.key());
+    }
+
+    h.no_models = w.models.size();
+    h.no_layers = w.layers.size();
+    h.no_deps = w.deps.size();
+    h.no_dims = w.dims.size();
+    h.models_offset = align8(sizeof(Header));
+    h.layers_offset = align8(h.models_offset + w.models.size() * sizeof(ModelRecord));
+    h.deps_offset = align8(h.layers_offset + w.layers.size() * sizeof(LayerRecord));
+    h.dims_offset = align8(h.deps_offset + w.deps.size() * sizeof(StrRef));
+    h.strings_offset = align8(h.dims_offset + w.dims.size() * sizeof(int32_t));
+    h.strings_size = w.strings.size();
+    h.file_size = h.strings_offset + h.strings_size;
+
+    vector<char> buffer(h.file_size, 0);
+    auto put = [&](uint64_t offset, void const *data, size_t size){
+        if (size > 0) memcpy(buffer.data() + offset, data, size);
+    };
+    put(0, &h, sizeof(h));
+    put(h.models_offset, w.models.data(), w.models.size() * sizeof(ModelRecord));
+    put(h.layers_offset, w.layers.data(), w.layers.size() * sizeof(LayerRecord));
+    put(h.deps_offset, w.deps.data(), w.deps.size() * sizeof(StrRef));
+    put(h.dims_offset, w.dims.data(), w.dims.size() * sizeof(int32_t));
+    put(h.strings_offset, w.strings.data(), w.strings.size());
+
+    ofstream out(path, ofstream::out | ofstream::binary);
+    if (!out.is_open()){
+        throw runtime_error("Model file " + path + " cannot be written.");
+    }
+    out.write(buffer.data(), buffer.size());
+}
+
+bool is_model_file(string const &path){
+    char buffer[sizeof(magic)] {};
+    ifstream in(path, ifstream::in | ifstream::binary);
+    in.read(buffer, sizeof(buffer));
+    return in.gcount() == sizeof(buffer) && memcmp(buffer, magic, sizeof(magic)) == 0;
+}
+
+} // namespace model_format
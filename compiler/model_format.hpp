@@ -0,0 +1,151 @@
+#ifndef MODEL_FORMAT_HPP
+#define MODEL_FORMAT_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "nlohmann/json.hpp"
+
+using json = nlohmann::json;
+using namespace std;
+
+// Binary precompiled model (precompiled_model.bin)
+//
+// Holds the same information as precompiled_model.json in fixed-size little
+// endian records, so that it can be mapped into memory and read in place:
+//
+//   Header
+//   ModelRecord[no_models]   models in the order of the JSON object keys
+//   LayerRecord[no_layers]   layers of all models, in their "order"
+//   StrRef[no_deps]          dependencies of all layers
+//   int32_t[no_dims]         tile dimensions of the layers, see below
+//   char[strings_size]       names, layer types and the "args" JSON
+//
+// Every section starts at an 8 byte aligned offset from the beginning of the
+// file. precompiler/model_format.py writes the same layout.
+//
+// LayerRecord::tiling selects how the tiles of a GEMM layer are encoded:
+//
+//   explicit_tiling  the gemm_op has "x_tile_dim" and "w_tile_dim". x_dims and
+//                    w_dims index a (rows, cols) pair per tile in dims, row
+//                    major, no_tiles[0] x no_tiles[1] x tiles followed by
+//                    no_tiles[1] x no_tiles[2] w tiles. Layers without a GEMM
+//                    also use it, with no_tiles and both offsets 0.
+//   uniform_tiling   the gemm_op has "tile_size". x_dims == w_dims index the
+//                    (m, k, n) tile size in dims, the edge tiles follow the
+//                    precompiler's split_mat, see uniform_gemm_tiling().
+//   untiled          the gemm_op has no "no_tiles". no_tiles, x_dims and w_dims
+//                    are 0, nothing is stored in dims and the compiler tiles
+//                    the GEMM for its arrays and partition_size.
+namespace model_format {
+
+constexpr char magic[8] = {'S', 'O', 'S', 'A', 'M', 'D', 'L', '\0'};
+constexpr uint32_t byte_order = 0x01020304;
+constexpr uint32_t version = 3;
+
+// LayerRecord::tiling
+constexpr uint32_t explicit_tiling = 0;
+constexpr uint32_t uniform_tiling = 1; // since version 2
+constexpr uint32_t untiled = 2; // since version 3
+
+// a string in the string pool
+struct StrRef {
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct Header {
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t version;
+    uint32_t no_models;
+    uint32_t no_layers;
+    uint32_t no_deps;
+    uint32_t reserved;
+    uint64_t no_dims;
+    StrRef args; // "args" object of the JSON, passed to the results as is
+    uint64_t models_offset;
+    uint64_t layers_offset;
+    uint64_t deps_offset;
+    uint64_t dims_offset;
+    uint64_t strings_offset;
+    uint64_t strings_size;
+    uint64_t file_size;
+};
+
+struct ModelRecord {
+    StrRef name;
+    int32_t no_repeat;
+    uint32_t first_layer;
+    uint32_t no_layers;
+    uint32_t reserved;
+    int64_t no_ops;
+};
+
+struct LayerRecord {
+    StrRef name;
+    StrRef layer_type;
+    int32_t raw_input;
+    int32_t has_gemm;
+    int32_t input_size[2];
+    int32_t weight_size[2];
+    int32_t no_tiles[3];
+    int32_t kernel_size[2]; // -1 if not a convolution
+    uint32_t first_dep;
+    uint32_t no_deps;
+    uint32_t tiling;
+    // first element of the tile dimensions in dims, see the encodings above
+    uint64_t x_dims;
+    uint64_t w_dims;
+};
+
+static_assert(sizeof(StrRef) == 8, "StrRef layout");
+static_assert(sizeof(Header) == 104, "Header layout");
+static_assert(sizeof(ModelRecord) == 32, "ModelRecord layout");
+static_assert(sizeof(LayerRecord) == 88, "LayerRecord layout");
+
+// Read-only memory mapping of a binary precompiled model. The records are
+// validated once when the file is opened.
+class ModelFile {
+    public:
+        explicit ModelFile(string const &path);
+        ModelFile(ModelFile const &) = delete;
+        ModelFile &operator=(ModelFile const &) = delete;
+        ~ModelFile();
+
+        Header const &header() const { return *header_; }
+        ModelRecord const &model(size_t i) const { return models_[i]; }
+        LayerRecord const &layer(size_t i) const { return layers_[i]; }
+        StrRef const &dep(size_t i) const { return deps_[i]; }
+        int32_t const *dims() const { return dims_; }
+        string_view str(StrRef ref) const { return string_view(strings_ + ref.offset, ref.size); }
+
+        size_t no_models() const { return header_->no_models; }
+
+        // index of the model, or no_models() if not found
+        size_t find_model(string_view name) const;
+
+    private:
+        void validate() const;
+
+        void *data_ {nullptr};
+        size_t size_ {0};
+
+        Header const *header_;
+        ModelRecord const *models_;
+        LayerRecord const *layers_;
+        StrRef const *deps_;
+        int32_t const *dims_;
+        char const *strings_;
+};
+
+// Writes the precompiled model JSON in the binary format.
+void write_model_file(json const &jin, string const &path);
+
+// true if the file starts with the binary model magic
+bool is_model_file(string const &path);
+
+} // namespace model_format
+
+#endif /* MODEL_FORMAT_HPP */
@@ -0,0 +1,319 @@
+#include "model_reader.hpp"
+
+#include <map>
+#include <stdexcept>
+
+namespace {
+
+typedef nlohmann::detail::json_sax_dom_parser<json> DomParser;
+
+// Builds the models from the SAX events of precompiled_model.json:
+//
+//   {"args": {...},
+//    "<model>": {"order": [...], "no_repeat": n,
+//                "layers": {"<layer>": {"gemm_op": {...} | null, "deps": [...], "raw_input": 0|1, "layer_type": "..."}}}}
+//
+// stack_ holds the enclosing containers with the current key or array index,
+// so stack_[d] locates a value at depth d + 1 of the document.
+class ModelSaxReader : public nlohmann::json_sax<json> {
+    public:
+        ModelSaxReader(json& args) : args_(args) {}
+        ~ModelSaxReader(){
+            for (auto& m: this->models_) delete m.second;
+            delete this->model_;
+            delete this->args_parser_;
+            delete this->layer_.x_tile_dims;
+            delete this->layer_.w_tile_dims;
+            delete this->layer_.dependencies;
+        }
+
+        vector<Model*> release_models(){
+            vector<Model*> models;
+            for (auto& m: this->models_) models.push_back(m.second);
+            this->models_.clear();
+            return models;
+        }
+
+        bool null() override {
+            this->element();
+            if (this->args_parser_ != nullptr) return this->args_parser_->null();
+            if (this->depth() == 1) this->top_level_scalar(json());
+            return true;
+        }
+
+        bool boolean(bool val) override {
+            this->element();
+            if (this->args_parser_ != nullptr) return this->args_parser_->boolean(val);
+            if (this->depth() == 1) this->top_level_scalar(json(val));
+            else this->number(val);
+            return true;
+        }
+
+        bool number_integer(number_integer_t val) override {
+            this->element();
+            if (this->args_parser_ != nullptr) return this->args_parser_->number_integer(val);
+            if (this->depth() == 1) this->top_level_scalar(json(val));
+            else this->number(val);
+            return true;
+        }
+
+        bool number_unsigned(number_unsigned_t val) override {
+            this->element();
+            if (this->args_parser_ != nullptr) return this->args_parser_->number_unsigned(val);
+            if (this->depth() == 1) this->top_level_scalar(json(val));
+            else this->number(val);
+            return true;
+        }
+
+        bool number_float(number_float_t val, const string_t& s) override {
+            this->element();
+            if (this->args_parser_ != nullptr) return this->args_parser_->number_float(val, s);
+            if (this->depth() == 1) this->top_level_scalar(json(val));
+            else this->number(val);
+            return true;
+        }
+
+        bool string(string_t& val) override {
+            this->element();
+            if (this->args_parser_ != nullptr) return this->args_parser_->string(val);
+            if (this->depth() == 1) this->top_level_scalar(json(val));
+            else if (this->depth() == 3 && this->key(1) == "order") this->order_.push_back(val);
+            else if (this->in_layer() && this->depth() == 4 && this->key(3) == "layer_type") this->layer_.layer_type = val;
+            else if (this->in_layer() && this->depth() == 5 && this->key(3) == "deps") this->layer_.dependencies->push_back(this->model_->model_name + ":" + val);
+            return true;
+        }
+
+        bool binary(binary_t& val) override {
+            this->element();
+            if (this->args_parser_ != nullptr) return this->args_parser_->binary(val);
+            return true;
+        }
+
+        bool start_object(std::size_t elements) override {
+            this->element();
+            if (this->depth() == 1 && this->key(0) == "args") this->args_parser_ = new DomParser(this->args_);
+
+            bool ok = true;
+            if (this->args_parser_ != nullptr) ok = this->args_parser_->start_object(elements);
+            else if (this->depth() == 1) this->start_model();
+            else if (this->in_layer() && this->depth() == 3) this->start_layer();
+            else if (this->in_layer() && this->depth() == 4 && this->key(3) == "gemm_op") this->layer_.has_gemm = true;
+
+            this->stack_.push_back(Frame{false, 0, 0, ""});
+            return ok;
+        }
+
+        bool key(string_t& val) override {
+            this->stack_.back().key = val;
+            if (this->args_parser_ != nullptr) return this->args_parser_->key(val);
+            return true;
+        }
+
+        bool end_object() override {
+            this->stack_.pop_back();
+            if (this->args_parser_ != nullptr) return this->end_args(this->args_parser_->end_object());
+            if (this->in_layer() && this->depth() == 3) this->finish_layer();
+            else if (this->depth() == 1) this->finish_model();
+            return true;
+        }
+
+        bool start_array(std::size_t elements) override {
+            this->element();
+            if (this->depth() == 1 && this->key(0) == "args") this->args_parser_ = new DomParser(this->args_);
+
+            bool ok = true;
+            if (this->args_parser_ != nullptr) ok = this->args_parser_->start_array(elements);
+            else if (this->depth() == 1) throw runtime_error("Model " + this->key(0) + " is not a JSON object.");
+
+            this->stack_.push_back(Frame{true, 0, 0, ""});
+            return ok;
+        }
+
+        bool end_array() override {
+            this->stack_.pop_back();
+            if (this->args_parser_ != nullptr) return this->end_args(this->args_parser_->end_array());
+            return true;
+        }
+
+        bool parse_error(std::size_t position, const std::string& last_token, const nlohmann::detail::exception& ex) override {
+            throw runtime_error("Precompiled model cannot be parsed: " + std::string(ex.what()));
+        }
+
+    private:
+        struct Frame {
+            bool array;
+            size_t index; // index of the current element of an array
+            size_t next;
+            std::string key; // current key of an object
+        };
+
+        // layer whose fields are being parsed
+        struct PendingLayer {
+            std::string name;
+            std::string layer_type;
+            bool has_gemm;
+            bool raw_input;
+            int input_size[2];
+            int weight_size[2];
+            int no_tiles[3];
+            int kernel_size[2];
+            bool has_tile_size;
+            int tile_size[3];
+            // explicit tile dims, allocated when the first entry is read; owned
+            // by the reader until the layer is built
+            tile_dim_map* x_tile_dims {nullptr};
+            tile_dim_map* w_tile_dims {nullptr};
+            list<std::string>* dependencies {nullptr};
+        };
+
+        size_t depth() const { return this->stack_.size(); }
+        std::string const& key(size_t d) const { return this->stack_[d].key; }
+        size_t index(size_t d) const { return this->stack_[d].index; }
+        // inside {"<model>": {"layers": ...}}
+        bool in_layer() const { return this->depth() >= 3 && this->model_ != nullptr && this->key(1) == "layers"; }
+
+        // a value starts, advance the index of the enclosing array
+        void element(){
+            if (!this->stack_.empty() && this->stack_.back().array){
+                this->stack_.back().index = this->stack_.back().next++;
+            }
+        }
+
+        void top_level_scalar(json val){
+            if (this->key(0) != "args") throw runtime_error("Model " + this->key(0) + " is not a JSON object.");
+            this->args_ = val;
+        }
+
+        bool end_args(bool ok){
+            if (this->depth() == 1){
+                delete this->args_parser_;
+                this->args_parser_ = nullptr;
+            }
+            return ok;
+        }
+
+        template <typename T>
+        void number(T val){
+            int v = (int) val;
+            if (this->model_ == nullptr) return;
+            if (this->depth() == 2 && this->key(1) == "no_repeat"){
+                this->model_->no_repeat = v;
+            }
+            if (!this->in_layer()) return;
+
+            if (this->depth() == 4 && this->key(3) == "raw_input"){
+                this->layer_.raw_input = v;
+            }
+            else if (this->depth() == 6 && this->key(3) == "gemm_op"){
+                std::string const& field = this->key(4);
+                size_t i = this->index(5);
+                if (field == "input_size" && i < 2) this->layer_.input_size[i] = v;
+                else if (field == "weight_size" && i < 2) this->layer_.weight_size[i] = v;
+                else if (field == "no_tiles" && i < 3) this->layer_.no_tiles[i] = v;
+                else if (field == "kernel_size" && i < 2) this->layer_.kernel_size[i] = v;
+                else if (field == "tile_size" && i < 3){
+                    this->layer_.has_tile_size = true;
+                    this->layer_.tile_size[i] = v;
+                }
+            }
+            else if (this->depth() == 8 && this->key(3) == "gemm_op" && (this->key(4) == "x_tile_dim" || this->key(4) == "w_tile_dim")){
+                tile_dim_map*& tile_dims = this->key(4) == "x_tile_dim" ? this->layer_.x_tile_dims : this->layer_.w_tile_dims;
+                if (tile_dims == nullptr) tile_dims = new tile_dim_map();
+                tuple<int, int>& dims = (*tile_dims)[make_tuple(stoi(this->key(5)), stoi(this->key(6)))];
+                if (this->index(7) == 0) get<0>(dims) = v;
+                else if (this->index(7) == 1) get<1>(dims) = v;
+            }
+        }
+
+        void start_model(){
+            this->model_ = new Model(this->key(0));
+            this->order_.clear();
+            this->parsed_.clear();
+            this->parsed_by_name_.clear();
+        }
+
+        void finish_model(){
+            for (auto& layer_name: this->order_){
+                auto it = this->parsed_by_name_.find(layer_name);
+                if (it == this->parsed_by_name_.end()){
+                    throw runtime_error("Layer " + layer_name + " of model " + this->model_->model_name + " is missing or repeated.");
+                }
+                this->model_->layer_list->splice(this->model_->layer_list->end(), this->parsed_, it->second);
+                this->parsed_by_name_.erase(it);
+            }
+
+            // a repeated model name replaces the earlier one, as in the JSON document
+            Model*& model = this->models_[this->model_->model_name];
+            delete model;
+            model = this->model_;
+            this->model_ = nullptr;
+        }
+
+        void start_layer(){
+            delete this->layer_.x_tile_dims;
+            delete this->layer_.w_tile_dims;
+            delete this->layer_.dependencies;
+            this->layer_ = PendingLayer{this->key(2), "", false, false, {0, 0}, {0, 0}, {0, 0, 0}, {-1, -1},
+                false, {0, 0, 0}, nullptr, nullptr, new list<std::string>()};
+        }
+
+        void finish_layer(){
+            PendingLayer& l = this->layer_;
+            bool is_conv = l.layer_type == "Conv2D";
+            tuple<int, int> conv_kernel_size = is_conv ? make_tuple(l.kernel_size[0], l.kernel_size[1]) : make_tuple(-1, -1);
+
+            tuple<int, int> input_size = make_tuple(l.input_size[0], l.input_size[1]);
+            tuple<int, int> weight_size = make_tuple(l.weight_size[0], l.weight_size[1]);
+
+            TileDims x_tile_dims;
+            TileDims w_tile_dims;
+            if (l.has_gemm && l.has_tile_size){
+                uniform_gemm_tiling(input_size, weight_size, make_tuple(l.tile_size[0], l.tile_size[1], l.tile_size[2]), x_tile_dims, w_tile_dims);
+                delete l.x_tile_dims;
+                delete l.w_tile_dims;
+            }
+            else if (l.has_gemm && l.no_tiles[0] == 0){
+                // untiled, the compiler tiles the layer for its arrays
+            }
+            else {
+                x_tile_dims = TileDims(l.x_tile_dims != nullptr ? l.x_tile_dims : new tile_dim_map());
+                w_tile_dims = TileDims(l.w_tile_dims != nullptr ? l.w_tile_dims : new tile_dim_map());
+            }
+            l.x_tile_dims = l.w_tile_dims = nullptr;
+
+            Layer layer(this->model_->model_name + ":" + l.name, x_tile_dims, w_tile_dims,
+                make_tuple(l.no_tiles[0], l.no_tiles[1], l.no_tiles[2]),
+                input_size, weight_size,
+                l.raw_input, is_conv, conv_kernel_size, l.dependencies);
+            l.dependencies = nullptr;
+            this->parsed_.push_back(std::move(layer));
+            this->parsed_by_name_[l.name] = prev(this->parsed_.end());
+        }
+
+        json& args_;
+        DomParser* args_parser_ {nullptr};
+
+        vector<Frame> stack_;
+
+        map<std::string, Model*> models_;
+        Model* model_ {nullptr};
+        vector<std::string> order_;
+        // layers in the order of "layers", moved into the model in the order of "order"
+        list<Layer> parsed_;
+        map<std::string, list<Layer>::iterator> parsed_by_name_;
+        PendingLayer layer_;
+};
+
+} // namespace
+
+vector<Model*> import_models(istream& in, json& args){
+    ModelSaxReader reader(args);
+    json::sax_parse(in, &reader);
+    return reader.release_models();
+}
+
+vector<Model*> import_models(string const& json_dump, json& args){
+    ModelSaxReader reader(args);
+    json::sax_parse(json_dump, &reader);
+    return reader.release_models();
+}
@@ -0,0 +1,24 @@
+#ifndef MODEL_READER_HPP
+#define MODEL_READER_HPP
+
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "layer.hpp"
+
+#include "nlohmann/json.hpp"
+
+using json = nlohmann::json;
+using namespace std;
+
+// Streaming import of precompiled_model.json. The layers are built from the
+// SAX events of the parser, the JSON document itself is never materialized;
+// only the (small) "args" object is kept.
+//
+// The models are returned in the order of the JSON object keys, which is the
+// order the compiler has always compiled them in. The caller owns them.
+vector<Model*> import_models(istream& in, json& args);
+vector<Model*> import_models(string const& json_dump, json& args);
+
+#endif /* MODEL_READER_HPP */
@@ -26,26 +26,6 @@ MultOp::MultOp(string layer_name, tuple<int, int, int> op_ind, X_Tile* x_tile, W
     this->is_finalop = false;
 }
 
-MultOp::MultOp(const MultOp& mult_op){
-    this->layer_name = mult_op.layer_name;
-    this->op_ind = mult_op.op_ind;
-    this->x_tile = new X_Tile(*(mult_op.x_tile));
-    this->x_tile->input_of->push_back(this);
-    this->w_tile = new W_Tile(*(mult_op.w_tile));
-    this->w_tile->input_of->push_back(this);
-    this->pout_tile = new P_Tile(*(mult_op.pout_tile));
-    this->pin_op = nullptr;
-    this->array_placed = nullptr;
-    this->aggregated_to = nullptr;
-    this->round_placed = -1;
-    this->is_placed_ = false;
-    this->pair_op = nullptr;
-
-    this->weight_buffer_cycles = get<0>(this->w_tile->dims);
-    this->retired = false;
-    this->is_multop = true;
-}
-
 void MultOp::retire(){
     this->retired = true;
 }
@@ -8,11 +8,6 @@
 
 #include "tiles.hpp"
 #include "post_processor.hpp"
-#include "serialize_tuple.h"
-
-#include <boost/serialization/map.hpp>
-#include <boost/archive/text_oarchive.hpp>
-#include <boost/archive/text_iarchive.hpp>
 
 using namespace std;
 
@@ -39,19 +34,9 @@ class Op{
         
         bool is_placed();
 
-        friend class boost::serialization::access;
-
-        template<class Archive>
-        void serialize(Archive & ar, const unsigned int version){
-            ar & this->layer_name;
-            ar & this->round_placed;
-            ar & this->op_ind;
-            ar & this->is_multop;
-            ar & this->pout_tile;
-            ar & this->pair_op;
-            ar & this->retired;
-            ar & this->is_placed_;
-        }
+        // saved and restored by the schedule file
+        friend class schedule_file::Writer;
+        friend class schedule_file::Reader;
 
     protected:
         bool is_placed_;
@@ -70,32 +55,12 @@ class MultOp: public Op{
 
         MultOp(){};
         MultOp(string layer_name, tuple<int, int, int> op_ind, X_Tile* x_tile, W_Tile* w_tile, P_Tile* pout_tile);
-        MultOp(const MultOp&);
+        MultOp(const MultOp&) = delete;
 
         void assign_pin(MultOp* pin_op);
         void assign_to_array(int r, Array* array);
 
         void retire();
-
-        friend class boost::serialization::access;
-
-        template<class Archive>
-        void serialize(Archive & ar, const unsigned int version){
-            ar & this->weight_buffer_cycles;
-            ar & this->x_tile;
-            ar & this->w_tile;
-            ar & this->pin_op;
-            ar & this->aggregated_to;
-            ar & this->array_placed;  
-            ar & this->layer_name;
-            ar & this->round_placed;
-            ar & this->op_ind;
-            ar & this->is_multop;
-            ar & this->pout_tile;
-            ar & this->pair_op;
-            ar & this->retired;
-            ar & this->is_placed_;          
-        }
 };
 
 class AggrOp: public Op{
@@ -123,26 +88,6 @@ class AggrOp: public Op{
         Op* get_op1();
         Op* get_op2();
         void set_pair(AggrOp* pair);
-
-        friend class boost::serialization::access;
-
-        template<class Archive>
-        void serialize(Archive & ar, const unsigned int version){
-            ar & this->pin1_tile;
-            ar & this->pin2_tile;
-            ar & this->operand1;
-            ar & this->operand2;
-            ar & this->flip;
-            ar & this->pp_placed;  
-            ar & this->layer_name;
-            ar & this->round_placed;
-            ar & this->op_ind;
-            ar & this->is_multop;
-            ar & this->pout_tile;
-            ar & this->pair_op;
-            ar & this->retired;
-            ar & this->is_placed_;          
-        }
 };
 
 #endif /* OPS_HPP */
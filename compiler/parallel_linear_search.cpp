@@ -8,7 +8,13 @@
 namespace bdata = boost::unit_test::data;
 
 #include <thread>
+#include <atomic>
 #include <chrono>
+#include <algorithm>
+#include <vector>
+#include <filesystem>
+#include <fstream>
+#include <optional>
 
 #include "parallel_linear_search.hpp"
 #include "ostream_mt.hpp"
@@ -268,3 +274,243 @@ BOOST_AUTO_TEST_CASE(case12_func_det_last)
     BOOST_TEST((bool) result);
     BOOST_TEST(result->idx == 1599);
 }
+
+struct range_job {
+    std::vector<double> const *durations;
+    std::vector<bool> const *results;
+
+    template <typename WorkerData>
+    bool operator()(std::size_t idx, WorkerData &worker_data) {
+        (void) worker_data;
+        std::this_thread::sleep_for(std::chrono::duration<double>((*durations)[idx] * 1e-3));
+        return (*results)[idx];
+    }
+};
+
+ParallelRangeSearch<range_job> prs(num_workers);
+
+// runs the range search and compares it against the sequential search
+void check_range_search(std::vector<double> const &durations, std::vector<bool> const &results) {
+    auto result = prs.search(results.size(), range_job{&durations, &results});
+
+    auto expected = std::find(results.begin(), results.end(), true);
+    BOOST_TEST((bool) result == (expected != results.end()));
+    if (result)
+        BOOST_TEST(result->idx == (std::size_t) (expected - results.begin()));
+}
+
+BOOST_AUTO_TEST_CASE(case13_range_det)
+{
+    std::vector<double> durations(1600);
+    for (int i = 0; i < 1600; ++i)
+        durations[i] = (i % 10) * 0.1;
+
+    for (int target: {0, 1, 800, 1590, 1599}) {
+        std::vector<bool> results(1600, false);
+        results[target] = true;
+        check_range_search(durations, results);
+
+        // multiple successes after the target
+        for (int i = target; i < 1600; ++i)
+            results[i] = true;
+        check_range_search(durations, results);
+    }
+
+    check_range_search(durations, std::vector<bool>(1600, false));
+    check_range_search(durations, std::vector<bool>(3, false));
+    check_range_search(durations, std::vector<bool>{});
+}
+
+BOOST_AUTO_TEST_CASE(case14_range_rand)
+{
+    auto rdgen = bdata::random();
+    auto random = [&, it = rdgen.begin()]() mutable { auto v = *it; ++it; return v; };
+
+    for (int trial = 0; trial < 20; ++trial) {
+        std::vector<double> durations(1600);
+        std::vector<bool> results(1600);
+        for (int i = 0; i < 1600; ++i) {
+            durations[i] = random() * 0.5;
+            results[i] = random() >= 0.99;
+        }
+        check_range_search(durations, results);
+    }
+}
+
+struct noop_job {
+    std::size_t payload[4];
+
+    template <typename WorkerData>
+    bool operator()(std::size_t idx, const WorkerData &worker_data) {
+        (void) worker_data;
+        return payload[idx % 4] == (std::size_t) -1;
+    }
+};
+
+// the task that succeeds in round r, none in every other round
+std::size_t benchmark_hit(std::size_t r, std::size_t num_tasks) {
+    return r % 2 ? (r * 7919) % num_tasks : num_tasks;
+}
+
+// measures the scheduling overhead of the task storage with trivial tasks,
+// the index found in every round is appended to found
+template <typename PLS>
+double tasks_per_second(PLS &search, std::size_t num_tasks, std::size_t num_rounds,
+                        std::vector<std::optional<std::size_t>> &found) {
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t r = 0; r < num_rounds; ++r) {
+        std::size_t hit = benchmark_hit(r, num_tasks);
+        search.begin(num_tasks);
+        for (std::size_t i = 0; search.should_continue() && i < num_tasks; ++i) {
+            if (i == hit) search.append_job(noop_job{{(std::size_t) -1, (std::size_t) -1, (std::size_t) -1, (std::size_t) -1}});
+            else search.append_job(noop_job{{i, i + 1, i + 2, i + 3}});
+        }
+        search.end();
+        auto result = search.result();
+        found.push_back(result ? std::optional<std::size_t>{result->idx} : std::nullopt);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return num_tasks * num_rounds / elapsed.count();
+}
+
+BOOST_AUTO_TEST_CASE(case15_benchmark_task_storage)
+{
+    const std::size_t bench_workers = std::max(2u, std::thread::hardware_concurrency());
+    ParallelLinearSearch<noop_job, Empty, CancellableQueue> list_pls(bench_workers);
+    ParallelLinearSearch<noop_job, Empty, CancellableRingQueue> ring_pls(bench_workers);
+    std::vector<std::optional<std::size_t>> list_found, ring_found;
+
+    // warm up, so that the ring buffer is already sized
+    tasks_per_second(list_pls, 10000, 1, list_found);
+    tasks_per_second(ring_pls, 10000, 1, ring_found);
+    list_found.clear();
+    ring_found.clear();
+
+    auto list_rate = tasks_per_second(list_pls, 10000, 20, list_found);
+    auto ring_rate = tasks_per_second(ring_pls, 10000, 20, ring_found);
+
+    print(cout_mt()).ln("tasks per second, std::list storage: ", list_rate);
+    print(cout_mt()).ln("tasks per second, ring buffer storage: ", ring_rate);
+
+    // the ring buffer finds the same tasks as the std::list storage
+    std::vector<std::optional<std::size_t>> expected;
+    for (std::size_t r = 0; r < 20; ++r) {
+        std::size_t hit = benchmark_hit(r, 10000);
+        expected.push_back(hit < 10000 ? std::optional<std::size_t>{hit} : std::nullopt);
+    }
+    BOOST_TEST((list_found == expected));
+    BOOST_TEST((ring_found == expected));
+}
+
+BOOST_AUTO_TEST_CASE(case16_cpu_topology)
+{
+    BOOST_TEST((parse_cpu_list("0-3,8,10-11\n") == std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+
+    // two nodes of two cores with two hardware threads each
+    auto root = std::filesystem::temp_directory_path() / "pls_test_sysfs";
+    std::filesystem::remove_all(root);
+    auto write = [&](std::string const &path, std::string const &content) {
+        std::filesystem::create_directories((root / path).parent_path());
+        std::ofstream{root / path} << content << "\n";
+    };
+    write("node/node0/cpulist", "0-1,4-5");
+    write("node/node1/cpulist", "2-3,6-7");
+    for (int cpu = 0; cpu < 8; ++cpu) {
+        write("cpu/cpu" + std::to_string(cpu) + "/topology/thread_siblings_list",
+              std::to_string(cpu % 4) + "," + std::to_string(cpu % 4 + 4));
+    }
+
+    auto topology = CpuTopology::detect(root.string(), {});
+
+    BOOST_TEST(topology.nodes.size() == 2);
+    BOOST_TEST(topology.num_cpus() == 8);
+    BOOST_TEST(topology.num_physical_cores() == 4);
+    BOOST_TEST((topology.worker_cpus(5) == std::vector<int>{0, 1, 4, 5, 2}));
+    BOOST_TEST((topology.worker_cpus(9) == std::vector<int>{0, 1, 4, 5, 2, 3, 6, 7, 0}));
+
+    // only the cpus of the affinity mask, a sibling stands in for its core
+    auto restricted = CpuTopology::detect(root.string(), {2, 3, 5, 6});
+    std::filesystem::remove_all(root);
+    BOOST_TEST(restricted.nodes.size() == 2);
+    BOOST_TEST(restricted.num_cpus() == 4);
+    BOOST_TEST(restricted.num_physical_cores() == 3);
+    BOOST_TEST((restricted.worker_cpus(4) == std::vector<int>{5, 2, 3, 6}));
+
+    // falls back to a single node of the allowed cpus without sysfs
+    auto fallback = CpuTopology::detect(root.string(), {1, 3});
+    BOOST_TEST(fallback.nodes.size() == 1);
+    BOOST_TEST(fallback.num_cpus() == 2);
+    BOOST_TEST(fallback.num_physical_cores() == 2);
+    auto unknown = CpuTopology::detect(root.string(), {});
+    BOOST_TEST(unknown.num_cpus() == std::max(1u, std::thread::hardware_concurrency()));
+    BOOST_TEST(CpuTopology::detect(root.string()).num_cpus() == allowed_cpus().size());
+}
+
+struct ThreadIdData {
+    std::thread::id thread_id;
+    int cpu = -1;
+};
+
+struct check_thread_job {
+    bool operator()(std::size_t idx, const ThreadIdData &worker_data) {
+        // the task runs on the thread that initialized the worker data
+        return worker_data.thread_id != std::this_thread::get_id() || idx == 37;
+    }
+};
+
+BOOST_AUTO_TEST_CASE(case17_pinned_workers)
+{
+    ParallelLinearSearch<check_thread_job, ThreadIdData> pinned(4, {0});
+    pinned.run_on_workers([](ThreadIdData &data, std::size_t) {
+        data.thread_id = std::this_thread::get_id();
+#ifdef __linux__
+        data.cpu = sched_getcpu();
+#endif
+    });
+
+    for (std::size_t i = 0; i < pinned.num_workers(); ++i) {
+        BOOST_TEST((pinned.worker_data(i).thread_id != std::this_thread::get_id()));
+#ifdef __linux__
+        BOOST_TEST(pinned.worker_data(i).cpu == 0);
+#endif
+    }
+
+    pinned.begin(100);
+    for (std::size_t i = 0; pinned.should_continue() && i < 100; ++i) {
+        pinned.append_job(check_thread_job{});
+    }
+    pinned.end();
+    auto result = pinned.result();
+    BOOST_TEST(result.has_value());
+    BOOST_TEST(result->idx == 37);
+}
+
+BOOST_AUTO_TEST_CASE(case18_range_pinned_workers)
+{
+    ParallelRangeSearch<check_thread_job, ThreadIdData> pinned(4, {0});
+    pinned.run_on_workers([](ThreadIdData &data, std::size_t) {
+        data.thread_id = std::this_thread::get_id();
+#ifdef __linux__
+        data.cpu = sched_getcpu();
+#endif
+    });
+
+    for (std::size_t i = 0; i < pinned.num_workers(); ++i) {
+        BOOST_TEST((pinned.worker_data(i).thread_id != std::this_thread::get_id()));
+#ifdef __linux__
+        BOOST_TEST(pinned.worker_data(i).cpu == 0);
+#endif
+    }
+
+    // the workers still search after running a function, and run one after a search
+    for (int trial = 0; trial < 2; ++trial) {
+        auto result = pinned.search(100, check_thread_job{});
+        BOOST_TEST(result.has_value());
+        BOOST_TEST(result->idx == 37);
+        std::atomic<int> other_threads{0};
+        pinned.run_on_workers([&](ThreadIdData &data, std::size_t) {
+            if (data.thread_id != std::this_thread::get_id()) ++other_threads;
+        });
+        BOOST_TEST(other_threads == 0);
+    }
+}
@@ -12,20 +12,25 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <algorithm>
+#include <atomic>
+#include <deque>
 #include <list>
 #include <vector>
 #include <sstream>
 #include <memory>
-#include <functional>
 #include <type_traits>
 #include <optional>
-#include <any>
+#include <functional>
 #include <cassert>
 
+#include "cpu_topology.hpp"
+
 /**
  * 
- * TODO I may optimize the code further by revoking the use of std::function<> and
- * std::any, both of which rely on heap allocations.
+ * Closures are template parameters and tasks are stored in place, so no
+ * std::function<> or std::any (and their heap allocations) is involved per
+ * task.
  * 
  */
 
@@ -68,7 +73,8 @@ struct CancellableQueue {
     }
 
     // should be called before execution
-    void reset() {
+    // the list grows per task, the capacity is not used
+    void reset(std::size_t = 0) {
         std::lock_guard<std::mutex> lock{mtx_};
         cancel_ = false;
         tasks_.clear();
@@ -79,7 +85,7 @@ struct CancellableQueue {
     void emplace_back(Args && ...args) {
         std::lock_guard<std::mutex> lock{mtx_};
         assert(!cancel_ || "reset() the queue first!");
-        tasks_.emplace_back(std::forward<Args>(args)...);
+        tasks_.push_back(Task{std::forward<Args>(args)...});
         cv_.notify_all();
     }
 
@@ -111,6 +117,86 @@ private:
     std::condition_variable cv_;
 };
 
+/**
+ * 
+ * Same as CancellableQueue, but the tasks are stored in place in a ring
+ * buffer. Once the buffer is sized to the number of tasks, there are no heap
+ * allocations per task, and the tasks are moved in and out instead of copied.
+ * 
+ */
+template <typename Task>
+struct CancellableRingQueue {
+    CancellableRingQueue() {
+        reset();
+    }
+
+    // should be called before execution
+    // capacity is the number of tasks that fit without growing the buffer
+    void reset(std::size_t capacity = 0) {
+        std::lock_guard<std::mutex> lock{mtx_};
+        cancel_ = false;
+        head_ = 0;
+        size_ = 0;
+        if (capacity > tasks_.size()) {
+            tasks_.resize(capacity);
+        }
+    }
+
+    // adds a new task to the queue
+    template <typename ...Args>
+    void emplace_back(Args && ...args) {
+        std::lock_guard<std::mutex> lock{mtx_};
+        assert(!cancel_ || "reset() the queue first!");
+        if (size_ == tasks_.size()) {
+            grow();
+        }
+        tasks_[(head_ + size_) % tasks_.size()] = Task{std::forward<Args>(args)...};
+        ++size_;
+        cv_.notify_one();
+    }
+
+    // pops a task from the queue. if the queue is empty, waits until:
+    //   1. a new item is added
+    //   2. the queue is cancelled
+    std::optional<Task> pop_front() {
+        std::unique_lock<std::mutex> lock{mtx_};
+        cv_.wait(lock, [this]{ return size_ > 0 || cancel_; });
+        if (cancel_) {
+            return {};
+        }
+        std::optional<Task> popped{std::move(tasks_[head_])};
+        head_ = (head_ + 1) % tasks_.size();
+        --size_;
+        return popped;
+    }
+
+    // removes all the tasks and sends an null task to the waiting threads.
+    void cancel() {
+        std::lock_guard<std::mutex> lock{mtx_};
+        head_ = 0;
+        size_ = 0;
+        cancel_ = true;
+        cv_.notify_all();
+    }
+private:
+    // doubles the capacity, only when more tasks than announced are added
+    void grow() {
+        std::vector<Task> tasks(std::max<std::size_t>(16, 2 * tasks_.size()));
+        for (std::size_t i = 0; i < size_; ++i) {
+            tasks[i] = std::move(tasks_[(head_ + i) % tasks_.size()]);
+        }
+        tasks_.swap(tasks);
+        head_ = 0;
+    }
+
+    std::vector<Task> tasks_;
+    std::size_t head_;
+    std::size_t size_;
+    bool cancel_;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+};
+
 struct Empty {};
 
 /**
@@ -119,19 +205,24 @@ struct Empty {};
  * It outputs exactly the same result as the sequential linear search.
  * 
  */
-template <typename ClosureType, typename WorkerData = Empty>
+template <typename ClosureType, typename WorkerData = Empty,
+          template <typename> class TaskQueue = CancellableRingQueue>
 struct ParallelLinearSearch {
     // closure type should have:
     //   - bool operator()(std::size_t idx, WorkerData const &worker_data)
+    // TaskQueue is CancellableRingQueue, or CancellableQueue for the list based
+    // storage
 
     /**
      * @param num_workers Number of worker threads running in parallel.
+     * @param cpus If not empty, worker i is pinned to cpus[i % cpus.size()].
      */
-    ParallelLinearSearch(std::size_t num_workers):
+    ParallelLinearSearch(std::size_t num_workers, std::vector<int> const &cpus = {}):
         shared_state_{num_workers} {
         // generate the workers
         for (std::size_t i = 0; i < num_workers; ++i) {
-            workers_.emplace_back(std::make_unique<Worker>(shared_state_, i));
+            int cpu = cpus.empty() ? -1 : cpus[i % cpus.size()];
+            workers_.emplace_back(std::make_unique<Worker>(shared_state_, i, cpu));
         }
     }
 
@@ -149,6 +240,15 @@ struct ParallelLinearSearch {
         return (*workers_[i]);
     }
 
+    // Runs f(worker_data(i), i) on the thread of each worker i and waits for
+    // all of them. Memory allocated by f is first touched by the worker, so it
+    // is placed on the worker's NUMA node when the worker is pinned.
+    // Must not be called between begin() and end().
+    void run_on_workers(std::function<void(WorkerData &, std::size_t)> f) {
+        for (auto &worker: workers_) worker->run(f);
+        for (auto &worker: workers_) worker->wait_run();
+    }
+
     // whether or not continue (false if success)
     bool should_continue() const {
         return !shared_state_.success();
@@ -157,13 +257,15 @@ struct ParallelLinearSearch {
     // Assigns a new job to workers.
     template <typename T>
     void append_job(T &&t) {
-        shared_state_.task_queue.emplace_back(Task{std::move(t), false, num_tasks_});
+        shared_state_.task_queue.emplace_back(std::forward<T>(t), false, num_tasks_);
         ++num_tasks_;
     }
 
     // Starts execution.
-    void begin() {
-        shared_state_.reset();
+    // num_candidates is an upper bound of the jobs to be appended, used to
+    // size the task storage up front.
+    void begin(std::size_t num_candidates = 0) {
+        shared_state_.reset(num_candidates + num_workers());
         num_tasks_ = 0;
         for (auto &worker: workers_) worker->start();
     }
@@ -172,7 +274,7 @@ struct ParallelLinearSearch {
     void end() {
         // add invalid jobs that stop the worker
         for (std::size_t i = 0; i < num_workers(); ++i)
-            shared_state_.task_queue.emplace_back(Task{{}, true, 0});
+            shared_state_.task_queue.emplace_back(ClosureType{}, true, std::size_t{0});
         
         shared_state_.join_workers();
     }
@@ -206,21 +308,22 @@ private:
     };
 
     struct SharedState {
-        CancellableQueue<Task> task_queue;
+        TaskQueue<Task> task_queue;
 
         SharedState(std::size_t num_workers):
             num_workers_{num_workers} {
         }
 
         // Resets the shared state
-        void reset() {
+        void reset(std::size_t capacity) {
             completion_array_.clear();
+            completion_array_.reserve(capacity);
             num_contiguous_completed_from_beginning_ = 0;
             done_ = false;
             success_ = false;
             success_idx_ = 0;
             num_remaining_workers_ = num_workers_;
-            task_queue.reset();
+            task_queue.reset(capacity);
         }
 
         // informs the shared state that one of the workers have found a result
@@ -305,8 +408,9 @@ private:
         std::vector<int> completion_array_;
 
         std::size_t num_contiguous_completed_from_beginning_;
-        bool done_;
-        bool success_;
+        // read without the lock by the producer (should_continue)
+        std::atomic<bool> done_;
+        std::atomic<bool> success_;
         std::size_t success_idx_;
         ClosureType success_closure_;
         std::mutex mtx_;
@@ -321,21 +425,32 @@ private:
     SharedState shared_state_;
 
     struct Worker: WorkerData /* Empty Base Class Optimization */ {
-        Worker(SharedState &shared_state, std::size_t idx): start_{false}, quit_{false} {
-            thread_ = std::thread([&, idx] {
+        Worker(SharedState &shared_state, std::size_t idx, int cpu = -1): start_{false}, quit_{false} {
+            thread_ = std::thread([&, idx, cpu] {
                 DEBUG_WORKER("start_worker");
 
+                if (cpu >= 0 && !pin_current_thread(cpu)) {
+                    DEBUG_WORKER("cannot pin to cpu ", cpu);
+                }
+
                 while (true) {
 
-                    // wait until started or quit requested
+                    // wait until started, a function is given or quit requested
                     std::unique_lock<std::mutex> lock{mtx_};
-                    cv_.wait(lock, [this] { return start_ || quit_; });
+                    cv_.wait(lock, [this] { return start_ || quit_ || run_; });
 
                     if (quit_) {
                         DEBUG_WORKER("quit");
                         return ;
                     }
 
+                    if (run_) {
+                        run_(*this, idx);
+                        run_ = nullptr;
+                        cv_.notify_all();
+                        continue ;
+                    }
+
                     DEBUG_WORKER("start");
                     
                     while (true) {
@@ -384,6 +499,19 @@ private:
             cv_.notify_all();
         }
 
+        // Makes the worker call f on its thread.
+        void run(std::function<void(WorkerData &, std::size_t)> f) {
+            std::lock_guard<std::mutex> lock{mtx_};
+            run_ = std::move(f);
+            cv_.notify_all();
+        }
+
+        // Waits until the function given to run() returns.
+        void wait_run() {
+            std::unique_lock<std::mutex> lock{mtx_};
+            cv_.wait(lock, [this] { return !run_; });
+        }
+
         // Signals that the worker should quit.
         void quit() {
             std::lock_guard<std::mutex> lock{mtx_};
@@ -406,12 +534,295 @@ private:
 
         // quit flag
         bool quit_;
+
+        // function to be run on the worker thread
+        std::function<void(WorkerData &, std::size_t)> run_;
     };
 
     std::size_t num_tasks_;
     std::vector<std::unique_ptr<Worker>> workers_;
 };
 
+/**
+ *
+ * Parallel linear search over a candidate space [0, n) that is known up front.
+ * It outputs exactly the same result as the sequential linear search.
+ *
+ * Chunks of indices are handed out in increasing order through an atomic
+ * counter. A worker splits its chunk into pieces on its own deque, processes
+ * them from the front, and idle workers steal pieces from the back. The lowest
+ * successful index is kept as an atomic minimum; indices beyond it are skipped.
+ * No lock is taken per index, only per piece.
+ *
+ */
+template <typename ClosureType, typename WorkerData = Empty>
+struct ParallelRangeSearch {
+    // closure type should have:
+    //   - bool operator()(std::size_t idx, WorkerData &worker_data)
+    // every worker runs its own copy of the closure
+
+    /**
+     * @param num_workers Number of worker threads running in parallel.
+     * @param cpus If not empty, worker i is pinned to cpus[i % cpus.size()].
+     */
+    ParallelRangeSearch(std::size_t num_workers, std::vector<int> const &cpus = {}) {
+        for (std::size_t i = 0; i < num_workers; ++i) {
+            int cpu = cpus.empty() ? -1 : cpus[i % cpus.size()];
+            workers_.emplace_back(std::make_unique<Worker>(*this, i, cpu));
+        }
+    }
+
+    // returns the number of workers.
+    std::size_t num_workers() const {
+        return workers_.size();
+    }
+
+    // gets the worker specific data
+    WorkerData &worker_data(std::size_t i) {
+        return (*workers_[i]);
+    }
+
+    WorkerData const &worker_data(std::size_t i) const {
+        return (*workers_[i]);
+    }
+
+    // Runs f(worker_data(i), i) on the thread of each worker i and waits for
+    // all of them, see ParallelLinearSearch::run_on_workers.
+    // Must not be called during search().
+    void run_on_workers(std::function<void(WorkerData &, std::size_t)> f) {
+        for (auto &worker: workers_) worker->run(f);
+        for (auto &worker: workers_) worker->wait_run();
+    }
+
+    struct ResultType {
+        std::size_t idx;
+        ClosureType closure;
+    };
+
+    // Evaluates closure(idx, worker_data) for idx in [0, num_candidates) and
+    // returns the lowest idx for which it holds, with the closure that found it.
+    std::optional<ResultType> search(std::size_t num_candidates, ClosureType const &closure) {
+        if (num_candidates == 0) {
+            return {};
+        }
+
+        num_candidates_ = num_candidates;
+        chunk_ = std::max<std::size_t>(1, num_candidates / (num_workers() * 4));
+        piece_ = std::max<std::size_t>(1, chunk_ / 4);
+        next_.store(0);
+        best_.store(num_candidates);
+        success_closure_.reset();
+        closure_ = &closure;
+
+        {
+            std::lock_guard<std::mutex> lock{mtx_join_};
+            num_remaining_workers_ = num_workers();
+        }
+        for (auto &worker: workers_) worker->start();
+
+        std::unique_lock<std::mutex> lock{mtx_join_};
+        cv_join_.wait(lock, [this] { return num_remaining_workers_ == 0; });
+
+        if (success_closure_) {
+            return ResultType{success_idx_, std::move(*success_closure_)};
+        }
+        return {};
+    }
+
+    ~ParallelRangeSearch() {
+        for (auto &worker: workers_) worker->quit();
+    }
+private:
+    struct Range {
+        std::size_t begin;
+        std::size_t end;
+    };
+
+    struct Worker: WorkerData /* Empty Base Class Optimization */ {
+        // owner pops from the front, thieves from the back
+        std::deque<Range> ranges;
+        std::mutex mtx_ranges;
+
+        Worker(ParallelRangeSearch &search, std::size_t idx, int cpu = -1): start_{false}, quit_{false} {
+            thread_ = std::thread([&, idx, cpu] {
+                if (cpu >= 0 && !pin_current_thread(cpu)) {
+                    DEBUG_WORKER("cannot pin to cpu ", cpu);
+                }
+
+                while (true) {
+                    {
+                        // wait until started, a function is given or quit requested
+                        std::unique_lock<std::mutex> lock{mtx_};
+                        cv_.wait(lock, [this] { return start_ || quit_ || run_; });
+
+                        if (quit_) {
+                            return ;
+                        }
+
+                        if (run_) {
+                            run_(*this, idx);
+                            run_ = nullptr;
+                            cv_.notify_all();
+                            continue ;
+                        }
+
+                        start_ = false;
+                    }
+
+                    search.run(idx);
+                    search.inform_worker_done();
+                }
+            });
+        }
+
+        // Starts the worker.
+        void start() {
+            std::lock_guard<std::mutex> lock{mtx_};
+            start_ = true;
+            cv_.notify_all();
+        }
+
+        // Makes the worker call f on its thread.
+        void run(std::function<void(WorkerData &, std::size_t)> f) {
+            std::lock_guard<std::mutex> lock{mtx_};
+            run_ = std::move(f);
+            cv_.notify_all();
+        }
+
+        // Waits until the function given to run() returns.
+        void wait_run() {
+            std::unique_lock<std::mutex> lock{mtx_};
+            cv_.wait(lock, [this] { return !run_; });
+        }
+
+        // Signals that the worker should quit.
+        void quit() {
+            std::lock_guard<std::mutex> lock{mtx_};
+            quit_ = true;
+            cv_.notify_all();
+        }
+
+        ~Worker() {
+            if (thread_.joinable())
+                thread_.join();
+        }
+    private:
+        std::thread thread_;
+        std::mutex mtx_;
+        std::condition_variable cv_;
+
+        // start flag
+        // we need this in case of spurious wake ups
+        bool start_;
+
+        // quit flag
+        bool quit_;
+
+        // function to be run on the worker thread
+        std::function<void(WorkerData &, std::size_t)> run_;
+    };
+
+    // the search loop of worker i
+    void run(std::size_t i) {
+        auto &worker = *workers_[i];
+        std::optional<ClosureType> closure{*closure_};
+
+        Range range;
+        while (next_range(i, range)) {
+            for (std::size_t idx = range.begin; idx < range.end; ++idx) {
+                // cancelled, a lower index has already succeeded
+                if (idx >= best_.load(std::memory_order_acquire)) {
+                    break ;
+                }
+
+                if ((*closure)(idx, worker)) {
+                    inform_success(idx, std::move(*closure));
+                    closure.emplace(*closure_);
+                    break ;
+                }
+            }
+        }
+    }
+
+    // takes a range from the own deque, then from the shared counter, and
+    // finally from the back of another worker's deque
+    bool next_range(std::size_t i, Range &range) {
+        auto &worker = *workers_[i];
+        {
+            std::lock_guard<std::mutex> lock{worker.mtx_ranges};
+            if (!worker.ranges.empty()) {
+                range = worker.ranges.front();
+                worker.ranges.pop_front();
+                return true;
+            }
+        }
+
+        auto begin = next_.fetch_add(chunk_, std::memory_order_relaxed);
+        if (begin < best_.load(std::memory_order_acquire)) {
+            auto end = std::min(begin + chunk_, num_candidates_);
+            range = Range{begin, std::min(begin + piece_, end)};
+
+            std::lock_guard<std::mutex> lock{worker.mtx_ranges};
+            for (auto b = range.end; b < end; b += piece_) {
+                worker.ranges.push_back(Range{b, std::min(b + piece_, end)});
+            }
+            return true;
+        }
+
+        for (std::size_t k = 1; k < num_workers(); ++k) {
+            auto &victim = *workers_[(i + k) % num_workers()];
+            std::lock_guard<std::mutex> lock{victim.mtx_ranges};
+            if (!victim.ranges.empty()) {
+                range = victim.ranges.back();
+                victim.ranges.pop_back();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void inform_success(std::size_t idx, ClosureType &&closure) {
+        // atomic min, so that the other workers stop beyond idx right away
+        auto best = best_.load();
+        while (idx < best && !best_.compare_exchange_weak(best, idx)) {}
+
+        std::lock_guard<std::mutex> lock{mtx_success_};
+        if (!success_closure_ || idx < success_idx_) {
+            success_idx_ = idx;
+            success_closure_.emplace(std::move(closure));
+        }
+    }
+
+    void inform_worker_done() {
+        std::lock_guard<std::mutex> lock{mtx_join_};
+        --num_remaining_workers_;
+        cv_join_.notify_all();
+    }
+
+    ClosureType const *closure_ = nullptr;
+    std::size_t num_candidates_ = 0;
+    std::size_t chunk_ = 1;
+    std::size_t piece_ = 1;
+
+    // first index that has not been handed out yet
+    std::atomic<std::size_t> next_{0};
+
+    // lowest successful index, num_candidates_ if none
+    std::atomic<std::size_t> best_{0};
+
+    std::size_t success_idx_ = 0;
+    std::optional<ClosureType> success_closure_;
+    std::mutex mtx_success_;
+
+    // for joining the workers
+    std::size_t num_remaining_workers_ = 0;
+    std::condition_variable cv_join_;
+    std::mutex mtx_join_;
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+};
+
 }
 
 #endif // PARALLEL_LINEAR_SEARCH_HPP_INCLUDED
@@ -25,10 +25,24 @@ void PostProcessor::update(){
         else{
             this->state = PP_STATE::done;
             this->curr_op->retire();
+            if (this->trace != nullptr) this->trace->record(trace::EventType::pp_idle);
         }
     }
 }
 
+void PostProcessor::reset(){
+    this->state = PP_STATE::idle;
+    this->exec_cnt = 0;
+    this->pin1_tile = nullptr;
+    this->pin2_tile = nullptr;
+    this->pout_tile = nullptr;
+    this->curr_op = nullptr;
+
+    this->no_add_ops = 0;
+    this->sram_read_bytes = 0;
+    this->sram_write_bytes = 0;
+}
+
 void PostProcessor::init_tile_op(int r){
     if (this->get_op(r) == nullptr) return;
 
@@ -38,6 +52,7 @@ void PostProcessor::init_tile_op(int r){
 
     this->exec_cnt = 0;
     this->state = PP_STATE::processing;
+    if (this->trace != nullptr) this->trace->record(trace::EventType::pp_busy, r);
     this->curr_op = this->get_op(r);
     this->pin1_tile = this->curr_op->pin1_tile;
     this->pin2_tile = this->curr_op->pin2_tile;
@@ -135,7 +150,7 @@ list<PostProcessor*>* PostProcessors::available_pps(int r){
 }
 
 bool PostProcessors::check_pin1_bank_conflict(int r, P_Tile* p_tile){
-    list<AggrOp*>* schedule = this->get_schedule(r);
+    unique_ptr< list<AggrOp*> > schedule (this->get_schedule(r));
     for (auto it = schedule->begin(); it != schedule->end(); it++){
         if ((*it) != nullptr){
             if (p_tile->bank == (*it)->get_op1()->pout_tile->bank){
@@ -143,13 +158,11 @@ bool PostProcessors::check_pin1_bank_conflict(int r, P_Tile* p_tile){
             }
         }
     }
-
-    delete schedule;
     return false;
 }
 
 bool PostProcessors::check_pin2_bank_conflict(int r, P_Tile* p_tile){
-    list<AggrOp*>* schedule = this->get_schedule(r);
+    unique_ptr< list<AggrOp*> > schedule (this->get_schedule(r));
     for (auto it = schedule->begin(); it != schedule->end(); it++){
         if ((*it) != nullptr){
             if (p_tile->bank == (*it)->get_op2()->pout_tile->bank){
@@ -157,13 +170,11 @@ bool PostProcessors::check_pin2_bank_conflict(int r, P_Tile* p_tile){
             }
         }
     }
-
-    delete schedule;
     return false;
 }
 
 bool PostProcessors::check_pout_bank_conflict(int r, P_Tile* p_tile){
-    list<AggrOp*>* schedule = this->get_schedule(r);
+    unique_ptr< list<AggrOp*> > schedule (this->get_schedule(r));
     for (auto it = schedule->begin(); it != schedule->end(); it++){
         if ((*it) != nullptr){
             if (p_tile->bank == (*it)->pout_tile->bank){
@@ -172,7 +183,6 @@ bool PostProcessors::check_pout_bank_conflict(int r, P_Tile* p_tile){
         }
     }
     
-    delete schedule;
     return false;
 }
 
@@ -233,6 +243,12 @@ void PostProcessors::update(){
     }
 }
 
+void PostProcessors::reset(){
+    for (auto it = this->pp_map->begin(); it != this->pp_map->end(); it++){
+        it->second->reset();
+    }
+}
+
 list<P_Tile*>* PostProcessors::get_pin1_tiles(int r){
     list<P_Tile*>* pin1_tiles = new list<P_Tile*>();
 
@@ -3,14 +3,12 @@
 
 #include <map>
 #include <list>
+#include <memory>
 
 #include "ops.hpp"
+#include "trace.hpp"
 
 
-#include <boost/serialization/map.hpp>
-#include <boost/archive/text_oarchive.hpp>
-#include <boost/archive/text_iarchive.hpp>
-
 using namespace std;
 
 class AggrOp;
@@ -38,6 +36,8 @@ class PostProcessor{
 
         AggrOp* curr_op;
 
+        trace::Ring* trace {nullptr};
+
         PostProcessor(){};
         PostProcessor(int id);
 
@@ -50,20 +50,13 @@ class PostProcessor{
         bool is_idle();
         
         void update();
+        // returns the state and the counters of the cycle model to those of
+        // the constructor, the schedule is kept
+        void reset();
 
-        friend class boost::serialization::access;
-
-        template<class Archive>
-        void serialize(Archive & ar, const unsigned int version){
-            ar & this->id;
-            ar & this->last_no_round;
-            ar & this->state;
-            ar & this->exec_cnt;
-            ar & this->pin1_tile;
-            ar & this->pin2_tile;
-            ar & this->pout_tile;
-            ar & this->schedule;
-        }
+        // saved and restored by the schedule file
+        friend class schedule_file::Writer;
+        friend class schedule_file::Reader;
     private:
         map<int, AggrOp*> schedule;
 };
@@ -102,14 +95,7 @@ class PostProcessors{
         bool is_tile_op_done(int r);
 
         void update();
-
-        friend class boost::serialization::access;
-
-        template<class Archive>
-        void serialize(Archive & ar, const unsigned int version){
-            ar & this->no_pps;
-            ar & this->pp_map;
-        }
+        void reset();
     private:
 
         
@@ -0,0 +1,79 @@
+#include "profile.hpp"
+
+namespace profile {
+
+Profile::Profile(){
+    this->reset();
+}
+
+void Profile::reset(){
+    for (auto& counter: this->counters) counter = 0;
+    for (auto& counter: this->apply_permute) counter = 0;
+    for (auto& counter: this->is_route_free) counter = 0;
+    for (auto& seconds: this->seconds) seconds = 0;
+    this->compile_layer_seconds.clear();
+}
+
+json Profile::to_json() const {
+    auto count = [this](Counter counter){ return this->counters[counter].load(); };
+
+    json jout;
+    jout["op_placement"] = {
+        {"attempts", count(op_attempts)},
+        {"placed", count(op_placed)},
+        {"failures", {
+            {"no_array", count(op_no_array)},
+            {"bank_conflict", count(op_bank_conflict)},
+            {"no_bank", count(op_no_bank)},
+            {"route_blocked", count(op_route_blocked)}}}};
+    jout["post_op_placement"] = {
+        {"attempts", count(post_op_attempts)},
+        {"placed", count(post_op_placed)},
+        {"failures", {
+            {"no_post_processor", count(post_op_no_pp)},
+            {"bank_conflict", count(post_op_bank_conflict)},
+            {"no_bank", count(post_op_no_bank)},
+            {"route_blocked", count(post_op_route_blocked)}}}};
+
+    // candidates never evaluated were cancelled by an earlier success
+    jout["pls"] = {
+        {"tasks_dispatched", count(pls_tasks_dispatched)},
+        {"tasks_cancelled", count(pls_tasks_dispatched) - count(pls_tasks_run)}};
+
+    char const* names[no_networks] = {"x", "w", "pin", "pout", "pp_in1", "pp_in2", "pp_out"};
+    for (int i = 0; i < no_networks; i++){
+        jout["interconnects"][names[i]] = {
+            {"apply_permute", this->apply_permute[i].load()},
+            {"is_route_free", this->is_route_free[i].load()}};
+    }
+
+    jout["seconds"] = {
+        {"compile_layer", this->compile_layer_seconds},
+        {"create_memory_fifo", this->seconds[create_memory_fifo]},
+        {"run_cycle_model", this->seconds[run_cycle_model]},
+        {"duplicate_schedule", this->seconds[duplicate_schedule]}};
+
+    return jout;
+}
+
+namespace {
+
+thread_local Profile* bound = nullptr;
+
+} // namespace
+
+Profile& current(){
+    static Profile profile;
+    return bound != nullptr ? *bound : profile;
+}
+
+Scope::Scope(Profile& profile){
+    this->previous_ = bound;
+    bound = &profile;
+}
+
+Scope::~Scope(){
+    bound = this->previous_;
+}
+
+} // namespace profile
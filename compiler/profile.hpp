@@ -0,0 +1,114 @@
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <string>
+
+#include "nlohmann/json.hpp"
+
+using json = nlohmann::json;
+using namespace std;
+
+// Compile profile
+//
+// Counters and timers of the hot paths of the compiler, reported as the
+// "profile" section of sim_results.json. They are compiled in with
+// COMPILER_PROFILE (cmake -DENABLE_PROFILE=ON), otherwise the PROFILE_* macros
+// expand to nothing. The counters are shared by the placement workers and
+// are updated with relaxed atomics, the timers only by the main thread.
+namespace profile {
+
+enum Counter {
+    // placement decisions, one per op and round tried
+    op_attempts, op_placed,
+    op_no_array, op_bank_conflict, op_no_bank, op_route_blocked,
+    post_op_attempts, post_op_placed,
+    post_op_no_pp, post_op_bank_conflict, post_op_no_bank, post_op_route_blocked,
+    // candidates given to the parallel searches and the ones evaluated by the workers
+    pls_tasks_dispatched, pls_tasks_run,
+    no_counters
+};
+
+enum Network { x, w, pin, pout, pp_in1, pp_in2, pp_out, no_networks };
+
+enum Timer { create_memory_fifo, run_cycle_model, duplicate_schedule, no_timers };
+
+struct Profile {
+    atomic<long> counters[no_counters];
+    atomic<long> apply_permute[no_networks];
+    atomic<long> is_route_free[no_networks];
+
+    double seconds[no_timers];
+    map<string, double> compile_layer_seconds;
+
+    Profile();
+    void reset();
+    json to_json() const;
+
+    // attempts is op_attempts or post_op_attempts, outcome the placed counter or the reason of the failure
+    void count_placement(Counter attempts, Counter outcome){
+        this->counters[attempts].fetch_add(1, memory_order_relaxed);
+        this->counters[outcome].fetch_add(1, memory_order_relaxed);
+    }
+};
+
+// the profile bound to the calling thread by a Scope, the profile of the process otherwise
+Profile& current();
+
+// Binds profile to the calling thread while the scope lives, so that runs in
+// parallel threads of one process are counted separately. Threads started by
+// the run (e.g. the placement workers) count into the profile of the process.
+class Scope{
+    public:
+        Scope(Profile& profile);
+        ~Scope();
+
+    private:
+        Profile* previous_;
+};
+
+// adds the lifetime of the timer to seconds
+class ScopedTimer{
+    public:
+        ScopedTimer(double& seconds): seconds_(seconds), start_(chrono::steady_clock::now()) {}
+        ~ScopedTimer(){
+            this->seconds_ += chrono::duration<double>(chrono::steady_clock::now() - this->start_).count();
+        }
+
+    private:
+        double& seconds_;
+        chrono::steady_clock::time_point start_;
+};
+
+} // namespace profile
+
+#ifdef COMPILER_PROFILE
+
+#define PROFILE_COUNT(counter) \
+    profile::current().counters[profile::counter].fetch_add(1, std::memory_order_relaxed)
+#define PROFILE_ADD(counter, n) \
+    profile::current().counters[profile::counter].fetch_add((n), std::memory_order_relaxed)
+#define PROFILE_PLACEMENT(attempts, outcome) \
+    profile::current().count_placement(profile::attempts, (outcome))
+// call is apply_permute or is_route_free
+#define PROFILE_INTERCONNECT(call, network) \
+    profile::current().call[profile::network].fetch_add(1, std::memory_order_relaxed)
+#define PROFILE_TIMER(timer) \
+    profile::ScopedTimer profile_timer_(profile::current().seconds[profile::timer])
+#define PROFILE_LAYER_TIMER(layer_name) \
+    profile::ScopedTimer profile_timer_(profile::current().compile_layer_seconds[layer_name])
+
+#else
+
+#define PROFILE_COUNT(counter) ((void) 0)
+#define PROFILE_ADD(counter, n) ((void) 0)
+#define PROFILE_PLACEMENT(attempts, outcome) ((void) 0)
+#define PROFILE_INTERCONNECT(call, network) ((void) 0)
+#define PROFILE_TIMER(timer) ((void) 0)
+#define PROFILE_LAYER_TIMER(layer_name) ((void) 0)
+
+#endif
+
+#endif /* PROFILE_HPP */
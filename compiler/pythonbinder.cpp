@@ -1,19 +1,43 @@
 #include <iostream>
 #include <string>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <vector>
 
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
 
 #include "compiler.hpp"
-#include "array.hpp"
 #include "interconnect.hpp"
-#include "post_processor.hpp"
 #include "logger_setup.hpp"
 #include "dram.hpp"
+#include "results_store.hpp"
+#include "round_stats.hpp"
+#include "schedule_arrays.hpp"
+#include "schedule_file.hpp"
+#include "sweep.hpp"
 
 using namespace std;
 
-string csim(string json_dump, int no_array, int no_rows, int no_cols, int bank_size, float bandwidth, int prefetch_limit, string ict_type) {
-    logger_setup(boost::log::trivial::severity_level::error);
+// the log sink and filter are shared by the whole process
+void setup_logging_once(){
+    static std::once_flag once;
+    std::call_once(once, []{ logger_setup(boost::log::trivial::severity_level::error); });
+}
+
+// Compiles and simulates without holding the GIL, calls from several Python
+// threads run in parallel. Every call builds its own model and hardware. The
+// results are also appended to the results store, if one is given.
+string csim(string json_dump, int no_array, int no_rows, int no_cols, int bank_size, float bandwidth, int prefetch_limit, string ict_type, string schedule_cache, int partition_size, string results_store_file, int clos_m, int clos_n, int clos_r) {
+    pybind11::gil_scoped_release release;
+
+    setup_logging_once();
+    profile::Profile call_profile;
+    profile::Scope profile_scope(call_profile);
 
     InterconnectType interconnect_type;
     std::istringstream iss{ict_type};
@@ -21,72 +45,218 @@ string csim(string json_dump, int no_array, int no_rows, int no_cols, int bank_s
     if (!iss) {
         return "";
     }
+    ClosParams clos {clos_m, clos_n, clos_r};
+
+    // the memory bandwidth and the prefetch limit do not change the schedule
+    string cache_file;
+    if (!schedule_cache.empty()) {
+        json options = {{"no_array", no_array}, {"no_rows", no_rows}, {"no_cols", no_cols}, {"bank_size", bank_size},
+            {"interconnect_type", interconnect_type}, {"verify_schedule", false}, {"partition_size", partition_size},
+            {"clos", {clos.m, clos.n, clos.r}}};
+        std::istringstream model_data{json_dump};
+        cache_file = schedule_file::cache_path(schedule_cache, model_data, options);
+
+        if (std::filesystem::exists(cache_file)) {
+            json jout;
+            try {
+                std::unique_ptr<schedule_file::Schedule> cached(schedule_file::load(cache_file));
+                cached->compiler->dram->bandwidth = bandwidth * ((1 << 30) / cached->compiler->freq);
+                cached->compiler->dram->prefetch_limit = prefetch_limit;
+                cached->compiler->run_cycle_model();
+                jout = cached->compiler->sim_results(cached->meta);
+                #ifdef COMPILER_PROFILE
+                jout["profile"] = call_profile.to_json();
+                #endif
+            }
+            catch (runtime_error& e) {
+                BOOST_LOG_TRIVIAL(warning) << "Cached schedule is not used: " << e.what();
+            }
+
+            if (!jout.is_null()) {
+                if (!results_store_file.empty()) results_store::append(results_store_file, jout);
+                return jout.dump();
+            }
+        }
+    }
 
-    Arrays* arrays = new Arrays(no_array, no_rows, no_cols);
-    PostProcessors* post_processors = new PostProcessors(no_array);
-    Banks* banks = new Banks(no_array, bank_size);
+    // the same compilation and run as a sweep, the cycle model runs after the schedule is cached
+    sweep::Config config {no_array, no_rows, no_cols, bank_size, bandwidth, prefetch_limit, interconnect_type, partition_size, clos};
+    sweep::ModelDescription models(json_dump);
+    sweep::Session session(models, config);
 
-    Interconnects* interconnects = new Interconnects(no_array, interconnect_type);
+    if (!cache_file.empty()) {
+        schedule_file::save(session.compiler, session.sim_config(), cache_file);
+    }
 
-    float freq = 1e9;
-    bandwidth = bandwidth * ((1 << 30) / freq);
+    json jout = session.simulate();
+    #ifdef COMPILER_PROFILE
+    jout["profile"] = call_profile.to_json();
+    #endif
 
-    Dram* dram = new Dram(bandwidth, prefetch_limit);
+    if (!results_store_file.empty()) results_store::append(results_store_file, jout);
+    return jout.dump();
+}
 
-    Compiler* compiler = new Compiler(arrays, banks, interconnects, post_processors, dram);
+typedef tuple<int, int, int, int, float, int, string> SweepConfig;
 
-    json jin = json::parse(json_dump);
+// Runs every (no_array, no_rows, no_cols, bank_size, bandwidth, prefetch_limit, ict_type)
+// on no_threads threads, all hardware threads by default, sharing one parse of
+// the model. The results are in the order of configs, as csim returns them, and
+// the ones without an error are appended to the results store, if one is given.
+vector<string> sweep_configs(string json_dump, vector<SweepConfig> configs, int no_threads, int partition_size, string results_store_file, int clos_m, int clos_n, int clos_r) {
+    vector<sweep::Config> sweep_configs;
+    for (auto& c: configs) {
+        sweep::Config config {get<0>(c), get<1>(c), get<2>(c), get<3>(c), get<4>(c), get<5>(c), InterconnectType::crossbar, partition_size, {clos_m, clos_n, clos_r}};
+        std::istringstream iss{get<6>(c)};
+        iss >> config.interconnect_type;
+        if (!iss) {
+            throw std::invalid_argument("Unknown interconnect type " + get<6>(c));
+        }
+        sweep_configs.push_back(config);
+    }
 
-    Model* model = new Model();
-    for (json::iterator it = jin.begin(); it != jin.end(); ++it) {
-        string key = it.key();
-        if (!key.compare("args")) continue;
+    pybind11::gil_scoped_release release;
+    setup_logging_once();
 
-        string model_name (key);
+    if (no_threads <= 0) no_threads = (int) std::max(1u, std::thread::hardware_concurrency());
+    sweep::ModelDescription models(json_dump);
+    vector<json> results = sweep::run(models, sweep_configs, no_threads);
 
-        json j (jin[model_name]);
+    vector<string> dumps;
+    for (auto& jout: results) {
+        if (!results_store_file.empty() && !jout.contains("error")) results_store::append(results_store_file, jout);
+        dumps.push_back(jout.dump());
+    }
+    return dumps;
+}
 
-        model = new Model(model_name, j);
+// The results of a run with its compiled schedule and the statistics of its rounds
+struct ScheduledRun {
+    string results;
+    ScheduleArrays schedule;
+    RoundStats round_stats;
+};
 
-        cout << model;
-        compiler->compile(model);
-        
-        compiler->duplicate_schedule(model, model->no_repeat);
+// Compiles and simulates like csim, and keeps the schedule and the rounds for export.
+ScheduledRun* csim_schedule(string json_dump, int no_array, int no_rows, int no_cols, int bank_size, float bandwidth, int prefetch_limit, string ict_type, int partition_size, int clos_m, int clos_n, int clos_r) {
+    sweep::Config config {no_array, no_rows, no_cols, bank_size, bandwidth, prefetch_limit, InterconnectType::crossbar, partition_size, {clos_m, clos_n, clos_r}};
+    std::istringstream iss{ict_type};
+    iss >> config.interconnect_type;
+    if (!iss) {
+        throw std::invalid_argument("Unknown interconnect type " + ict_type);
     }
 
-    compiler->run_cycle_model();
-
-    json jout(jin["args"]);
-
-    jout["no_array"] = no_array;
-    jout["interconnect_type"] = interconnect_type; //TODO: Replace with string value
-    jout["no_cycles"] = compiler->no_cycles;
-    jout["no_main_rounds"] = compiler->no_main_rounds();
-    jout["no_post_rounds"] = compiler->no_post_rounds();
-    jout["interconnect_tdp"] = interconnects->tdp(no_cols);
-
-    jout["x_tiles_bw_usage"] = dram->x_tiles_bw_usage;
-    jout["w_tiles_bw_usage"] = dram->w_tiles_bw_usage;
-    jout["p_tiles_bw_usage"] = dram->p_tiles_bw_usage;
-    jout["total_bw_usage"] = dram->x_tiles_bw_usage + dram->w_tiles_bw_usage + dram->p_tiles_bw_usage;
-    jout["no_post_ops"] = post_processors->total_no_ops(); //INT operation (elementwise)
-    jout["no_ops"] = arrays->total_no_ops(); //INT operation (elementwise)
-    jout["total_sram_read_bytes"] = arrays->total_sram_read_bytes() + post_processors->total_sram_read_bytes(); //Bytes
-    jout["total_sram_write_bytes"] = arrays->total_sram_write_bytes() + post_processors->total_sram_write_bytes(); //Bytes
-    jout["memory_stall_cycles"] = compiler->memory_stall_cycles;
-    jout["no_layers"] = model->layer_list->size();
-    jout["total_no_gemm_ops"] = model->total_no_gemm_ops();
-
-    delete arrays;
-    delete post_processors;
-    delete banks;
-    delete interconnects;
-    delete compiler;
+    pybind11::gil_scoped_release release;
+    setup_logging_once();
 
+    ScheduledRun* run = new ScheduledRun();
+    try {
+        sweep::ModelDescription models(json_dump);
+        run->results = sweep::run_config(models, config, &run->schedule, &run->round_stats).dump();
+    }
+    catch (...) {
+        delete run;
+        throw;
+    }
+    return run;
+}
+
+// Compiles the models for one configuration, without holding the GIL. The
+// memory settings are given to every run of the session.
+sweep::Session* create_session(string json_dump, int no_array, int no_rows, int no_cols, int bank_size, string ict_type, int partition_size, int clos_m, int clos_n, int clos_r) {
+    sweep::Config config {no_array, no_rows, no_cols, bank_size, 0, 0, InterconnectType::crossbar, partition_size, {clos_m, clos_n, clos_r}};
+    std::istringstream iss{ict_type};
+    iss >> config.interconnect_type;
+    if (!iss) {
+        throw std::invalid_argument("Unknown interconnect type " + ict_type);
+    }
+
+    pybind11::gil_scoped_release release;
+    setup_logging_once();
+
+    sweep::ModelDescription models(json_dump);
+    return new sweep::Session(models, config);
+}
+
+// Runs the cycle model of the session without holding the GIL, the results are
+// also appended to the results store, if one is given.
+string run_session(sweep::Session& session, float bandwidth, int prefetch_limit, string results_store_file) {
+    pybind11::gil_scoped_release release;
+
+    json jout = session.run(bandwidth, prefetch_limit);
+    if (!results_store_file.empty()) results_store::append(results_store_file, jout);
     return jout.dump();
 }
 
+// A read-only NumPy view of data, which owner keeps alive. The data is not copied.
+template <typename T>
+pybind11::array_t<T> view(vector<T> const& data, vector<pybind11::ssize_t> shape, pybind11::handle owner) {
+    vector<pybind11::ssize_t> strides(shape.size(), sizeof(T));
+    for (int i = (int) shape.size() - 2; i >= 0; i--) strides[i] = strides[i + 1] * shape[i + 1];
+
+    pybind11::array_t<T> array(shape, strides, data.data(), owner);
+    array.attr("flags").attr("writeable") = false;
+    return array;
+}
+
 PYBIND11_MODULE(pythonbinder, m) {
     m.doc() = "pybind11 plugin";
-    m.def("csim", &csim, "C-simulator for multi-pod systolic arrays");
+    m.def("csim", &csim, "C-simulator for multi-pod systolic arrays",
+        pybind11::arg("json_dump"), pybind11::arg("no_array"), pybind11::arg("no_rows"), pybind11::arg("no_cols"),
+        pybind11::arg("bank_size"), pybind11::arg("bandwidth"), pybind11::arg("prefetch_limit"), pybind11::arg("ict_type"),
+        pybind11::arg("schedule_cache") = "", pybind11::arg("partition_size") = 0, pybind11::arg("results_store") = "",
+        pybind11::arg("clos_m") = 0, pybind11::arg("clos_n") = 0, pybind11::arg("clos_r") = 0);
+    m.def("sweep", &sweep_configs, "csim of every configuration in one process, in parallel",
+        pybind11::arg("json_dump"), pybind11::arg("configs"), pybind11::arg("no_threads") = 0,
+        pybind11::arg("partition_size") = 0, pybind11::arg("results_store") = "",
+        pybind11::arg("clos_m") = 0, pybind11::arg("clos_n") = 0, pybind11::arg("clos_r") = 0);
+
+    // the arrays are views of the run, which they keep alive
+    pybind11::class_<ScheduledRun>(m, "ScheduledRun")
+        .def_readonly("results", &ScheduledRun::results)
+        .def_property_readonly("layer_names", [](ScheduledRun const& run) { return run.schedule.layer_names; })
+#define SCHEDULE_VIEW(name, cols) \
+        .def_property_readonly(#name, [](pybind11::object self) { \
+            ScheduleArrays const& s = self.cast<ScheduledRun const&>().schedule; \
+            return view(s.name, {(pybind11::ssize_t) s.name.size() / (cols), cols}, self); })
+        SCHEDULE_VIEW(ops, s.no_arrays)
+        SCHEDULE_VIEW(layers, s.no_arrays)
+        SCHEDULE_VIEW(x_banks, s.no_arrays)
+        SCHEDULE_VIEW(w_banks, s.no_arrays)
+        SCHEDULE_VIEW(p_banks, s.no_arrays)
+        SCHEDULE_VIEW(op_index, 3)
+#undef SCHEDULE_VIEW
+        .def_property_readonly("op_layer", [](pybind11::object self) {
+            ScheduleArrays const& s = self.cast<ScheduledRun const&>().schedule;
+            return view(s.op_layer, {(pybind11::ssize_t) s.op_layer.size()}, self); })
+        .def_property_readonly("round_stats", [](pybind11::object self) {
+            RoundStats const& r = self.cast<ScheduledRun const&>().round_stats;
+            pybind11::dict columns;
+#define ROUND_VIEW(name) columns[#name] = view(r.name, {(pybind11::ssize_t) r.name.size()}, self);
+            ROUND_VIEW(start_cycle)
+            ROUND_VIEW(cycles)
+            ROUND_VIEW(stall_cycles)
+            ROUND_VIEW(active_arrays)
+            ROUND_VIEW(active_post_processors)
+            ROUND_VIEW(dram_x_bytes)
+            ROUND_VIEW(dram_w_bytes)
+            ROUND_VIEW(dram_p_bytes)
+            ROUND_VIEW(bank_max_bytes)
+            ROUND_VIEW(bank_mean_bytes)
+#undef ROUND_VIEW
+            return columns; });
+    // compiles once, then every run only resets the state of the cycle model
+    pybind11::class_<sweep::Session>(m, "Session")
+        .def(pybind11::init(&create_session),
+            pybind11::arg("json_dump"), pybind11::arg("no_array"), pybind11::arg("no_rows"), pybind11::arg("no_cols"),
+            pybind11::arg("bank_size"), pybind11::arg("ict_type"), pybind11::arg("partition_size") = 0,
+            pybind11::arg("clos_m") = 0, pybind11::arg("clos_n") = 0, pybind11::arg("clos_r") = 0)
+        .def("run", &run_session, "csim of the compiled models with the memory bandwidth (GB/s) and prefetch limit given",
+            pybind11::arg("bandwidth"), pybind11::arg("prefetch_limit"), pybind11::arg("results_store") = "")
+        .def_property_readonly("no_runs", &sweep::Session::no_runs);
+    m.def("csim_schedule", &csim_schedule, "csim that also returns the compiled schedule and the statistics of the rounds as NumPy arrays",
+        pybind11::arg("json_dump"), pybind11::arg("no_array"), pybind11::arg("no_rows"), pybind11::arg("no_cols"),
+        pybind11::arg("bank_size"), pybind11::arg("bandwidth"), pybind11::arg("prefetch_limit"), pybind11::arg("ict_type"),
+        pybind11::arg("partition_size") = 0,
+        pybind11::arg("clos_m") = 0, pybind11::arg("clos_n") = 0, pybind11::arg("clos_r") = 0);
 }
\ No newline at end of file
@@ -0,0 +1,382 @@
+
+#include "results_store.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace results_store {
+
+namespace {
+
+struct Field {
+    char const* name;
+    uint32_t type;
+    uint32_t width;
+    bool is_config;
+};
+
+// The schema of the store. array_rows and array_cols are the shape of the arrays,
+// the array_size of the results without them, extra_models is comma separated.
+// config_key must be the last column.
+Field const schema[] = {
+    {"model", string_column, 32, true},
+    {"extra_models", string_column, 128, true},
+    {"batch_size", int64_column, 8, true},
+    {"sentence_len", int64_column, 8, true},
+    {"imsize", int64_column, 8, true},
+    {"array_rows", int64_column, 8, true},
+    {"array_cols", int64_column, 8, true},
+    {"partition_size", int64_column, 8, true},
+    {"no_array", int64_column, 8, true},
+    {"interconnect_type", int64_column, 8, true},
+    {"clos_m", int64_column, 8, true},
+    {"clos_n", int64_column, 8, true},
+    {"clos_r", int64_column, 8, true},
+    {"bank_size", int64_column, 8, true},
+    {"bandwidth", float64_column, 8, true},
+    {"prefetch", int64_column, 8, true},
+
+    {"no_cycles", int64_column, 8, false},
+    {"no_main_rounds", int64_column, 8, false},
+    {"no_post_rounds", int64_column, 8, false},
+    {"no_layers", int64_column, 8, false},
+    {"total_no_gemm_ops", int64_column, 8, false},
+    {"no_ops", int64_column, 8, false},
+    {"no_post_ops", int64_column, 8, false},
+    {"memory_stall_cycles", int64_column, 8, false},
+    {"no_unverified_rounds", int64_column, 8, false},
+    {"total_sram_read_bytes", int64_column, 8, false},
+    {"total_sram_write_bytes", int64_column, 8, false},
+    {"x_tiles_bw_usage", float64_column, 8, false},
+    {"w_tiles_bw_usage", float64_column, 8, false},
+    {"p_tiles_bw_usage", float64_column, 8, false},
+    {"total_bw_usage", float64_column, 8, false},
+    {"interconnect_tdp", float64_column, 8, false},
+    {"interconnect_energy", float64_column, 8, false},
+    {"interconnect_energy_per_pass", float64_column, 8, false},
+    {"no_passes", int64_column, 8, false},
+    {"interconn_total_mbytes", float64_column, 8, false},
+    {"interconn_total_mbytes_with_multicast", float64_column, 8, false},
+
+    {"config_key", key_column, 8, false},
+};
+
+constexpr size_t no_columns = sizeof(schema) / sizeof(Field);
+
+// field of the sim_results a column is read from, nullptr if it is missing
+json const* find_field(json const& results, string const& name){
+    if ((name == "array_rows" || name == "array_cols") && !results.contains(name)){
+        auto it = results.find("array_size");
+        if (it == results.end() || !it->is_array() || it->size() < 2) return nullptr;
+        return &(*it)[name == "array_rows" ? 0 : 1];
+    }
+    auto it = results.find(name);
+    if (it == results.end() || it->is_null()) return nullptr;
+    return &(*it);
+}
+
+// the value of a column in the store, width bytes at out
+void encode(json const& results, Field const& f, char* out){
+    json const* j = find_field(results, f.name);
+
+    if (f.type == int64_column){
+        int64_t v = -1;
+        if (j != nullptr && j->is_boolean()) v = j->get<bool>();
+        else if (j != nullptr && j->is_number()) v = j->get<int64_t>();
+        memcpy(out, &v, sizeof(v));
+    }
+    else if (f.type == float64_column){
+        double v = numeric_limits<double>::quiet_NaN();
+        if (j != nullptr && j->is_number()) v = j->get<double>();
+        memcpy(out, &v, sizeof(v));
+    }
+    else if (f.type == string_column){
+        string s;
+        if (j != nullptr && j->is_string()) s = j->get<string>();
+        else if (j != nullptr && j->is_array()){
+            for (auto& e: *j){
+                if (!s.empty()) s += ",";
+                s += e.is_string() ? e.get<string>() : e.dump();
+            }
+        }
+        if (s.size() > f.width){
+            throw runtime_error(string("Field ") + f.name + " does not fit the results store.");
+        }
+        memset(out, 0, f.width);
+        memcpy(out, s.data(), s.size());
+    }
+}
+
+// FNV-1a
+uint64_t hash(char const* data, size_t size, uint64_t h = 0xcbf29ce484222325){
+    for (size_t i = 0; i < size; i++){
+        h ^= (unsigned char) data[i];
+        h *= 0x100000001b3;
+    }
+    return h;
+}
+
+// the values of all columns one after the other
+vector<char> encode_row(json const& results){
+    size_t row_size = 0;
+    for (auto& f: schema) row_size += f.width;
+
+    vector<char> row(row_size);
+    uint64_t key = 0xcbf29ce484222325;
+    size_t offset = 0;
+    for (auto& f: schema){
+        if (f.type == key_column){
+            memcpy(row.data() + offset, &key, sizeof(key));
+        }
+        else {
+            encode(results, f, row.data() + offset);
+            if (f.is_config) key = hash(row.data() + offset, f.width, key);
+        }
+        offset += f.width;
+    }
+    return row;
+}
+
+vector<ColumnRecord> column_records(){
+    vector<ColumnRecord> columns(no_columns);
+    uint64_t offset = 0;
+    for (size_t i = 0; i < no_columns; i++){
+        ColumnRecord& c = columns[i];
+        memset(&c, 0, sizeof(c));
+        strncpy(c.name, schema[i].name, sizeof(c.name) - 1);
+        c.type = schema[i].type;
+        c.width = schema[i].width;
+        c.is_config = schema[i].is_config;
+        c.offset = offset;
+        offset += (uint64_t) c.width * block_rows;
+    }
+    return columns;
+}
+
+Header new_header(){
+    Header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, magic, sizeof(magic));
+    h.byte_order = byte_order;
+    h.version = version;
+    h.no_columns = no_columns;
+    h.block_rows = block_rows;
+    h.columns_offset = sizeof(Header);
+    h.blocks_offset = sizeof(Header) + no_columns * sizeof(ColumnRecord);
+    for (auto& f: schema) h.block_size += (uint64_t) f.width * block_rows;
+    return h;
+}
+
+void check_header(Header const& h, uint64_t file_size){
+    if (memcmp(h.magic, magic, sizeof(magic)) != 0){
+        throw runtime_error("Not a results store.");
+    }
+    if (h.byte_order != byte_order){
+        throw runtime_error("Results store has a different byte order.");
+    }
+    if (h.version != version){
+        throw runtime_error("Unsupported results store version " + to_string(h.version) + ".");
+    }
+    if (h.block_rows == 0 || h.no_rows > (uint64_t) h.no_blocks * h.block_rows
+        || h.columns_offset + (uint64_t) h.no_columns * sizeof(ColumnRecord) > h.blocks_offset
+        || h.no_blocks > (file_size - min(file_size, h.blocks_offset)) / max<uint64_t>(h.block_size, 1)){
+        throw runtime_error("Results store is corrupt.");
+    }
+}
+
+void read_all(int fd, void* data, size_t size, off_t offset){
+    if (pread(fd, data, size, offset) != (ssize_t) size){
+        throw runtime_error("Results store cannot be read.");
+    }
+}
+
+void write_all(int fd, void const* data, size_t size, off_t offset){
+    if (pwrite(fd, data, size, offset) != (ssize_t) size){
+        throw runtime_error("Results store cannot be written.");
+    }
+}
+
+// appends a row to the store open and locked as fd
+void append_row(int fd, vector<char> const& row){
+    struct stat st;
+    if (fstat(fd, &st) != 0){
+        throw runtime_error("Results store cannot be read.");
+    }
+
+    vector<ColumnRecord> columns = column_records();
+    Header h;
+    if (st.st_size == 0){
+        h = new_header();
+        write_all(fd, &h, sizeof(h), 0);
+        write_all(fd, columns.data(), columns.size() * sizeof(ColumnRecord), h.columns_offset);
+    }
+    else {
+        if ((size_t) st.st_size < sizeof(Header)){
+            throw runtime_error("Results store is corrupt.");
+        }
+        read_all(fd, &h, sizeof(h), 0);
+        check_header(h, st.st_size);
+
+        vector<ColumnRecord> stored(h.no_columns);
+        read_all(fd, stored.data(), stored.size() * sizeof(ColumnRecord), h.columns_offset);
+        if (h.no_columns != no_columns || h.block_rows != block_rows
+            || memcmp(stored.data(), columns.data(), columns.size() * sizeof(ColumnRecord)) != 0){
+            throw runtime_error("Results store has a different schema.");
+        }
+    }
+
+    // a block is added when the last one is full
+    uint64_t block = h.no_rows / h.block_rows;
+    if (block == h.no_blocks){
+        if (ftruncate(fd, h.blocks_offset + (h.no_blocks + 1) * h.block_size) != 0){
+            throw runtime_error("Results store cannot be extended.");
+        }
+        h.no_blocks++;
+    }
+
+    uint64_t i = h.no_rows % h.block_rows;
+    size_t offset = 0;
+    for (auto& c: columns){
+        write_all(fd, row.data() + offset, c.width, h.blocks_offset + block * h.block_size + c.offset + i * c.width);
+        offset += c.width;
+    }
+
+    h.no_rows++;
+    write_all(fd, &h, sizeof(h), 0);
+}
+
+} // namespace
+
+void append(string const& path, json const& results){
+    vector<char> row = encode_row(results);
+
+    int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0){
+        throw runtime_error("Results store " + path + " cannot be opened.");
+    }
+    // the lock is released when the file is closed
+    if (flock(fd, LOCK_EX) != 0){
+        close(fd);
+        throw runtime_error("Results store " + path + " cannot be locked.");
+    }
+
+    try {
+        append_row(fd, row);
+    }
+    catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+}
+
+uint64_t config_key(json const& results){
+    vector<char> row = encode_row(results);
+    uint64_t key;
+    memcpy(&key, row.data() + row.size() - sizeof(key), sizeof(key));
+    return key;
+}
+
+ResultsFile::ResultsFile(string const& path){
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0){
+        throw runtime_error("Results store " + path + " cannot be opened.");
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(Header)){
+        close(fd);
+        throw runtime_error("Results store " + path + " is too small.");
+    }
+
+    this->size_ = st.st_size;
+    this->data_ = mmap(nullptr, this->size_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (this->data_ == MAP_FAILED){
+        this->data_ = nullptr;
+        throw runtime_error("Results store " + path + " cannot be mapped.");
+    }
+
+    memcpy(&this->header_, this->data_, sizeof(Header));
+    try {
+        this->validate();
+    }
+    catch (...) {
+        munmap(this->data_, this->size_);
+        throw;
+    }
+    this->columns_ = (ColumnRecord const*) ((char const*) this->data_ + this->header_.columns_offset);
+}
+
+ResultsFile::~ResultsFile(){
+    if (this->data_ != nullptr) munmap(this->data_, this->size_);
+}
+
+void ResultsFile::validate() const {
+    Header const& h = this->header_;
+    check_header(h, this->size_);
+    auto columns = (ColumnRecord const*) ((char const*) this->data_ + h.columns_offset);
+    for (uint32_t i = 0; i < h.no_columns; i++){
+        ColumnRecord const& c = columns[i];
+        if (c.type > key_column || c.width == 0 || c.offset + (uint64_t) c.width * h.block_rows > h.block_size){
+            throw runtime_error("Results store has a corrupt column.");
+        }
+    }
+    if (h.no_columns == 0 || columns[h.no_columns - 1].type != key_column){
+        throw runtime_error("Results store has no config_key column.");
+    }
+}
+
+char const* ResultsFile::value(size_t column, size_t row) const {
+    Header const& h = this->header_;
+    ColumnRecord const& c = this->columns_[column];
+    return (char const*) this->data_ + h.blocks_offset + (row / h.block_rows) * h.block_size
+        + c.offset + (row % h.block_rows) * c.width;
+}
+
+uint64_t ResultsFile::key(size_t row) const {
+    uint64_t key;
+    memcpy(&key, this->value(this->header_.no_columns - 1, row), sizeof(key));
+    return key;
+}
+
+json ResultsFile::row(size_t row) const {
+    json jout = json::object();
+    for (uint32_t i = 0; i < this->header_.no_columns; i++){
+        ColumnRecord const& c = this->columns_[i];
+        string name(c.name, strnlen(c.name, sizeof(c.name)));
+        char const* v = this->value(i, row);
+
+        if (c.type == int64_column){
+            int64_t x;
+            memcpy(&x, v, sizeof(x));
+            if (x != -1) jout[name] = x;
+        }
+        else if (c.type == float64_column){
+            double x;
+            memcpy(&x, v, sizeof(x));
+            if (!isnan(x)) jout[name] = x;
+        }
+        else if (c.type == string_column){
+            string s(v, strnlen(v, c.width));
+            if (!s.empty()) jout[name] = s;
+        }
+        else {
+            uint64_t x;
+            memcpy(&x, v, sizeof(x));
+            jout[name] = x;
+        }
+    }
+    return jout;
+}
+
+} // namespace results_store
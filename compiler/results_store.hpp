@@ -0,0 +1,103 @@
+#ifndef RESULTS_STORE_HPP
+#define RESULTS_STORE_HPP
+
+#include <cstdint>
+#include <string>
+
+#include "nlohmann/json.hpp"
+
+using json = nlohmann::json;
+using namespace std;
+
+// Columnar results store (results.srs)
+//
+// The sim_results of many runs in one file, with a column for every field of a
+// fixed schema, so that the results of a sweep are loaded by mapping a single
+// file instead of parsing a JSON file per run:
+//
+//   Header
+//   ColumnRecord[no_columns]   name, type and position of the columns
+//   Block[no_blocks]           block_rows rows, the values of a column are
+//                              contiguous within a block
+//
+// Runs are appended under an exclusive lock of the file, so that the parallel
+// runs of an experiment can share one store. no_rows is written after the
+// values of a row, a reader sees complete rows only. Fields missing from the
+// results are -1, NaN or the empty string.
+//
+// The config_key column is a hash of the config columns and is the index of
+// the store, the runs of one configuration have the same key. results_store.py
+// reads the same layout.
+namespace results_store {
+
+constexpr char magic[8] = {'S', 'O', 'S', 'A', 'R', 'E', 'S', '\0'};
+constexpr uint32_t byte_order = 0x01020304;
+constexpr uint32_t version = 1;
+constexpr uint32_t block_rows = 1024;
+
+// ColumnRecord::type
+constexpr uint32_t int64_column = 0;
+constexpr uint32_t float64_column = 1;
+constexpr uint32_t string_column = 2; // zero padded to width bytes
+constexpr uint32_t key_column = 3;    // uint64_t
+
+struct Header {
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t version;
+    uint32_t no_columns;
+    uint32_t block_rows;
+    uint64_t no_rows;
+    uint64_t no_blocks;
+    uint64_t columns_offset;
+    uint64_t blocks_offset;
+    uint64_t block_size;
+};
+
+struct ColumnRecord {
+    char name[40];
+    uint32_t type;
+    uint32_t width;     // bytes of a value
+    uint32_t is_config; // hashed into config_key
+    uint32_t reserved;
+    uint64_t offset;    // of the first value of the column in a block
+};
+
+static_assert(sizeof(Header) == 64, "Header layout");
+static_assert(sizeof(ColumnRecord) == 64, "ColumnRecord layout");
+
+// Appends the sim_results of a run to the store, which is created if it does not exist.
+void append(string const& path, json const& results);
+
+// config_key of the sim_results of a run
+uint64_t config_key(json const& results);
+
+// Read-only memory mapping of a results store
+class ResultsFile {
+    public:
+        explicit ResultsFile(string const& path);
+        ResultsFile(ResultsFile const&) = delete;
+        ResultsFile& operator=(ResultsFile const&) = delete;
+        ~ResultsFile();
+
+        size_t no_rows() const { return header_.no_rows; }
+        uint64_t key(size_t row) const;
+
+        // the fields of a row by column name, without the missing ones
+        json row(size_t row) const;
+
+    private:
+        void validate() const;
+        char const* value(size_t column, size_t row) const;
+
+        void* data_ {nullptr};
+        size_t size_ {0};
+
+        // read when the file is opened, rows appended later are not seen
+        Header header_;
+        ColumnRecord const* columns_;
+};
+
+} // namespace results_store
+
+#endif /* RESULTS_STORE_HPP */
@@ -0,0 +1,65 @@
+#include "round_stats.hpp"
+
+#include <stdexcept>
+
+#include "compiler.hpp"
+
+RoundStats::RoundStats(string const& path){
+    this->out_.open(path, ofstream::out);
+    if (!this->out_.is_open()){
+        throw runtime_error("Round statistics file " + path + " cannot be opened.");
+    }
+
+    this->out_ << "round,start_cycle,cycles,stall_cycles,active_arrays,active_post_processors,"
+        "dram_x_bytes,dram_w_bytes,dram_p_bytes,bank_max_bytes,bank_mean_bytes\n";
+}
+
+void RoundStats::write_round(Compiler* compiler, int r, int start_cycle, int cycles, int stall_cycles){
+    int active_arrays = 0;
+    for (auto it = compiler->arrays->array_map->begin(); it != compiler->arrays->array_map->end(); it++){
+        if (it->second->get_op(r) != nullptr) active_arrays++;
+    }
+
+    int active_pps = 0;
+    for (auto it = compiler->post_processors->pp_map->begin(); it != compiler->post_processors->pp_map->end(); it++){
+        if (it->second->get_op(r) != nullptr) active_pps++;
+    }
+
+    // the counters are restarted by the cycle model after the round
+    Dram* dram = compiler->dram;
+    long x_bytes = dram->x_round_bytes;
+    long w_bytes = dram->w_round_bytes;
+    long p_bytes = dram->p_round_bytes;
+
+    int bank_max_bytes = 0;
+    long bank_total_bytes = 0;
+    int no_banks = 0;
+    for (list<Bank*>* banks: {compiler->banks->get_x_banks(), compiler->banks->get_w_banks(), compiler->banks->get_p_banks()}){
+        for (auto it = banks->begin(); it != banks->end(); it++){
+            bank_max_bytes = max(bank_max_bytes, (*it)->capacity_used);
+            bank_total_bytes += (*it)->capacity_used;
+            no_banks++;
+        }
+    }
+
+    double bank_mean_bytes = no_banks ? (double) bank_total_bytes / no_banks : 0;
+
+    if (!this->out_.is_open()){
+        this->start_cycle.push_back(start_cycle);
+        this->cycles.push_back(cycles);
+        this->stall_cycles.push_back(stall_cycles);
+        this->active_arrays.push_back(active_arrays);
+        this->active_post_processors.push_back(active_pps);
+        this->dram_x_bytes.push_back(x_bytes);
+        this->dram_w_bytes.push_back(w_bytes);
+        this->dram_p_bytes.push_back(p_bytes);
+        this->bank_max_bytes.push_back(bank_max_bytes);
+        this->bank_mean_bytes.push_back(bank_mean_bytes);
+        return;
+    }
+
+    this->out_ << r << "," << start_cycle << "," << cycles << "," << stall_cycles << ","
+        << active_arrays << "," << active_pps << ","
+        << x_bytes << "," << w_bytes << "," << p_bytes << ","
+        << bank_max_bytes << "," << bank_mean_bytes << "\n";
+}
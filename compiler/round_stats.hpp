@@ -0,0 +1,44 @@
+#ifndef ROUND_STATS_HPP
+#define ROUND_STATS_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class Compiler;
+
+// Per-round statistics of run_cycle_model, a CSV file with one line per main
+// round that is written when the round ends, so that the memory used does not
+// grow with the number of rounds. Without a file, the rounds are kept in the
+// columns below instead, which the Python binder exports. The columns are:
+//
+//   round, start_cycle, cycles        array clock cycles of the round
+//   stall_cycles                      cycles the round waited for the memory
+//   active_arrays, active_post_processors
+//   dram_x_bytes, dram_w_bytes, dram_p_bytes
+//                                     memory traffic since the end of the previous
+//                                     round, dram_p_bytes includes the write-backs
+//   bank_max_bytes, bank_mean_bytes   occupancy of the x, w and p banks at the end
+class RoundStats{
+    public:
+        // the rounds are kept in memory
+        RoundStats() {}
+        RoundStats(string const& path);
+
+        void write_round(Compiler* compiler, int r, int start_cycle, int cycles, int stall_cycles);
+
+        // one element per round, if there is no file
+        vector<int32_t> start_cycle, cycles, stall_cycles;
+        vector<int32_t> active_arrays, active_post_processors;
+        vector<int64_t> dram_x_bytes, dram_w_bytes, dram_p_bytes;
+        vector<int32_t> bank_max_bytes;
+        vector<double> bank_mean_bytes;
+
+    private:
+        ofstream out_;
+};
+
+#endif /* ROUND_STATS_HPP */
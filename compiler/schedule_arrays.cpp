@@ -0,0 +1,43 @@
+#include "schedule_arrays.hpp"
+
+#include "compiler.hpp"
+
+void ScheduleArrays::read(Compiler* compiler, vector<Model*> const& models){
+    // no_main_rounds is the last round of the arrays
+    this->no_rounds = compiler->no_main_rounds() + 1;
+    this->no_arrays = compiler->arrays->no_arrays;
+
+    size_t size = (size_t) this->no_rounds * this->no_arrays;
+    for (vector<int32_t>* v: {&this->ops, &this->layers, &this->x_banks, &this->w_banks, &this->p_banks}){
+        v->assign(size, -1);
+    }
+    this->op_index.clear();
+    this->op_layer.clear();
+    this->layer_names.clear();
+
+    auto bank_id = [](Tile const* tile){ return tile != nullptr && tile->bank != nullptr ? tile->bank->id : -1; };
+
+    int32_t op_id = 0;
+    for (Model* model: models){
+        for (auto layer = model->begin(); layer != model->end(); layer++){
+            int32_t layer_id = this->layer_names.size();
+            this->layer_names.push_back(layer->layer_name);
+
+            for (auto it = layer->main_ops.begin(); it != layer->main_ops.end(); it++, op_id++){
+                MultOp* op = it->second;
+                this->op_index.push_back(get<0>(it->first));
+                this->op_index.push_back(get<1>(it->first));
+                this->op_index.push_back(get<2>(it->first));
+                this->op_layer.push_back(layer_id);
+
+                if (op->array_placed == nullptr || op->round_placed < 0 || op->round_placed >= this->no_rounds) continue;
+                size_t i = (size_t) op->round_placed * this->no_arrays + op->array_placed->id;
+                this->ops[i] = op_id;
+                this->layers[i] = layer_id;
+                this->x_banks[i] = bank_id(op->x_tile);
+                this->w_banks[i] = bank_id(op->w_tile);
+                this->p_banks[i] = bank_id(op->pout_tile);
+            }
+        }
+    }
+}
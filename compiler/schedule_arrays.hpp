@@ -0,0 +1,42 @@
+#ifndef SCHEDULE_ARRAYS_HPP
+#define SCHEDULE_ARRAYS_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class Compiler;
+class Model;
+
+// The compiled main schedule as dense int32 arrays in row-major order, which
+// the Python binder exports as NumPy arrays without copying them.
+//
+// The layers are numbered in compile order, the layers of the first model
+// first. The ops are numbered in the order of their layers, and within a layer
+// in the order of their (i, j, k) index.
+struct ScheduleArrays {
+    int no_rounds {0};
+    int no_arrays {0};
+
+    // [no_rounds x no_arrays], -1 where an array is idle
+    vector<int32_t> ops;
+    vector<int32_t> layers;
+    vector<int32_t> x_banks;
+    vector<int32_t> w_banks;
+    vector<int32_t> p_banks;    // of the output tile
+
+    // [no_ops x 3], the (i, j, k) index of an op in its layer
+    vector<int32_t> op_index;
+    // [no_ops]
+    vector<int32_t> op_layer;
+    // [no_layers]
+    vector<string> layer_names;
+
+    // Reads the schedule of the compiled models, before the cycle model runs
+    // (which retires the ops).
+    void read(Compiler* compiler, vector<Model*> const& models);
+};
+
+#endif /* SCHEDULE_ARRAYS_HPP */
@@ -0,0 +1,1002 @@
+
+#include "schedule_file.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+#include <dlfcn.h>
+#include <unistd.h>
+
+namespace schedule_file {
+
+#define FOR_EACH_INTERCONNECT(F) F(x) F(w) F(pin) F(pout) F(pp_in1) F(pp_in2) F(pp_out)
+
+class Writer{
+    public:
+        Writer(Compiler* compiler) : compiler_(compiler) {}
+
+        string write(json const& meta){
+            this->collect();
+
+            this->buffer_.append(magic, sizeof(magic));
+            this->put<uint32_t>(byte_order);
+            this->put<uint32_t>(version);
+            this->put_string(meta.dump());
+
+            Compiler* c = this->compiler_;
+            Array* array0 = c->arrays->array_map->begin()->second;
+            this->put<int32_t>(c->arrays->no_arrays);
+            this->put<int32_t>(array0->no_rows);
+            this->put<int32_t>(array0->no_cols);
+            this->put<int32_t>(c->banks->no_banks);
+            this->put<int32_t>(c->banks->get_x_banks()->front()->capacity);
+            this->put<int32_t>(c->post_processors->no_pps);
+            this->put<int32_t>(c->interconnects->N);
+            this->put<uint32_t>((uint32_t) c->interconnects->type);
+            this->put<int32_t>(c->interconnects->clos.m);
+            this->put<int32_t>(c->interconnects->clos.n);
+            this->put<int32_t>(c->interconnects->clos.r);
+
+            this->put<int32_t>(c->no_cycles);
+            this->put<int32_t>(c->sram_round_trip);
+            this->put<int32_t>(c->pp_latency_offset);
+            this->put<uint8_t>(c->livelock_detected);
+            this->put<int32_t>(c->memory_stall_cycles);
+            this->put<float>(c->freq);
+            this->put<int32_t>(c->no_passes);
+
+            this->put<int32_t>(c->dram->prefetch_limit);
+            this->put<float>(c->dram->bandwidth);
+            this->put<float>(c->dram->x_tiles_bw_usage);
+            this->put<float>(c->dram->w_tiles_bw_usage);
+            this->put<float>(c->dram->p_tiles_bw_usage);
+            this->put_queue(c->dram->load_queue);
+
+#define PUT_ACTIVITY(x) this->put_activity(c->interconnects->x##_interconnect);
+            FOR_EACH_INTERCONNECT(PUT_ACTIVITY)
+#undef PUT_ACTIVITY
+
+            this->put<uint32_t>(this->strings_.size());
+            for (auto& s: this->strings_) this->put_string(s);
+
+            this->put<uint32_t>(this->lists_.size());
+            for (auto l: this->lists_){
+                this->put<uint32_t>(l->size());
+                for (auto op: *l) this->put<int32_t>(this->ref(op));
+            }
+
+            this->put<uint32_t>(this->tiles_.size());
+            for (auto t: this->tiles_) this->put_tile(t);
+
+            this->put<uint32_t>(this->ops_.size());
+            for (auto op: this->ops_) this->put_op(op);
+
+            for (auto it = c->arrays->array_map->begin(); it != c->arrays->array_map->end(); it++){
+                this->put_array(it->second);
+            }
+            this->put_traffic(c->arrays->traffic);
+
+            for (auto it = c->post_processors->pp_map->begin(); it != c->post_processors->pp_map->end(); it++){
+                this->put_pp(it->second);
+            }
+
+            for (auto banks: {c->banks->get_x_banks(), c->banks->get_w_banks(), c->banks->get_p_banks()}){
+                for (auto bank: *banks) this->put_bank(bank);
+            }
+
+            return std::move(this->buffer_);
+        }
+
+    private:
+        template <typename T>
+        void put(T v){
+            this->buffer_.append((char const*) &v, sizeof(T));
+        }
+
+        void put_string(string const& s){
+            this->put<uint32_t>(s.size());
+            this->buffer_.append(s);
+        }
+
+        int32_t ref(Tile* t){ return t == nullptr ? -1 : this->tile_index_.at(t); }
+        int32_t ref(Op* op){ return op == nullptr ? -1 : this->op_index_.at(op); }
+        int32_t ref(list<Op*>* l){ return l == nullptr ? -1 : this->list_index_.at(l); }
+
+        // layer names are shared by many tiles and ops, the table is complete after collect()
+        uint32_t name(string const& s){
+            auto it = this->string_index_.find(s);
+            if (it != this->string_index_.end()) return it->second;
+            this->strings_.push_back(s);
+            return this->string_index_[s] = this->strings_.size() - 1;
+        }
+
+        void add(Tile* t){
+            if (t == nullptr || this->tile_index_.count(t)) return;
+            this->tile_index_[t] = this->tiles_.size();
+            this->tiles_.push_back(t);
+            this->name(t->layer_name);
+        }
+
+        void add(Op* op){
+            if (op == nullptr || this->op_index_.count(op)) return;
+            this->op_index_[op] = this->ops_.size();
+            this->ops_.push_back(op);
+            this->name(op->layer_name);
+        }
+
+        void add(list<pair<int, Tile*>>* queue){
+            for (auto& p: *queue) this->add(p.second);
+        }
+
+        // numbers everything reachable from the hardware, breadth first so
+        // that long chains of ops do not recurse
+        void collect(){
+            Compiler* c = this->compiler_;
+            for (auto it = c->arrays->array_map->begin(); it != c->arrays->array_map->end(); it++){
+                Array* a = it->second;
+                for (auto& s: a->schedule) this->add(s.second);
+                this->add(a->curr_op);
+                this->add(a->curr_w_tile);
+                this->add(a->next_w_tile);
+                this->add(a->x_tile);
+                this->add(a->pin_tile);
+                this->add(a->pout_tile);
+            }
+            for (auto it = c->post_processors->pp_map->begin(); it != c->post_processors->pp_map->end(); it++){
+                PostProcessor* pp = it->second;
+                for (auto& s: pp->schedule) this->add(s.second);
+                this->add(pp->curr_op);
+                this->add(pp->pin1_tile);
+                this->add(pp->pin2_tile);
+                this->add(pp->pout_tile);
+            }
+            for (auto banks: {c->banks->get_x_banks(), c->banks->get_w_banks(), c->banks->get_p_banks()}){
+                for (auto bank: *banks){
+                    for (auto& t: bank->allocated_tiles) this->add(t.first);
+                    this->add(bank->evict_queue);
+                    this->add(bank->spawn_queue);
+                    for (auto t: *bank->write_back_queue) this->add(t);
+                }
+            }
+            this->add(c->dram->load_queue);
+
+            size_t next_tile = 0, next_op = 0;
+            while (next_tile < this->tiles_.size() || next_op < this->ops_.size()){
+                for (; next_tile < this->tiles_.size(); next_tile++){
+                    Tile* t = this->tiles_[next_tile];
+                    if (t->input_of != nullptr && !this->list_index_.count(t->input_of)){
+                        this->list_index_[t->input_of] = this->lists_.size();
+                        this->lists_.push_back(t->input_of);
+                        for (auto op: *t->input_of) this->add(op);
+                    }
+                    this->add(t->output_of);
+                }
+                for (; next_op < this->ops_.size(); next_op++){
+                    Op* op = this->ops_[next_op];
+                    this->add(op->pout_tile);
+                    this->add(op->pair_op);
+                    if (op->is_multop){
+                        MultOp* m = (MultOp*) op;
+                        this->add(m->x_tile);
+                        this->add(m->w_tile);
+                        this->add(m->pin_op);
+                        this->add(m->aggregated_to);
+                    }
+                    else {
+                        AggrOp* a = (AggrOp*) op;
+                        this->add(a->pin1_tile);
+                        this->add(a->pin2_tile);
+                        this->add(a->operand1);
+                        this->add(a->operand2);
+                    }
+                }
+            }
+        }
+
+        void put_queue(list<pair<int, Tile*>>* queue){
+            this->put<uint32_t>(queue->size());
+            for (auto& p: *queue){
+                this->put<int32_t>(p.first);
+                this->put<int32_t>(this->ref(p.second));
+            }
+        }
+
+        void put_activity(InterconnectBase* interconnect){
+            this->put<uint64_t>(interconnect->config_version);
+            this->put<float>(interconnect->energy_spent);
+            this->put<uint32_t>(interconnect->stage_bytes.size());
+            for (double b: interconnect->stage_bytes) this->put<double>(b);
+            this->put<uint64_t>(interconnect->no_deliveries);
+            this->put<uint64_t>(interconnect->no_sources);
+            this->put<uint64_t>(interconnect->max_fanout);
+        }
+
+        void put_tile(Tile* t){
+            this->put<int32_t>(t->type);
+            this->put<uint32_t>(this->name(t->layer_name));
+            this->put_string(t->tag);
+            this->put<int32_t>(get<0>(t->dims));
+            this->put<int32_t>(get<1>(t->dims));
+            this->put<int32_t>(t->precision);
+            this->put<float>(t->bytes_fetched_from_memory);
+            this->put<float>(t->bytes_written_to_memory);
+            this->put<int32_t>(t->memory_size);
+            this->put<int32_t>(this->ref(t->input_of));
+            this->put<int32_t>(this->ref(t->output_of));
+            this->put<int32_t>(t->bank == nullptr ? -1 : t->bank->type);
+            this->put<int32_t>(t->bank == nullptr ? -1 : t->bank->id);
+            this->put<uint8_t>(t->is_spawn_);
+            this->put<uint8_t>(t->is_allocated_on_sram);
+            if (t->type == data_type::X){
+                X_Tile* x = (X_Tile*) t;
+                this->put<int32_t>(get<0>(x->id));
+                this->put<int32_t>(get<1>(x->id));
+            }
+            else if (t->type == data_type::W){
+                W_Tile* w = (W_Tile*) t;
+                this->put<int32_t>(get<0>(w->id));
+                this->put<int32_t>(get<1>(w->id));
+            }
+            else {
+                P_Tile* p = (P_Tile*) t;
+                this->put<int32_t>(get<0>(p->id));
+                this->put<int32_t>(get<1>(p->id));
+                this->put<int32_t>(get<2>(p->id));
+            }
+        }
+
+        void put_op(Op* op){
+            this->put<uint8_t>(op->is_multop);
+            this->put<uint32_t>(this->name(op->layer_name));
+            this->put<int32_t>(op->round_placed);
+            this->put<int32_t>(get<0>(op->op_ind));
+            this->put<int32_t>(get<1>(op->op_ind));
+            this->put<int32_t>(get<2>(op->op_ind));
+            this->put<uint8_t>(op->is_finalop);
+            this->put<uint8_t>(op->retired);
+            this->put<uint8_t>(op->is_placed_);
+            this->put<int32_t>(this->ref(op->pout_tile));
+            this->put<int32_t>(this->ref(op->pair_op));
+            if (op->is_multop){
+                MultOp* m = (MultOp*) op;
+                this->put<int32_t>(this->ref(m->x_tile));
+                this->put<int32_t>(this->ref(m->w_tile));
+                this->put<int32_t>(this->ref(m->pin_op));
+                this->put<int32_t>(this->ref(m->aggregated_to));
+                this->put<int32_t>(m->array_placed == nullptr ? -1 : m->array_placed->id);
+                this->put<int32_t>(m->weight_buffer_cycles);
+            }
+            else {
+                AggrOp* a = (AggrOp*) op;
+                this->put<int32_t>(this->ref(a->pin1_tile));
+                this->put<int32_t>(this->ref(a->pin2_tile));
+                this->put<int32_t>(this->ref(a->operand1));
+                this->put<int32_t>(this->ref(a->operand2));
+                this->put<int32_t>(a->pp_placed == nullptr ? -1 : a->pp_placed->id);
+                this->put<uint8_t>(a->flip);
+            }
+        }
+
+        void put_array(Array* a){
+            this->put<int32_t>(a->pipeline_cycles);
+            this->put<int32_t>((int32_t) a->buf_state);
+            this->put<int32_t>(this->ref(a->curr_w_tile));
+            this->put<int32_t>(this->ref(a->next_w_tile));
+            this->put<int32_t>(this->ref(a->curr_op));
+            this->put<int32_t>(a->buf_cnt);
+            this->put<int32_t>((int32_t) a->arr_state);
+            this->put<int32_t>(this->ref(a->x_tile));
+            this->put<int32_t>(this->ref(a->pin_tile));
+            this->put<int32_t>(this->ref(a->pout_tile));
+            this->put<int32_t>(a->exec_cnt);
+            this->put<int64_t>(a->no_macs);
+            this->put<int64_t>(a->sram_read_bytes);
+            this->put<int64_t>(a->sram_write_bytes);
+            this->put<int64_t>(a->last_no_round);
+            this->put<uint32_t>(a->schedule.size());
+            for (auto& s: a->schedule){
+                this->put<int32_t>(s.first);
+                this->put<int32_t>(this->ref(s.second));
+            }
+        }
+
+        void put_sent(vector<vector<bool>> const& sent){
+            this->put<uint32_t>(sent.size());
+            for (auto& round_sent: sent){
+                this->put<uint32_t>(round_sent.size());
+                for (size_t i = 0; i < round_sent.size(); i += 8){
+                    uint8_t bits = 0;
+                    for (size_t b = 0; b < 8 && i + b < round_sent.size(); b++){
+                        if (round_sent[i + b]) bits |= 1 << b;
+                    }
+                    this->put<uint8_t>(bits);
+                }
+            }
+        }
+
+        void put_traffic(InterconnectTraffic const& traffic){
+            for (long bytes: {traffic.x_bytes, traffic.w_bytes, traffic.pin_bytes, traffic.pout_bytes,
+                    traffic.x_multicast_bytes, traffic.w_multicast_bytes, traffic.pin_multicast_bytes, traffic.pout_multicast_bytes}){
+                this->put<int64_t>(bytes);
+            }
+            this->put_sent(traffic.x_sent);
+            this->put_sent(traffic.w_sent);
+            this->put_sent(traffic.pin_sent);
+            this->put_sent(traffic.pout_sent);
+        }
+
+        void put_pp(PostProcessor* pp){
+            this->put<int32_t>(pp->last_no_round);
+            this->put<int64_t>(pp->no_add_ops);
+            this->put<int64_t>(pp->sram_read_bytes);
+            this->put<int64_t>(pp->sram_write_bytes);
+            this->put<int32_t>((int32_t) pp->state);
+            this->put<int32_t>(pp->exec_cnt);
+            this->put<int32_t>(this->ref(pp->pin1_tile));
+            this->put<int32_t>(this->ref(pp->pin2_tile));
+            this->put<int32_t>(this->ref(pp->pout_tile));
+            this->put<int32_t>(this->ref(pp->curr_op));
+            this->put<uint32_t>(pp->schedule.size());
+            for (auto& s: pp->schedule){
+                this->put<int32_t>(s.first);
+                this->put<int32_t>(this->ref(s.second));
+            }
+        }
+
+        void put_bank(Bank* bank){
+            this->put<int32_t>(bank->capacity);
+            this->put<int32_t>(bank->capacity_used);
+            // allocated_tiles is ordered by address, the order is restored by the map
+            this->put<uint32_t>(bank->allocated_tiles.size());
+            for (auto& t: bank->allocated_tiles){
+                this->put<int32_t>(this->ref(t.first));
+                this->put<int32_t>(t.second);
+            }
+            this->put_queue(bank->evict_queue);
+            this->put_queue(bank->spawn_queue);
+            this->put<uint32_t>(bank->write_back_queue->size());
+            for (auto t: *bank->write_back_queue) this->put<int32_t>(this->ref(t));
+        }
+
+        Compiler* compiler_;
+        string buffer_;
+
+        vector<Tile*> tiles_;
+        vector<Op*> ops_;
+        vector<list<Op*>*> lists_;
+        unordered_map<Tile*, int32_t> tile_index_;
+        unordered_map<Op*, int32_t> op_index_;
+        unordered_map<list<Op*>*, int32_t> list_index_;
+
+        vector<string> strings_;
+        unordered_map<string, uint32_t> string_index_;
+};
+
+class Reader{
+    public:
+        Reader(string const& data) : data_(data) {}
+
+        Schedule* read(){
+            if (this->data_.size() < sizeof(magic) || memcmp(this->data_.data(), magic, sizeof(magic)) != 0){
+                throw runtime_error("Not a schedule file.");
+            }
+            this->pos_ = sizeof(magic);
+            if (this->get<uint32_t>() != byte_order){
+                throw runtime_error("Schedule file has a different byte order.");
+            }
+            this->file_version_ = this->get<uint32_t>();
+            if (this->file_version_ < 1 || this->file_version_ > version){
+                throw runtime_error("Unsupported schedule file version " + to_string(this->file_version_) + ".");
+            }
+
+            Schedule* schedule = new Schedule();
+            this->schedule_ = schedule;
+            try {
+                this->read_schedule();
+            }
+            catch (...) {
+                delete schedule;
+                throw;
+            }
+            return schedule;
+        }
+
+    private:
+        template <typename T>
+        T get(){
+            if (this->data_.size() - this->pos_ < sizeof(T)){
+                throw runtime_error("Schedule file is truncated.");
+            }
+            T v;
+            memcpy(&v, this->data_.data() + this->pos_, sizeof(T));
+            this->pos_ += sizeof(T);
+            return v;
+        }
+
+        string get_string(){
+            uint32_t size = this->get<uint32_t>();
+            if (this->data_.size() - this->pos_ < size){
+                throw runtime_error("Schedule file is truncated.");
+            }
+            string s = this->data_.substr(this->pos_, size);
+            this->pos_ += size;
+            return s;
+        }
+
+        // a count of records that are at least min_size bytes each
+        uint32_t get_count(size_t min_size){
+            uint32_t count = this->get<uint32_t>();
+            if (count > (this->data_.size() - this->pos_) / min_size){
+                throw runtime_error("Schedule file is truncated.");
+            }
+            return count;
+        }
+
+        template <typename T>
+        T* deref(vector<T*> const& table, int32_t index){
+            if (index == -1) return nullptr;
+            if (index < 0 || (size_t) index >= table.size()){
+                throw runtime_error("Schedule file has a corrupt reference.");
+            }
+            return table[index];
+        }
+
+        // a new object owned by owner
+        template <typename T>
+        T* own(vector<unique_ptr<T>>& owner){
+            owner.emplace_back(new T());
+            return owner.back().get();
+        }
+
+        Tile* tile(int32_t index){ return this->deref(this->schedule_->tiles_, index); }
+        Op* op(int32_t index){ return this->deref(this->schedule_->ops_, index); }
+
+        template <typename T>
+        T* tile_as(data_type type){
+            Tile* t = this->tile(this->get<int32_t>());
+            if (t != nullptr && t->type != type){
+                throw runtime_error("Schedule file has a tile of the wrong type.");
+            }
+            return (T*) t;
+        }
+
+        MultOp* mult_op(){
+            Op* o = this->op(this->get<int32_t>());
+            if (o != nullptr && !o->is_multop){
+                throw runtime_error("Schedule file has an op of the wrong type.");
+            }
+            return (MultOp*) o;
+        }
+
+        AggrOp* aggr_op(){
+            Op* o = this->op(this->get<int32_t>());
+            if (o != nullptr && o->is_multop){
+                throw runtime_error("Schedule file has an op of the wrong type.");
+            }
+            return (AggrOp*) o;
+        }
+
+        Bank* bank(int32_t type, int32_t id){
+            if (type == -1) return nullptr;
+            if (type < data_type::X || type > data_type::P || id < 0 || id >= (int32_t) this->banks_[type].size()){
+                throw runtime_error("Schedule file has a corrupt bank reference.");
+            }
+            return this->banks_[type][id];
+        }
+
+        template <typename T>
+        T* unit(map<int, T*>* units, int32_t id){
+            if (id == -1) return nullptr;
+            auto it = units->find(id);
+            if (it == units->end()){
+                throw runtime_error("Schedule file has a corrupt reference.");
+            }
+            return it->second;
+        }
+
+        void read_schedule(){
+            Schedule* s = this->schedule_;
+            s->meta = json::parse(this->get_string());
+
+            int32_t no_arrays = this->get<int32_t>();
+            int32_t no_rows = this->get<int32_t>();
+            int32_t no_cols = this->get<int32_t>();
+            int32_t no_banks = this->get<int32_t>();
+            int32_t bank_size = this->get<int32_t>();
+            int32_t no_pps = this->get<int32_t>();
+            int32_t N = this->get<int32_t>();
+            InterconnectType interconnect_type = (InterconnectType) this->get<uint32_t>();
+            // version 1 has the default Clos network only
+            ClosParams clos;
+            if (this->file_version_ >= 2){
+                clos.m = this->get<int32_t>();
+                clos.n = this->get<int32_t>();
+                clos.r = this->get<int32_t>();
+            }
+            if (no_arrays <= 0 || no_banks <= 0 || no_pps <= 0 || N <= 0){
+                throw runtime_error("Schedule file has a corrupt hardware configuration.");
+            }
+            Interconnects* interconnects;
+            try {
+                interconnects = new Interconnects(N, interconnect_type, clos);
+            }
+            catch (invalid_argument& e){
+                throw runtime_error(string("Schedule file has a corrupt interconnect: ") + e.what());
+            }
+
+            Arrays* arrays = new Arrays(no_arrays, no_rows, no_cols);
+            PostProcessors* post_processors = new PostProcessors(no_pps);
+            Banks* banks = new Banks(no_banks, bank_size);
+            Dram* dram = new Dram(0, 0);
+            Compiler* c = new Compiler(arrays, banks, interconnects, post_processors, dram);
+            s->compiler = c;
+
+            this->banks_[data_type::X].assign(banks->get_x_banks()->begin(), banks->get_x_banks()->end());
+            this->banks_[data_type::W].assign(banks->get_w_banks()->begin(), banks->get_w_banks()->end());
+            this->banks_[data_type::P].assign(banks->get_p_banks()->begin(), banks->get_p_banks()->end());
+
+            c->no_cycles = this->get<int32_t>();
+            c->sram_round_trip = this->get<int32_t>();
+            c->pp_latency_offset = this->get<int32_t>();
+            c->livelock_detected = this->get<uint8_t>();
+            c->memory_stall_cycles = this->get<int32_t>();
+            c->freq = this->get<float>();
+            if (this->file_version_ >= 3){
+                c->no_passes = this->get<int32_t>();
+            }
+
+            dram->prefetch_limit = this->get<int32_t>();
+            dram->bandwidth = this->get<float>();
+            dram->x_tiles_bw_usage = this->get<float>();
+            dram->w_tiles_bw_usage = this->get<float>();
+            dram->p_tiles_bw_usage = this->get<float>();
+            // the tiles are read later, the queues are filled in then
+            size_t load_queue_pos = this->pos_;
+            this->skip_queue();
+
+#define GET_ACTIVITY(x) this->get_activity(interconnects->x##_interconnect);
+            FOR_EACH_INTERCONNECT(GET_ACTIVITY)
+#undef GET_ACTIVITY
+
+            uint32_t no_strings = this->get_count(sizeof(uint32_t));
+            for (uint32_t i = 0; i < no_strings; i++) this->strings_.push_back(this->get_string());
+
+            // the objects of the lists, tiles and ops are allocated before their fields are read
+            uint32_t no_lists = this->get_count(sizeof(uint32_t));
+            size_t lists_pos = this->pos_;
+            for (uint32_t i = 0; i < no_lists; i++){
+                s->lists_.push_back(new list<Op*>());
+                uint32_t size = this->get_count(sizeof(int32_t));
+                this->pos_ += size * sizeof(int32_t);
+            }
+
+            uint32_t no_tiles = this->get_count(1);
+            size_t tiles_pos = this->pos_;
+            for (uint32_t i = 0; i < no_tiles; i++){
+                size_t tile_pos = this->pos_;
+                int32_t type = this->get<int32_t>();
+                if (type == data_type::X) s->tiles_.push_back(this->own(s->x_tiles_));
+                else if (type == data_type::W) s->tiles_.push_back(this->own(s->w_tiles_));
+                else if (type == data_type::P) s->tiles_.push_back(this->own(s->p_tiles_));
+                else throw runtime_error("Schedule file has a tile of unknown type.");
+                s->tiles_.back()->type = (data_type) type;
+                this->pos_ = tile_pos;
+                this->get_tile(nullptr);
+            }
+
+            uint32_t no_ops = this->get_count(1);
+            size_t ops_pos = this->pos_;
+            for (uint32_t i = 0; i < no_ops; i++){
+                size_t op_pos = this->pos_;
+                bool is_multop = this->get<uint8_t>();
+                if (is_multop) s->ops_.push_back(this->own(s->mult_ops_));
+                else s->ops_.push_back(this->own(s->aggr_ops_));
+                s->ops_.back()->is_multop = is_multop;
+                this->pos_ = op_pos;
+                this->get_op(nullptr);
+            }
+            size_t end_of_ops = this->pos_;
+
+            this->pos_ = lists_pos;
+            for (uint32_t i = 0; i < no_lists; i++){
+                uint32_t size = this->get<uint32_t>();
+                for (uint32_t k = 0; k < size; k++) s->lists_[i]->push_back(this->op(this->get<int32_t>()));
+            }
+            this->pos_ = tiles_pos;
+            for (uint32_t i = 0; i < no_tiles; i++) this->get_tile(s->tiles_[i]);
+            this->pos_ = ops_pos;
+            for (uint32_t i = 0; i < no_ops; i++) this->get_op(s->ops_[i]);
+
+            this->pos_ = load_queue_pos;
+            this->get_queue(dram->load_queue);
+
+            this->pos_ = end_of_ops;
+            for (auto it = arrays->array_map->begin(); it != arrays->array_map->end(); it++){
+                this->get_array(it->second);
+            }
+            this->get_traffic(arrays->traffic);
+
+            for (auto it = post_processors->pp_map->begin(); it != post_processors->pp_map->end(); it++){
+                this->get_pp(it->second);
+            }
+
+            for (auto& banks_of_type: this->banks_){
+                for (auto bank: banks_of_type) this->get_bank(bank);
+            }
+
+            if (this->pos_ != this->data_.size()){
+                throw runtime_error("Schedule file has trailing data.");
+            }
+        }
+
+        void skip_queue(){
+            uint32_t size = this->get_count(2 * sizeof(int32_t));
+            this->pos_ += size * 2 * sizeof(int32_t);
+        }
+
+        void get_queue(list<pair<int, Tile*>>* queue){
+            uint32_t size = this->get_count(2 * sizeof(int32_t));
+            for (uint32_t i = 0; i < size; i++){
+                int r = this->get<int32_t>();
+                queue->push_back(make_pair(r, this->tile(this->get<int32_t>())));
+            }
+        }
+
+        void get_activity(InterconnectBase* interconnect){
+            interconnect->config_version = this->get<uint64_t>();
+            interconnect->energy_spent = this->get<float>();
+            uint32_t no_stages = this->get_count(sizeof(double));
+            interconnect->stage_bytes.clear();
+            for (uint32_t k = 0; k < no_stages; k++) interconnect->stage_bytes.push_back(this->get<double>());
+            interconnect->no_deliveries = this->get<uint64_t>();
+            interconnect->no_sources = this->get<uint64_t>();
+            interconnect->max_fanout = this->get<uint64_t>();
+        }
+
+        string const& name(uint32_t index){
+            if (index >= this->strings_.size()){
+                throw runtime_error("Schedule file has a corrupt string reference.");
+            }
+            return this->strings_[index];
+        }
+
+        // t == nullptr only skips the record
+        void get_tile(Tile* t){
+            int32_t type = this->get<int32_t>();
+            string const& layer_name = this->name(this->get<uint32_t>());
+            string tag = this->get_string();
+            int32_t dims0 = this->get<int32_t>();
+            int32_t dims1 = this->get<int32_t>();
+            int32_t precision = this->get<int32_t>();
+            float bytes_fetched = this->get<float>();
+            float bytes_written = this->get<float>();
+            int32_t memory_size = this->get<int32_t>();
+            int32_t input_of = this->get<int32_t>();
+            int32_t output_of = this->get<int32_t>();
+            int32_t bank_type = this->get<int32_t>();
+            int32_t bank_id = this->get<int32_t>();
+            bool is_spawn = this->get<uint8_t>();
+            bool is_allocated_on_sram = this->get<uint8_t>();
+            int32_t id[3] {};
+            id[0] = this->get<int32_t>();
+            id[1] = this->get<int32_t>();
+            if (type == data_type::P) id[2] = this->get<int32_t>();
+            if (t == nullptr) return;
+
+            t->layer_name = layer_name;
+            t->tag = tag;
+            t->dims = make_tuple(dims0, dims1);
+            t->precision = precision;
+            t->bytes_fetched_from_memory = bytes_fetched;
+            t->bytes_written_to_memory = bytes_written;
+            t->memory_size = memory_size;
+            t->input_of = this->deref(this->schedule_->lists_, input_of);
+            t->output_of = this->op(output_of);
+            t->bank = this->bank(bank_type, bank_id);
+            t->is_spawn_ = is_spawn;
+            t->is_allocated_on_sram = is_allocated_on_sram;
+            if (type == data_type::X) ((X_Tile*) t)->id = make_tuple(id[0], id[1]);
+            else if (type == data_type::W) ((W_Tile*) t)->id = make_tuple(id[0], id[1]);
+            else ((P_Tile*) t)->id = make_tuple(id[0], id[1], id[2]);
+        }
+
+        // op == nullptr only skips the record
+        void get_op(Op* op){
+            bool is_multop = this->get<uint8_t>();
+            size_t fields_pos = this->pos_;
+            this->pos_ += sizeof(uint32_t) + 4 * sizeof(int32_t) + 3 * sizeof(uint8_t) + 2 * sizeof(int32_t);
+            this->pos_ += is_multop ? 6 * sizeof(int32_t) : 5 * sizeof(int32_t) + sizeof(uint8_t);
+            if (this->pos_ > this->data_.size()){
+                throw runtime_error("Schedule file is truncated.");
+            }
+            if (op == nullptr) return;
+
+            this->pos_ = fields_pos;
+            op->layer_name = this->name(this->get<uint32_t>());
+            op->round_placed = this->get<int32_t>();
+            int32_t op_ind0 = this->get<int32_t>();
+            int32_t op_ind1 = this->get<int32_t>();
+            int32_t op_ind2 = this->get<int32_t>();
+            op->op_ind = make_tuple(op_ind0, op_ind1, op_ind2);
+            op->is_finalop = this->get<uint8_t>();
+            op->retired = this->get<uint8_t>();
+            op->is_placed_ = this->get<uint8_t>();
+            op->pout_tile = this->tile_as<P_Tile>(data_type::P);
+            op->pair_op = this->op(this->get<int32_t>());
+            if (is_multop){
+                MultOp* m = (MultOp*) op;
+                m->x_tile = this->tile_as<X_Tile>(data_type::X);
+                m->w_tile = this->tile_as<W_Tile>(data_type::W);
+                m->pin_op = this->mult_op();
+                m->aggregated_to = this->mult_op();
+                m->array_placed = this->unit(this->schedule_->compiler->arrays->array_map, this->get<int32_t>());
+                m->weight_buffer_cycles = this->get<int32_t>();
+            }
+            else {
+                AggrOp* a = (AggrOp*) op;
+                a->pin1_tile = this->tile_as<P_Tile>(data_type::P);
+                a->pin2_tile = this->tile_as<P_Tile>(data_type::P);
+                a->operand1 = this->op(this->get<int32_t>());
+                a->operand2 = this->op(this->get<int32_t>());
+                a->pp_placed = this->unit(this->schedule_->compiler->post_processors->pp_map, this->get<int32_t>());
+                a->flip = this->get<uint8_t>();
+            }
+        }
+
+        void get_array(Array* a){
+            a->pipeline_cycles = this->get<int32_t>();
+            a->buf_state = (BUF_STATE) this->get<int32_t>();
+            a->curr_w_tile = this->tile_as<W_Tile>(data_type::W);
+            a->next_w_tile = this->tile_as<W_Tile>(data_type::W);
+            a->curr_op = this->mult_op();
+            a->buf_cnt = this->get<int32_t>();
+            a->arr_state = (ARR_STATE) this->get<int32_t>();
+            a->x_tile = this->tile_as<X_Tile>(data_type::X);
+            a->pin_tile = this->tile_as<P_Tile>(data_type::P);
+            a->pout_tile = this->tile_as<P_Tile>(data_type::P);
+            a->exec_cnt = this->get<int32_t>();
+            a->no_macs = this->get<int64_t>();
+            a->sram_read_bytes = this->get<int64_t>();
+            a->sram_write_bytes = this->get<int64_t>();
+            a->last_no_round = this->get<int64_t>();
+            uint32_t size = this->get_count(2 * sizeof(int32_t));
+            for (uint32_t i = 0; i < size; i++){
+                int r = this->get<int32_t>();
+                a->schedule[r] = this->mult_op();
+            }
+        }
+
+        void get_sent(vector<vector<bool>>& sent){
+            uint32_t no_rounds = this->get_count(sizeof(uint32_t));
+            sent.assign(no_rounds, vector<bool>());
+            for (auto& round_sent: sent){
+                uint32_t size = this->get<uint32_t>();
+                if ((size + 7) / 8 > this->data_.size() - this->pos_){
+                    throw runtime_error("Schedule file is truncated.");
+                }
+                round_sent.resize(size);
+                for (size_t i = 0; i < size; i += 8){
+                    uint8_t bits = this->get<uint8_t>();
+                    for (size_t b = 0; b < 8 && i + b < size; b++){
+                        round_sent[i + b] = bits & (1 << b);
+                    }
+                }
+            }
+        }
+
+        void get_traffic(InterconnectTraffic& traffic){
+            for (long* bytes: {&traffic.x_bytes, &traffic.w_bytes, &traffic.pin_bytes, &traffic.pout_bytes,
+                    &traffic.x_multicast_bytes, &traffic.w_multicast_bytes, &traffic.pin_multicast_bytes, &traffic.pout_multicast_bytes}){
+                *bytes = this->get<int64_t>();
+            }
+            this->get_sent(traffic.x_sent);
+            this->get_sent(traffic.w_sent);
+            this->get_sent(traffic.pin_sent);
+            this->get_sent(traffic.pout_sent);
+        }
+
+        void get_pp(PostProcessor* pp){
+            pp->last_no_round = this->get<int32_t>();
+            pp->no_add_ops = this->get<int64_t>();
+            pp->sram_read_bytes = this->get<int64_t>();
+            pp->sram_write_bytes = this->get<int64_t>();
+            pp->state = (PP_STATE) this->get<int32_t>();
+            pp->exec_cnt = this->get<int32_t>();
+            pp->pin1_tile = this->tile_as<P_Tile>(data_type::P);
+            pp->pin2_tile = this->tile_as<P_Tile>(data_type::P);
+            pp->pout_tile = this->tile_as<P_Tile>(data_type::P);
+            pp->curr_op = this->aggr_op();
+            uint32_t size = this->get_count(2 * sizeof(int32_t));
+            for (uint32_t i = 0; i < size; i++){
+                int r = this->get<int32_t>();
+                pp->schedule[r] = this->aggr_op();
+            }
+        }
+
+        void get_bank(Bank* bank){
+            bank->capacity = this->get<int32_t>();
+            bank->capacity_used = this->get<int32_t>();
+            uint32_t size = this->get_count(2 * sizeof(int32_t));
+            for (uint32_t i = 0; i < size; i++){
+                Tile* t = this->tile(this->get<int32_t>());
+                bank->allocated_tiles[t] = this->get<int32_t>();
+            }
+            this->get_queue(bank->evict_queue);
+            this->get_queue(bank->spawn_queue);
+            size = this->get_count(sizeof(int32_t));
+            for (uint32_t i = 0; i < size; i++){
+                bank->write_back_queue->push_back(this->tile(this->get<int32_t>()));
+            }
+        }
+
+        string const& data_;
+        size_t pos_ {0};
+        uint32_t file_version_ {0};
+        Schedule* schedule_ {nullptr};
+
+        vector<string> strings_;
+        vector<Bank*> banks_[3];
+};
+
+#undef FOR_EACH_INTERCONNECT
+
+Schedule::Schedule(Schedule&& other) noexcept {
+    *this = std::move(other);
+}
+
+Schedule& Schedule::operator=(Schedule&& other) noexcept {
+    if (this != &other){
+        this->release();
+        this->meta = std::move(other.meta);
+        this->compiler = std::exchange(other.compiler, nullptr);
+        this->tiles_ = std::exchange(other.tiles_, {});
+        this->ops_ = std::exchange(other.ops_, {});
+        this->lists_ = std::exchange(other.lists_, {});
+        this->x_tiles_ = std::exchange(other.x_tiles_, {});
+        this->w_tiles_ = std::exchange(other.w_tiles_, {});
+        this->p_tiles_ = std::exchange(other.p_tiles_, {});
+        this->mult_ops_ = std::exchange(other.mult_ops_, {});
+        this->aggr_ops_ = std::exchange(other.aggr_ops_, {});
+    }
+    return *this;
+}
+
+Schedule::~Schedule(){
+    this->release();
+}
+
+void Schedule::release(){
+    if (this->compiler != nullptr){
+        Compiler* c = this->compiler;
+        Arrays* arrays = c->arrays;
+        PostProcessors* post_processors = c->post_processors;
+        Banks* banks = c->banks;
+        Interconnects* interconnects = c->interconnects;
+        Dram* dram = c->dram;
+
+        // the placement workers refer to the interconnects
+        delete c;
+        delete arrays;
+        delete post_processors;
+        delete banks;
+        delete interconnects;
+        delete dram;
+        this->compiler = nullptr;
+    }
+    // the input_of lists are in lists_
+    for (auto t: this->tiles_) t->input_of = nullptr;
+    for (auto l: this->lists_) delete l;
+    this->tiles_.clear();
+    this->ops_.clear();
+    this->lists_.clear();
+    this->x_tiles_.clear();
+    this->w_tiles_.clear();
+    this->p_tiles_.clear();
+    this->mult_ops_.clear();
+    this->aggr_ops_.clear();
+}
+
+void save(Compiler* compiler, json const& meta, string const& path){
+    string buffer = Writer(compiler).write(meta);
+
+    // written under a temporary name, concurrent runs never see a partial file
+    static atomic<unsigned> no_saves {0};
+    string tmp_path = path + ".tmp" + to_string(getpid()) + "-" + to_string(no_saves++);
+    {
+        ofstream out(tmp_path, ofstream::out | ofstream::binary);
+        if (!out.is_open()){
+            throw runtime_error("Schedule file " + path + " cannot be written.");
+        }
+        out.write(buffer.data(), buffer.size());
+        if (!out){
+            out.close();
+            remove(tmp_path.c_str());
+            throw runtime_error("Schedule file " + path + " cannot be written.");
+        }
+    }
+    if (rename(tmp_path.c_str(), path.c_str()) != 0){
+        remove(tmp_path.c_str());
+        throw runtime_error("Schedule file " + path + " cannot be written.");
+    }
+}
+
+Schedule* load(string const& path){
+    ifstream in(path, ifstream::in | ifstream::binary);
+    if (!in.is_open()){
+        throw runtime_error("Schedule file " + path + " cannot be opened.");
+    }
+    string data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    return Reader(data).read();
+}
+
+bool is_schedule_file(string const& path){
+    char buffer[sizeof(magic)] {};
+    ifstream in(path, ifstream::in | ifstream::binary);
+    in.read(buffer, sizeof(buffer));
+    return in.gcount() == sizeof(buffer) && memcmp(buffer, magic, sizeof(magic)) == 0;
+}
+
+namespace {
+
+// FNV-1a
+class Hash{
+    public:
+        void add(char const* data, size_t size){
+            for (size_t i = 0; i < size; i++){
+                this->value ^= (uint8_t) data[i];
+                this->value *= 0x100000001b3;
+            }
+        }
+
+        void add(istream& in){
+            char buffer[1 << 16];
+            while (in.read(buffer, sizeof(buffer)) || in.gcount() > 0){
+                this->add(buffer, in.gcount());
+            }
+        }
+
+        uint64_t value {0xcbf29ce484222325};
+};
+
+// hash of the executable or shared library this file is linked into
+uint64_t compiler_hash(){
+    static uint64_t hash = [](){
+        Dl_info info;
+        if (dladdr((void*) &compiler_hash, &info) == 0 || info.dli_fname == nullptr){
+            throw runtime_error("The compiler binary cannot be found for the schedule cache.");
+        }
+        ifstream in(info.dli_fname, ifstream::in | ifstream::binary);
+        if (!in.is_open()){
+            throw runtime_error("The compiler binary " + string(info.dli_fname) + " cannot be read for the schedule cache.");
+        }
+        Hash h;
+        h.add(in);
+        return h.value;
+    }();
+    return hash;
+}
+
+} // namespace
+
+string cache_path(string const& cache_dir, istream& model, json const& options){
+    Hash h;
+    h.add(model);
+    string key = options.dump() + ":" + to_string(version) + ":" + to_string(compiler_hash());
+    h.add(key.data(), key.size());
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long) h.value);
+
+    std::filesystem::create_directories(cache_dir);
+    return (std::filesystem::path(cache_dir) / name).string();
+}
+
+} // namespace schedule_file
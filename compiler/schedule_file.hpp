@@ -0,0 +1,94 @@
+#ifndef SCHEDULE_FILE_HPP
+#define SCHEDULE_FILE_HPP
+
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <list>
+
+#include "compiler.hpp"
+
+#include "nlohmann/json.hpp"
+
+using json = nlohmann::json;
+using namespace std;
+
+// Binary schedule (schedule.bin): the state of the compiler after compilation,
+// so that the cycle model can be run for several memory configurations
+// without compiling the models again (see run_cycle_model).
+//
+// Every tile, op and Tile::input_of list reachable from the arrays, post
+// processors, banks and dram is stored once in a table, and the pointers
+// between them as indices into the tables (-1 for nullptr). Objects shared
+// through several pointers are still shared after loading. The sections
+// follow each other in the order below, a table is a count and its records:
+//
+//   header      magic, byte order, version, meta (JSON string)
+//   hardware    no. of arrays, rows, cols, banks, bank capacity, interconnect type
+//               and Clos parameters (since version 2)
+//   compiler    cycle counters, no. of passes (since version 3), dram state
+//               and queue, interconnect activity
+//   strings     layer names
+//   lists       input_of lists
+//   tiles, ops
+//   arrays, post processors, banks   state, schedules and queues
+//
+// Integers and floats are written in the byte order of the host, a file from
+// a host with a different byte order is rejected.
+namespace schedule_file {
+
+const char magic[8] = {'S', 'O', 'S', 'A', 'S', 'C', 'H', '\0'};
+const uint32_t byte_order = 0x01020304;
+const uint32_t version = 3;
+
+// A loaded schedule, owns the compiler, its hardware models and all tiles and ops.
+class Schedule{
+    public:
+        // the args of the precompiled model and the compile options, see save()
+        json meta;
+        Compiler* compiler {nullptr};
+
+        Schedule(Schedule const&) = delete;
+        Schedule& operator=(Schedule const&) = delete;
+        Schedule(Schedule&& other) noexcept;
+        Schedule& operator=(Schedule&& other) noexcept;
+        ~Schedule();
+
+    private:
+        friend class Reader;
+
+        Schedule(){};
+        void release();
+
+        // the tables of the file, indexed by the references between the objects
+        vector<Tile*> tiles_;
+        vector<Op*> ops_;
+        vector<list<Op*>*> lists_;
+
+        // Tile and Op have no virtual destructor, the tiles and ops of the
+        // tables are owned through their concrete types
+        vector<unique_ptr<X_Tile>> x_tiles_;
+        vector<unique_ptr<W_Tile>> w_tiles_;
+        vector<unique_ptr<P_Tile>> p_tiles_;
+        vector<unique_ptr<MultOp>> mult_ops_;
+        vector<unique_ptr<AggrOp>> aggr_ops_;
+};
+
+// Saves the compiler after the models are compiled and before run_cycle_model,
+// which consumes the schedule. meta is returned by load() as it is.
+void save(Compiler* compiler, json const& meta, string const& path);
+Schedule* load(string const& path);
+bool is_schedule_file(string const& path);
+
+// Schedule cache for sweeps over the memory bandwidth and prefetch limit,
+// which do not change the schedule. A schedule is cached as <key>.bin in
+// cache_dir, the key is a hash of the precompiled model, of options (the
+// compile options that change the schedule) and of the binary of the
+// compiler, so any rebuild of the compiler starts a new cache.
+string cache_path(string const& cache_dir, istream& model, json const& options);
+
+} // namespace schedule_file
+
+#endif /* SCHEDULE_FILE_HPP */
@@ -0,0 +1,223 @@
+#include "sweep.hpp"
+
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "compiler.hpp"
+#include "array.hpp"
+#include "bank.hpp"
+#include "post_processor.hpp"
+#include "dram.hpp"
+#include "profile.hpp"
+
+namespace sweep {
+
+Config parse_config(json const& j, Config const& defaults){
+    Config config = defaults;
+    config.no_array = j.value("no_array", defaults.no_array);
+    config.no_rows = j.value("no_rows", defaults.no_rows);
+    config.no_cols = j.value("no_cols", defaults.no_cols);
+    config.bank_size = j.value("bank_size", defaults.bank_size);
+    config.bandwidth = j.value("memory_bw", defaults.bandwidth);
+    config.prefetch_limit = j.value("prefetch", defaults.prefetch_limit);
+    config.partition_size = j.value("partition_size", defaults.partition_size);
+    config.clos.m = j.value("clos_m", defaults.clos.m);
+    config.clos.n = j.value("clos_n", defaults.clos.n);
+    config.clos.r = j.value("clos_r", defaults.clos.r);
+    if (j.contains("ict_type")){
+        istringstream iss(j.at("ict_type").get<string>());
+        iss >> config.interconnect_type;
+        if (!iss){
+            throw runtime_error("Unknown interconnect type " + j.at("ict_type").get<string>());
+        }
+    }
+    return config;
+}
+
+ModelDescription::ModelDescription(string const& json_dump){
+    this->doc_ = json::parse(json_dump);
+    this->args_ = this->doc_.at("args");
+}
+
+ModelDescription* ModelDescription::load(string const& path){
+    if (model_format::is_model_file(path)){
+        ModelDescription* models = new ModelDescription();
+        models->file_ = new model_format::ModelFile(path);
+        models->args_ = json::parse(models->file_->str(models->file_->header().args));
+        return models;
+    }
+
+    ifstream input_file(path, ifstream::in);
+    if (!input_file.is_open()){
+        throw runtime_error("Input file " + path + " cannot be opened.");
+    }
+    stringstream buffer;
+    buffer << input_file.rdbuf();
+    return new ModelDescription(buffer.str());
+}
+
+ModelDescription::~ModelDescription(){
+    delete this->file_;
+}
+
+size_t ModelDescription::no_models() const {
+    if (this->file_ != nullptr) return this->file_->no_models();
+    // every key but "args" is a model
+    return this->doc_.size() - 1;
+}
+
+vector<Model*> ModelDescription::build() const {
+    vector<Model*> models;
+    if (this->file_ != nullptr){
+        for (size_t i = 0; i < this->file_->no_models(); i++){
+            models.push_back(new Model(*this->file_, i));
+        }
+        return models;
+    }
+
+    // the object keys are sorted, as in import_models
+    for (auto it = this->doc_.begin(); it != this->doc_.end(); it++){
+        if (it.key() == "args") continue;
+        models.push_back(new Model(it.key(), it.value()));
+    }
+    return models;
+}
+
+Session::Session(ModelDescription const& models, Config const& config){
+    float freq = 1e9;
+    float bandwidth = config.bandwidth * ((1 << 30) / freq);
+
+    if (models.no_models() == 0){
+        throw runtime_error("No model to compile.");
+    }
+    // throws on invalid Clos parameters, before anything else is allocated
+    this->interconnects_ = new Interconnects(config.no_array, config.interconnect_type, config.clos);
+    this->arrays_ = new Arrays(config.no_array, config.no_rows, config.no_cols);
+    this->post_processors_ = new PostProcessors(config.no_array);
+    this->banks_ = new Banks(config.no_array, config.bank_size);
+    this->dram_ = new Dram(bandwidth, config.prefetch_limit);
+
+    this->compiler = new Compiler(this->arrays_, this->banks_, this->interconnects_, this->post_processors_, this->dram_);
+    this->compiler->freq = freq;
+    this->compiler->partition_size = config.partition_size;
+
+    // the destructor is not called if the constructor throws
+    try {
+        this->models = models.build();
+
+        Model* model = nullptr;
+        for (Model* m: this->models){
+            model = m;
+            this->compiler->compile(model);
+            this->compiler->duplicate_schedule(model, model->no_repeat);
+        }
+
+        this->sim_config_ = models.args();
+        this->sim_config_["no_array"] = config.no_array;
+        this->sim_config_["interconnect_type"] = config.interconnect_type;
+        this->sim_config_["bank_size"] = config.bank_size;
+        this->sim_config_["no_layers"] = model->layer_list->size();
+        this->sim_config_["total_no_gemm_ops"] = model->total_no_gemm_ops();
+        this->compiler->add_array_config(this->sim_config_);
+
+        this->compiler->save_cycle_model_state();
+    }
+    catch (...){
+        this->release();
+        throw;
+    }
+}
+
+Session::~Session(){
+    this->release();
+}
+
+void Session::release(){
+    delete this->compiler;
+    delete this->arrays_;
+    delete this->post_processors_;
+    delete this->banks_;
+    delete this->interconnects_;
+    delete this->dram_;
+    for (Model* m: this->models) delete m;
+
+    this->compiler = nullptr;
+    this->models.clear();
+}
+
+json Session::simulate(RoundStats* round_stats){
+    lock_guard<mutex> lock(this->mutex_);
+    return this->simulate_(round_stats);
+}
+
+json Session::run(float bandwidth, int prefetch_limit, RoundStats* round_stats){
+    lock_guard<mutex> lock(this->mutex_);
+
+    //Convert GB/s to Bytes per cycle
+    this->dram_->bandwidth = bandwidth * ((1 << 30) / this->compiler->freq);
+    this->dram_->prefetch_limit = prefetch_limit;
+
+    return this->simulate_(round_stats);
+}
+
+json Session::simulate_(RoundStats* round_stats){
+    if (this->no_runs_ > 0) this->compiler->reset_cycle_model();
+    this->no_runs_++;
+
+    this->compiler->round_stats = round_stats;
+    this->compiler->run_cycle_model();
+    this->compiler->round_stats = nullptr;
+
+    return this->compiler->sim_results(this->sim_config_);
+}
+
+json run_config(ModelDescription const& models, Config const& config, ScheduleArrays* schedule, RoundStats* round_stats){
+    #ifdef COMPILER_PROFILE
+    profile::Profile run_profile;
+    profile::Scope profile_scope(run_profile);
+    #endif
+
+    Session session(models, config);
+    if (schedule != nullptr) schedule->read(session.compiler, session.models);
+
+    json jout = session.simulate(round_stats);
+    #ifdef COMPILER_PROFILE
+    jout["profile"] = run_profile.to_json();
+    #endif
+
+    return jout;
+}
+
+vector<json> run(ModelDescription const& models, vector<Config> const& configs, int no_threads){
+    vector<json> results(configs.size());
+    atomic<size_t> next {0};
+
+    // every thread takes the next configuration until none is left
+    auto work = [&](){
+        for (size_t i = next++; i < configs.size(); i = next++){
+            try {
+                results[i] = run_config(models, configs[i]);
+            }
+            catch (exception& e){
+                results[i] = {{"error", e.what()}};
+            }
+        }
+    };
+
+    no_threads = max(1, min(no_threads, (int) configs.size()));
+    vector<thread> threads;
+    for (int t = 1; t < no_threads; t++){
+        threads.emplace_back(work);
+    }
+    work();
+    for (auto& t: threads){
+        t.join();
+    }
+
+    return results;
+}
+
+} // namespace sweep
@@ -0,0 +1,129 @@
+#ifndef SWEEP_HPP
+#define SWEEP_HPP
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "interconnect.hpp"
+#include "layer.hpp"
+#include "model_format.hpp"
+#include "round_stats.hpp"
+#include "schedule_arrays.hpp"
+
+#include "nlohmann/json.hpp"
+
+using json = nlohmann::json;
+using namespace std;
+
+class Compiler;
+class Arrays;
+class PostProcessors;
+class Banks;
+class Dram;
+
+// In-process sweep over hardware configurations
+//
+// The precompiled model is parsed once and shared read-only by all runs; every
+// run builds its own models, hardware and compiler from it, so the runs are
+// independent and are spread over a pool of threads. An untiled model is tiled
+// for the arrays of every configuration; the tiles of a tiled model are used as
+// they are, so its configurations should keep the array shape of the precompiler.
+namespace sweep {
+
+struct Config {
+    int no_array;
+    int no_rows;
+    int no_cols;
+    int bank_size;
+    float bandwidth;        // GB/s
+    int prefetch_limit;
+    InterconnectType interconnect_type;
+    int partition_size {0};  // of an untiled model, see Compiler::partition_size
+    ClosParams clos {};
+};
+
+// Reads {"no_array", "no_rows", "no_cols", "bank_size", "memory_bw", "prefetch", "ict_type", "partition_size",
+// "clos_m", "clos_n", "clos_r"},
+// the keys that are missing are taken from defaults.
+Config parse_config(json const& j, Config const& defaults);
+
+// Precompiled models, either a parsed JSON document or a mapped binary model file
+class ModelDescription{
+    public:
+        // precompiled_model.json content
+        explicit ModelDescription(string const& json_dump);
+        // .json or .bin file
+        static ModelDescription* load(string const& path);
+        ModelDescription(ModelDescription const&) = delete;
+        ModelDescription& operator=(ModelDescription const&) = delete;
+        ~ModelDescription();
+
+        json const& args() const { return this->args_; }
+
+        size_t no_models() const;
+        // new models in compile order, the caller owns them
+        vector<Model*> build() const;
+
+    private:
+        ModelDescription() {}
+
+        json doc_;
+        json args_;
+        model_format::ModelFile* file_ {nullptr};
+};
+
+// The models compiled once for one configuration, for several runs of the cycle
+// model. The memory bandwidth and the prefetch limit do not change the schedule;
+// a run after the first resets the state of the cycle model instead of
+// compiling again (see Compiler::reset_cycle_model). The runs of a session
+// take turns, different sessions can run in parallel.
+class Session{
+    public:
+        Session(ModelDescription const& models, Config const& config);
+        Session(Session const&) = delete;
+        Session& operator=(Session const&) = delete;
+        ~Session();
+
+        // the models own the tiles and ops of the schedule
+        Compiler* compiler {nullptr};
+        vector<Model*> models;
+
+        // Runs the cycle model with the memory settings of the dram, the
+        // sim_results of the last model.
+        json simulate(RoundStats* round_stats = nullptr);
+        // simulate with the memory bandwidth (GB/s) and prefetch limit given,
+        // which are added to the results as by run_cycle_model
+        json run(float bandwidth, int prefetch_limit, RoundStats* round_stats = nullptr);
+
+        int no_runs() const { return this->no_runs_; }
+        // the args of the models and the hardware configuration, as in the results
+        json const& sim_config() const { return this->sim_config_; }
+
+    private:
+        void release();
+        json simulate_(RoundStats* round_stats);
+
+        Arrays* arrays_ {nullptr};
+        PostProcessors* post_processors_ {nullptr};
+        Banks* banks_ {nullptr};
+        Interconnects* interconnects_ {nullptr};
+        Dram* dram_ {nullptr};
+
+        json sim_config_;
+        int no_runs_ {0};
+        mutex mutex_;
+};
+
+// Compiles and simulates one configuration, the sim_results of the last model.
+// The compiled schedule is read into schedule and the rounds of the cycle model
+// are recorded by round_stats, if they are given.
+json run_config(ModelDescription const& models, Config const& config, ScheduleArrays* schedule = nullptr, RoundStats* round_stats = nullptr);
+
+// Runs the configurations on no_threads threads and returns their results in
+// the order of configs. A configuration that fails has {"error": message} as result.
+vector<json> run(ModelDescription const& models, vector<Config> const& configs, int no_threads);
+
+} // namespace sweep
+
+#endif /* SWEEP_HPP */
@@ -3,11 +3,26 @@
 #include <boost/test/included/unit_test.hpp>
 #include <boost/test/data/test_case.hpp>
 #include <boost/test/data/monomorphic.hpp>
+#include <algorithm>
+#include <filesystem>
 #include <memory>
+#include <random>
+#include <thread>
 
 namespace bdata = boost::unit_test::data;
 
 #include <interconnect.hpp>
+#include <array.hpp>
+#include <compiler.hpp>
+#include <model_format.hpp>
+#include <model_reader.hpp>
+#include <schedule_file.hpp>
+#include <trace.hpp>
+#include <profile.hpp>
+#include <round_stats.hpp>
+#include <results_store.hpp>
+#include <schedule_arrays.hpp>
+#include <sweep.hpp>
 
 BOOST_AUTO_TEST_CASE(test_interconnect_ctor) {
     {
@@ -29,4 +44,1084 @@ BOOST_AUTO_TEST_CASE(test_interconnect_ctor) {
         auto ict = Interconnects(32, InterconnectType::banyan_exp_3);
         BOOST_TEST(ict.pin_interconnect->num_ports() == 256);
     }
+
+    {
+        auto ict = Interconnects(32, InterconnectType::clos_strict);
+        BOOST_TEST(ict.pin_interconnect->num_ports() == 32);
+        BOOST_TEST(ict.clos.n == 4);
+        BOOST_TEST(ict.clos.r == 8);
+        BOOST_TEST(ict.clos.m == 7);
+    }
+
+    {
+        auto ict = Interconnects(32, InterconnectType::clos_rearrangeable, {12, 0, 4});
+        BOOST_TEST(ict.pin_interconnect->num_ports() == 32);
+        BOOST_TEST(ict.clos.n == 8);
+        BOOST_TEST(((Clos *) ict.pin_interconnect)->impl.m() == 12);
+        BOOST_TEST(((Clos *) ict.pin_interconnect)->impl.r() == 4);
+    }
+
+    BOOST_CHECK_THROW(Interconnects(32, InterconnectType::clos_strict, {0, 4, 4}), std::invalid_argument);
+    BOOST_CHECK_THROW(Interconnects(32, InterconnectType::clos_rearrangeable, {3, 4, 8}), std::invalid_argument);
+    BOOST_TEST(Interconnects(32, InterconnectType::banyan, {3, 4, 8}).clos.n == 0);
+}
+BOOST_AUTO_TEST_CASE(test_inplace_propagate) {
+    std::mt19937 mt(0);
+    for (UnsignedInt n = 2; n <= 6; ++n) {
+        multistage_interconnect::Benes benes(n);
+        multistage_interconnect::Banyan banyan(n);
+        for (auto &stage: benes.stages)
+            for (auto &sw: stage.switch_states)
+                sw.outputs[0] = (Int) (mt() % 3) - 1, sw.outputs[1] = (Int) (mt() % 3) - 1;
+        for (auto &stage: banyan.stages)
+            for (auto &sw: stage.switch_states)
+                sw.outputs[0] = (Int) (mt() % 3) - 1, sw.outputs[1] = (Int) (mt() % 3) - 1;
+
+        std::vector<Int> packets(1 << n), output(1 << n), scratch(1 << n);
+        for (Int i = 0; i < (1 << n); ++i) packets[i] = i;
+
+        benes.propagate(packets.data(), output.data(), scratch.data(), -1);
+        BOOST_TEST(output == benes.propagate(packets, -1));
+
+        banyan.propagate(packets.data(), output.data(), scratch.data(), -1);
+        BOOST_TEST(output == banyan.propagate(packets, -1));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_verify_round) {
+    std::mt19937 mt(0);
+    for (auto type: {InterconnectType::benes_vanilla, InterconnectType::banyan_exp_0, InterconnectType::banyan_exp_1}) {
+        auto ict = Interconnects(16, type);
+        auto *x = ict.x_interconnect;
+        for (int trial = 0; trial < 64; ++trial) {
+            std::vector<Int> v(x->num_ports(), -1);
+            for (int i = 0; i < 16; ++i)
+                if (mt() % 4)
+                    v[i] = mt() % 16;
+            if (x->do_apply_permute(&v[0]))
+                BOOST_TEST(x->do_verify_round(&v[0]));
+        }
+    }
+
+    // a round is verified on the scratch network, the compiled one is left as it is
+    struct Port { int id; };
+    std::vector<Port> ports;
+    for (int i = 0; i < 16; ++i) ports.push_back({i});
+    for (auto type: {InterconnectType::benes_vanilla, InterconnectType::banyan_exp_0, InterconnectType::clos_rearrangeable}) {
+        auto ict = Interconnects(16, type);
+        auto *x = ict.x_interconnect;
+        std::vector<Int> compiled(16, -1);
+        compiled[2] = 5;
+        BOOST_TEST(x->do_apply_permute(&compiled[0]));
+        auto version = x->config_version;
+
+        std::map<Port *, Port *> round{{&ports[2], &ports[7]}, {&ports[3], &ports[7]}};
+        BOOST_TEST(x->verify_round(&round));
+        BOOST_TEST(x->config_version == version);
+        BOOST_TEST(x->do_verify_round(&compiled[0]));
+        BOOST_TEST(!x->do_is_route_free(7, 2));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_clos_routing) {
+    std::mt19937 mt(0);
+    for (auto type: {InterconnectType::clos_rearrangeable, InterconnectType::clos_strict}) {
+        for (int N: {16, 32, 64}) {
+            auto ict = Interconnects(N, type);
+            auto *x = ict.x_interconnect;
+
+            // both variants are nonblocking for unicast
+            for (int trial = 0; trial < 32; ++trial) {
+                std::vector<Int> v(N);
+                for (int i = 0; i < N; ++i) v[i] = i;
+                std::shuffle(v.begin(), v.end(), mt);
+                x->reset();
+                BOOST_TEST(x->do_apply_permute(&v[0]));
+                BOOST_TEST(x->do_verify_round(&v[0]));
+            }
+
+            // multicast connections added one by one as the compiler does
+            for (int trial = 0; trial < 32; ++trial) {
+                std::vector<Int> v(N, -1);
+                x->reset();
+                for (int k = 0; k < 2 * N; ++k) {
+                    UnsignedInt src = mt() % (N / 2), dest = mt() % N;
+                    // the check in place agrees with routing on a copy
+                    auto copy = static_cast<Clos *>(x)->impl;
+                    bool routable = v[dest] == -1 && copy.route(src, dest);
+                    BOOST_TEST(x->do_is_route_free(src, dest) == routable);
+                    if (!routable)
+                        continue;
+                    v[dest] = src;
+                    BOOST_TEST(x->do_apply_permute(&v[0]));
+                }
+                BOOST_TEST(x->do_verify_round(&v[0]));
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_record_activity) {
+    std::vector<long> src_bytes(16, 64);
+
+    // unicast: every stage carries one copy per destination
+    auto banyan = Interconnects(16, InterconnectType::banyan_exp_0);
+    std::vector<Int> identity(16);
+    for (int i = 0; i < 16; ++i) identity[i] = i;
+    banyan.x_interconnect->record_activity(&identity[0], &src_bytes[0], 1e9);
+    BOOST_TEST(banyan.x_interconnect->stage_bytes == std::vector<double>(4, 16 * 64));
+    BOOST_TEST(banyan.x_interconnect->avg_fanout() == 1);
+    BOOST_TEST(banyan.x_interconnect->energy_spent == banyan.x_interconnect->energy_per_byte_stage(1e9) * 4 * 16 * 64,
+               boost::test_tools::tolerance(1e-5f));
+
+    // broadcast: the Benes tree fans out in the last stages, the bus sends once
+    std::vector<Int> broadcast(16, 3);
+    for (auto type: {InterconnectType::benes_vanilla, InterconnectType::bus, InterconnectType::clos_rearrangeable}) {
+        auto ict = Interconnects(16, type);
+        auto *x = ict.x_interconnect;
+        x->record_activity(&broadcast[0], &src_bytes[0], 1e9);
+        BOOST_TEST(x->max_fanout == 16);
+        BOOST_TEST(x->stage_bytes.size() == x->num_stages());
+        BOOST_TEST(x->stage_bytes.front() == 64);
+        BOOST_TEST(x->stage_bytes.back() == (type == InterconnectType::bus ? 64 : 16 * 64));
+        BOOST_TEST(x->energy_spent > 0);
+
+        // the same round again is not routed, its activity is added once more
+        auto energy = x->energy_spent;
+        auto stage_bytes = x->stage_bytes;
+        x->record_activity(&broadcast[0], &src_bytes[0], 1e9);
+        BOOST_TEST(x->energy_spent == 2 * energy, boost::test_tools::tolerance(1e-5f));
+        BOOST_TEST(x->stage_bytes.back() == 2 * stage_bytes.back());
+        BOOST_TEST(x->avg_fanout() == 16);
+
+        // a mapping applied in between is routed again
+        x->reset();
+        x->record_activity(&broadcast[0], &src_bytes[0], 1e9);
+        BOOST_TEST(x->stage_bytes.back() == 3 * stage_bytes.back());
+    }
+
+    // the routing of the activity leaves the compiled network alone
+    for (auto type: {InterconnectType::benes_vanilla, InterconnectType::bus, InterconnectType::clos_rearrangeable, InterconnectType::banyan_exp_0}) {
+        auto ict = Interconnects(16, type);
+        auto *x = ict.x_interconnect;
+        std::vector<Int> compiled(16, -1);
+        compiled[2] = 5;
+        BOOST_TEST(x->do_apply_permute(&compiled[0]));
+        auto version = x->config_version;
+        x->record_activity(&identity[0], &src_bytes[0], 1e9);
+        BOOST_TEST(x->config_version == version);
+        BOOST_TEST(x->do_verify_round(&compiled[0]));
+        BOOST_TEST(!x->do_is_route_free(7, 2));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_interconnects_snapshot) {
+    struct Port { int id; };
+    Port bank{3}, array{5};
+    std::map<Port *, Port *> permute{{&array, &bank}};
+
+    for (auto type: {InterconnectType::benes_vanilla, InterconnectType::banyan_exp_1}) {
+        auto ict = Interconnects(16, type);
+        InterconnectsSnapshot snapshot;
+        snapshot.attach(&ict);
+
+        bool shared = snapshot.x_interconnect() == ict.x_interconnect;
+        BOOST_TEST(shared == !ict.x_interconnect->is_route_check_mutating());
+
+        ict.x_interconnect->apply_permute(&permute);
+        auto *view = snapshot.x_interconnect();
+        BOOST_TEST(view->config_version == ict.x_interconnect->config_version);
+        for (int src = 0; src < 16; ++src) {
+            for (int dest = 0; dest < 16; ++dest) {
+                Port s{src}, d{dest};
+                BOOST_TEST(view->is_route_free(&s, &d) == ict.x_interconnect->is_route_free(&s, &d));
+            }
+        }
+
+        // a reset is a new configuration as well
+        ict.x_interconnect->reset();
+        view = snapshot.x_interconnect();
+        BOOST_TEST(view->config_version == ict.x_interconnect->config_version);
+        BOOST_TEST(view->is_route_free(&array, &bank));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_interconnect_traffic) {
+    Arrays arrays(4, 8, 8);
+    Bank x_bank(0, data_type::X, 1024), w_bank0(0, data_type::W, 1024), w_bank1(1, data_type::W, 1024);
+    Bank p_bank0(0, data_type::P, 1024), p_bank1(1, data_type::P, 1024), p_bank2(2, data_type::P, 1024);
+
+    // one x tile multicast to both arrays, separate weights and partial sums
+    X_Tile x("l", {0, 0}, {8, 8}, 1, 64);
+    W_Tile w0("l", {0, 0}, {8, 8}, 1, 64);
+    W_Tile w1("l", {0, 1}, {8, 8}, 1, 64);
+    P_Tile p0("l", {0, 0, 0}, {8, 8}, 2, 128);
+    P_Tile p1("l", {0, 1, 0}, {8, 8}, 2, 128);
+    x.assign_bank(&x_bank);
+    w0.assign_bank(&w_bank0);
+    w1.assign_bank(&w_bank1);
+    p0.assign_bank(&p_bank0);
+    p1.assign_bank(&p_bank1);
+    MultOp op0("l", {0, 0, 0}, &x, &w0, &p0);
+    MultOp op1("l", {0, 1, 0}, &x, &w1, &p1);
+    (*arrays.array_map)[0]->assign_op(0, &op0);
+    (*arrays.array_map)[1]->assign_op(0, &op1);
+
+    BOOST_TEST(arrays.traffic.x_bytes == 128);
+    BOOST_TEST(arrays.traffic.x_multicast_bytes == 64);
+    BOOST_TEST(arrays.traffic.w_multicast_bytes == 128);
+    BOOST_TEST(arrays.traffic.pout_multicast_bytes == 256);
+
+    // the same tile in the next round is sent again, a pin assigned after placement is counted
+    P_Tile p2("l", {0, 0, 1}, {8, 8}, 2, 128);
+    p2.assign_bank(&p_bank2);
+    MultOp op2("l", {0, 0, 1}, &x, &w0, &p2);
+    (*arrays.array_map)[0]->assign_op(1, &op2);
+    op2.assign_pin(&op0);
+    arrays.traffic.add_pin(1, &op2);
+
+    BOOST_TEST(arrays.traffic.x_multicast_bytes == 128);
+    BOOST_TEST(arrays.traffic.pin_bytes == 128);
+    BOOST_TEST(arrays.traffic.total_bytes() == 3 * 64 + 3 * 64 + 128 + 3 * 128);
+    BOOST_TEST(arrays.traffic.total_multicast_bytes() == 2 * 64 + 3 * 64 + 128 + 3 * 128);
+}
+
+// GEMM layer of 32x32 tiles in the precompiled model format, with the dims
+// of every tile or the uniform tile size
+json gemm_layer_json(int rows, int inner, int cols, std::vector<std::string> deps, int raw_input, bool uniform = false) {
+    auto dim = [](int size, int i) { return std::min(32, size - 32 * i); };
+    int a = (rows + 31) / 32, b = (inner + 31) / 32, c = (cols + 31) / 32;
+    json x_tile_dim, w_tile_dim;
+    for (int i = 0; i < a; ++i)
+        for (int j = 0; j < b; ++j)
+            x_tile_dim[std::to_string(i)][std::to_string(j)] = {dim(rows, i), dim(inner, j)};
+    for (int i = 0; i < b; ++i)
+        for (int j = 0; j < c; ++j)
+            w_tile_dim[std::to_string(i)][std::to_string(j)] = {dim(inner, i), dim(cols, j)};
+    json gemm_op = {{"input_size", {rows, inner}}, {"weight_size", {inner, cols}}, {"no_tiles", {a, b, c}}};
+    if (uniform) {
+        gemm_op["tile_size"] = {32, 32, 32};
+    } else {
+        gemm_op["x_tile_dim"] = x_tile_dim;
+        gemm_op["w_tile_dim"] = w_tile_dim;
+    }
+    return {{"gemm_op", gemm_op}, {"deps", deps}, {"raw_input", raw_input}, {"layer_type", "Dense"}};
+}
+
+// more ops than arrays, most of them are placed after several failed rounds
+json two_layer_model_json() {
+    json j;
+    j["order"] = {"input", "dense1", "dense2"};
+    j["layers"]["input"] = {{"gemm_op", nullptr}, {"deps", json::array()}, {"raw_input", 1}, {"layer_type", "InputLayer"}};
+    j["layers"]["dense1"] = gemm_layer_json(100, 64, 250, {"input"}, 1);
+    j["layers"]["dense2"] = gemm_layer_json(100, 250, 130, {"dense1"}, 0);
+    j["no_repeat"] = 1;
+    return j;
+}
+
+// a dense model and a convolution in the precompiled model format
+json two_model_json(bool uniform = false) {
+    json jin;
+    jin["args"] = {{"batch_size", 4}, {"model", "toy"}};
+    jin["toy"] = two_layer_model_json();
+    if (uniform) {
+        jin["toy"]["layers"]["dense1"] = gemm_layer_json(100, 64, 250, {"input"}, 1, true);
+        jin["toy"]["layers"]["dense2"] = gemm_layer_json(100, 250, 130, {"dense1"}, 0, true);
+    }
+    jin["conv"]["order"] = {"conv1"};
+    jin["conv"]["layers"]["conv1"] = gemm_layer_json(70, 27, 40, {}, 1, uniform);
+    jin["conv"]["layers"]["conv1"]["layer_type"] = "Conv2D";
+    jin["conv"]["layers"]["conv1"]["gemm_op"]["kernel_size"] = {3, 3};
+    jin["conv"]["no_repeat"] = 3;
+    return jin;
+}
+
+// only the GEMM shapes, the compiler tiles the layers
+json untiled_model_json() {
+    json jin = two_model_json();
+    for (auto &m: jin.items()) {
+        if (m.key() == "args") continue;
+        for (auto &l: m.value()["layers"].items()) {
+            json &gemm_op = l.value()["gemm_op"];
+            if (gemm_op.is_null()) continue;
+            for (char const *key: {"no_tiles", "tile_size", "x_tile_dim", "w_tile_dim"}) gemm_op.erase(key);
+        }
+    }
+    return jin;
+}
+
+// 8 arrays of 32x32 with their banks, interconnects, post processors, dram
+// and compiler; the compiled models are freed after the hardware
+struct CompilerFixture {
+    std::vector<std::unique_ptr<Model>> models;
+    Arrays arrays {8, 32, 32};
+    Banks banks {8, 524288};
+    Interconnects interconnects;
+    PostProcessors post_processors {8};
+    Dram dram;
+    Compiler compiler {&arrays, &banks, &interconnects, &post_processors, &dram};
+
+    CompilerFixture(InterconnectType type = InterconnectType::crossbar, float bandwidth = 8)
+        : interconnects(8, type), dram(bandwidth, 100) {
+        boost::log::core::get()->set_logging_enabled(false);
+    }
+
+    // compiles the models of jin in order, and repeats them no_repeat times if duplicate
+    void compile(json const &jin, bool duplicate = true) {
+        for (auto it = jin.begin(); it != jin.end(); ++it) {
+            if (it.key() == "args") continue;
+            this->models.emplace_back(new Model(it.key(), it.value()));
+            Model *model = this->models.back().get();
+            this->compiler.compile(model);
+            if (duplicate) this->compiler.duplicate_schedule(model, model->no_repeat);
+        }
+    }
+};
+
+void check_same_model(Model &model, Model &expected) {
+    BOOST_TEST(model.model_name == expected.model_name);
+    BOOST_TEST(model.no_repeat == expected.no_repeat);
+    BOOST_TEST_REQUIRE(model.layer_list->size() == expected.layer_list->size());
+    for (auto l1 = model.begin(), l2 = expected.begin(); l1 != model.end(); ++l1, ++l2) {
+        BOOST_TEST(l1->layer_name == l2->layer_name);
+        BOOST_TEST_REQUIRE((l1->no_tiles == l2->no_tiles));
+        auto [a, b, c] = l1->no_tiles;
+        BOOST_TEST((l1->x_tile_dims.to_map(a, b) == l2->x_tile_dims.to_map(a, b)));
+        BOOST_TEST((l1->w_tile_dims.to_map(b, c) == l2->w_tile_dims.to_map(b, c)));
+        BOOST_TEST((l1->input_size == l2->input_size));
+        BOOST_TEST((l1->weight_size == l2->weight_size));
+        BOOST_TEST(l1->raw_input == l2->raw_input);
+        BOOST_TEST(l1->is_conv == l2->is_conv);
+        BOOST_TEST((l1->conv_kernel_size == l2->conv_kernel_size));
+        BOOST_TEST((*l1->dependencies == *l2->dependencies));
+    }
+}
+
+// the models mapped from the binary format match the ones parsed from the JSON
+BOOST_AUTO_TEST_CASE(test_model_file) {
+    json jin = two_model_json();
+
+    auto path = std::filesystem::temp_directory_path() / "test_model_file.bin";
+    model_format::write_model_file(jin, path.string());
+    BOOST_TEST(model_format::is_model_file(path.string()));
+
+    model_format::ModelFile file(path.string());
+    BOOST_TEST(json::parse(file.str(file.header().args)) == jin["args"]);
+    BOOST_TEST(file.no_models() == 2u);
+    BOOST_TEST(file.find_model("toy") == 1u);
+    BOOST_TEST(file.find_model("resnet") == 2u);
+
+    std::size_t i = 0;
+    for (auto it = jin.begin(); it != jin.end(); ++it) {
+        if (it.key() == "args") continue;
+        Model expected(it.key(), it.value());
+        Model mapped(file, i++);
+        check_same_model(mapped, expected);
+    }
+
+    // a truncated file is rejected when it is opened
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+    BOOST_CHECK_THROW(model_format::ModelFile{path.string()}, std::runtime_error);
+    std::filesystem::remove(path);
+}
+
+// the streaming importer builds the models of the JSON document
+BOOST_AUTO_TEST_CASE(test_import_models) {
+    json jin = two_model_json();
+    jin["toy"]["no_ops"] = 1.5e9;
+    // models and layers in a different order than the keys of a json object
+    std::string dump = R"({"toy": {"layers": {"dense2": )" + jin["toy"]["layers"]["dense2"].dump() +
+        R"(, "input": )" + jin["toy"]["layers"]["input"].dump() +
+        R"(, "dense1": )" + jin["toy"]["layers"]["dense1"].dump() +
+        R"(}, "no_ops": 1.5e9, "order": ["input", "dense1", "dense2"], "no_repeat": 1}, "args": )" + jin["args"].dump() +
+        R"(, "conv": )" + jin["conv"].dump() + "}";
+    BOOST_TEST_REQUIRE(json::parse(dump) == jin);
+
+    json args;
+    std::vector<Model *> models = import_models(dump, args);
+    BOOST_TEST(args == jin["args"]);
+    BOOST_TEST_REQUIRE(models.size() == 2u);
+
+    std::size_t i = 0;
+    for (auto it = jin.begin(); it != jin.end(); ++it) {
+        if (it.key() == "args") continue;
+        Model expected(it.key(), it.value());
+        check_same_model(*models[i++], expected);
+    }
+    for (Model *model: models) delete model;
+
+    BOOST_CHECK_THROW(import_models(dump.substr(0, dump.size() / 2), args), std::runtime_error);
+    json missing_layer = jin;
+    missing_layer["toy"]["layers"].erase("dense1");
+    BOOST_CHECK_THROW(import_models(missing_layer.dump(), args), std::runtime_error);
+}
+
+// the uniform tile size gives the tiles of the explicit dims, through every importer
+BOOST_AUTO_TEST_CASE(test_uniform_tiling) {
+    json explicit_jin = two_model_json();
+    json uniform_jin = two_model_json(true);
+    BOOST_TEST(uniform_jin.dump().size() < explicit_jin.dump().size());
+
+    Model conv("conv", uniform_jin["conv"]);
+    Layer &conv1 = conv.layer_list->front();
+    BOOST_TEST(conv1.x_tile_dims.is_uniform());
+    BOOST_TEST((conv1.x_tile_dims.at(2, 0) == make_tuple(6, 27)));
+    BOOST_TEST((conv1.w_tile_dims.at(0, 1) == make_tuple(27, 8)));
+    conv1.create_main_ops();
+    BOOST_TEST(conv1.main_ops.size() == 3u * 1u * 2u);
+    BOOST_TEST(((*conv1.p_tiles)[make_tuple(2, 0, 1)]->dims == make_tuple(6, 8)));
+    BOOST_TEST((*conv1.x_tiles)[make_tuple(2, 0)]->memory_size == 6 * 27 / 9);
+
+    json args;
+    std::vector<Model *> models = import_models(uniform_jin.dump(), args);
+    auto path = std::filesystem::temp_directory_path() / "test_uniform_tiling.bin";
+    model_format::write_model_file(uniform_jin, path.string());
+    model_format::ModelFile file(path.string());
+
+    std::size_t i = 0;
+    for (auto it = explicit_jin.begin(); it != explicit_jin.end(); ++it) {
+        if (it.key() == "args") continue;
+        Model expected(it.key(), it.value());
+        Model uniform(it.key(), uniform_jin[it.key()]);
+        Model mapped(file, i);
+        check_same_model(uniform, expected);
+        check_same_model(*models[i], expected);
+        check_same_model(mapped, expected);
+        i++;
+    }
+    for (Model *model: models) delete model;
+    std::filesystem::remove(path);
+}
+
+// the cycle model of a saved schedule gives the results of the compiler it was saved from
+BOOST_DATA_TEST_CASE(
+    test_schedule_file,
+    bdata::make({InterconnectType::banyan_exp_1, InterconnectType::benes_vanilla, InterconnectType::crossbar, InterconnectType::clos_strict}),
+    type) {
+    CompilerFixture fx(type);
+    Compiler &compiler = fx.compiler;
+    json jin = two_model_json();
+    fx.compile(jin);
+    compiler.verify_schedule();
+
+    auto path = std::filesystem::temp_directory_path() / "test_schedule_file.bin";
+    schedule_file::save(&compiler, jin["args"], path.string());
+    BOOST_TEST(schedule_file::is_schedule_file(path.string()));
+
+    compiler.run_cycle_model();
+    BOOST_TEST(compiler.no_cycles > 0);
+    BOOST_TEST(compiler.memory_stall_cycles > 0);
+    json expected = compiler.sim_results(jin["args"]);
+    BOOST_TEST(expected["no_passes"] == 3);
+    BOOST_TEST(expected["interconnect_energy_per_pass"].get<double>() == expected["interconnect_energy"].get<double>() / 3, boost::test_tools::tolerance(1e-6));
+
+    std::unique_ptr<schedule_file::Schedule> schedule(schedule_file::load(path.string()));
+    BOOST_TEST(schedule->meta == jin["args"]);
+    schedule->compiler->run_cycle_model();
+    BOOST_TEST(schedule->compiler->sim_results(schedule->meta) == expected);
+
+    // a moved schedule takes over the compiler
+    schedule_file::Schedule moved(std::move(*schedule));
+    BOOST_TEST(schedule->compiler == nullptr);
+    BOOST_TEST(moved.meta == jin["args"]);
+    *schedule = std::move(moved);
+    BOOST_TEST(moved.compiler == nullptr);
+    BOOST_TEST(schedule->compiler->sim_results(schedule->meta) == expected);
+
+    // a larger bandwidth reduces the memory stalls
+    schedule.reset(schedule_file::load(path.string()));
+    schedule->compiler->dram->bandwidth = 1e4;
+    schedule->compiler->run_cycle_model();
+    BOOST_TEST(schedule->compiler->memory_stall_cycles < compiler.memory_stall_cycles);
+    BOOST_TEST(schedule->compiler->sim_results(schedule->meta)["no_ops"] == expected["no_ops"]);
+
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+    BOOST_CHECK_THROW(schedule_file::load(path.string()), std::runtime_error);
+    std::filesystem::remove(path);
+}
+
+// an untiled model tiled by the compiler has the tiles of the precompiler, through every importer
+BOOST_AUTO_TEST_CASE(test_untiled_model) {
+    boost::log::core::get()->set_logging_enabled(false);
+
+    json uniform_jin = two_model_json(true);
+    json untiled_jin = untiled_model_json();
+
+    json args;
+    std::vector<Model *> models = import_models(untiled_jin.dump(), args);
+    auto path = std::filesystem::temp_directory_path() / "test_untiled_model.bin";
+    model_format::write_model_file(untiled_jin, path.string());
+    model_format::ModelFile file(path.string());
+    BOOST_TEST(file.layer(0).tiling == model_format::untiled);
+
+    std::size_t i = 0;
+    for (auto it = uniform_jin.begin(); it != uniform_jin.end(); ++it) {
+        if (it.key() == "args") continue;
+        Model expected(it.key(), it.value());
+        Model untiled(it.key(), untiled_jin[it.key()]);
+        Model mapped(file, i);
+        BOOST_TEST(untiled.layer_list->back().is_untiled());
+        for (Model *model: {&untiled, models[i], &mapped}) {
+            model->tile(make_tuple(32, 32, 32));
+            check_same_model(*model, expected);
+        }
+        i++;
+    }
+    for (Model *model: models) delete model;
+    std::filesystem::remove(path);
+
+    Model toy("toy", untiled_jin["toy"]);
+    toy.tile(make_tuple(16, 32, 8));
+    BOOST_TEST((toy.get_layer_by_name("toy:dense1")->no_tiles == make_tuple(7, 2, 32)));
+    BOOST_TEST((toy.get_layer_by_name("toy:dense1")->x_tile_dims.at(6, 1) == make_tuple(4, 32)));
+
+    // the compiler tiles for its arrays and partition size
+    sweep::ModelDescription untiled(untiled_jin.dump());
+    sweep::ModelDescription uniform(uniform_jin.dump());
+    sweep::Config config {8, 32, 32, 524288, 8, 100, InterconnectType::crossbar};
+    json expected = sweep::run_config(uniform, config);
+    json result = sweep::run_config(untiled, config);
+    expected.erase("profile");
+    result.erase("profile");
+    // the tiled model keeps the partition size of its args, which has none
+    BOOST_TEST(result["partition_size"] == 32);
+    BOOST_TEST(!expected.contains("partition_size"));
+    result.erase("partition_size");
+    expected.erase("partition_size");
+    BOOST_TEST(result == expected);
+
+    config.partition_size = 16;
+    json partitioned = sweep::run_config(untiled, config);
+    BOOST_TEST(partitioned["total_no_gemm_ops"] > expected["total_no_gemm_ops"]);
+    BOOST_TEST(partitioned["partition_size"] == 16);
+    config = {8, 16, 16, 524288, 8, 100, InterconnectType::crossbar};
+    json small_arrays = sweep::run_config(untiled, config);
+    BOOST_TEST(small_arrays["total_no_gemm_ops"] > partitioned["total_no_gemm_ops"]);
+    BOOST_TEST(small_arrays["array_rows"] == 16);
+    BOOST_TEST(small_arrays["array_cols"] == 16);
+    BOOST_TEST(small_arrays["partition_size"] == 16);
+    BOOST_TEST(small_arrays["no_cycles"].get<int>() > 0);
+}
+
+// a moved layer takes its tiles and ops along, copies own their own
+BOOST_AUTO_TEST_CASE(test_layer_ownership) {
+    boost::log::core::get()->set_logging_enabled(false);
+
+    json jin = two_model_json(true);
+    Model model("toy", jin["toy"]);
+    Layer& layer = model.layer_list->back();
+    layer.create_main_ops();
+    std::size_t no_x_tiles = layer.x_tiles->size();
+    std::size_t no_main_ops = layer.main_ops.size();
+    BOOST_TEST(no_main_ops > 0u);
+
+    Layer moved(std::move(layer));
+    BOOST_TEST(layer.x_tiles == nullptr);
+    BOOST_TEST(layer.main_ops.empty());
+    BOOST_TEST(moved.x_tiles->size() == no_x_tiles);
+    BOOST_TEST(moved.main_ops.size() == no_main_ops);
+
+    Layer copy = moved.create_copy("_copy");
+    BOOST_TEST(copy.x_tiles != moved.x_tiles);
+    BOOST_TEST(copy.main_ops.size() == no_main_ops);
+    BOOST_TEST(copy.main_ops.begin()->second != moved.main_ops.begin()->second);
+    BOOST_TEST(copy.x_tile_dims.dims == moved.x_tile_dims.dims);
+}
+
+// cached schedules are keyed by the precompiled model and the compile options
+BOOST_AUTO_TEST_CASE(test_schedule_cache) {
+    auto dir = std::filesystem::temp_directory_path() / "test_schedule_cache";
+    std::string model = two_model_json().dump();
+    json options = {{"no_array", 8}, {"interconnect_type", InterconnectType::crossbar}};
+    auto path = [&](std::string const &model, json const &options) {
+        std::istringstream in{model};
+        return schedule_file::cache_path(dir.string(), in, options);
+    };
+
+    std::string cached = path(model, options);
+    BOOST_TEST(std::filesystem::is_directory(dir));
+    BOOST_TEST(std::filesystem::path(cached).parent_path() == dir);
+    BOOST_TEST(path(model, options) == cached);
+    BOOST_TEST(path(model + " ", options) != cached);
+    json other = options;
+    other["no_array"] = 16;
+    BOOST_TEST(path(model, other) != cached);
+    std::filesystem::remove_all(dir);
+}
+
+// a full ring keeps the latest events
+BOOST_AUTO_TEST_CASE(test_trace_ring) {
+    int clock = 0;
+    trace::Ring ring("ring", 3, &clock);
+    for (clock = 0; clock < 6; clock++) ring.record(trace::EventType::round_begin, clock);
+
+    BOOST_TEST(ring.size() == 4u);
+    BOOST_TEST(ring.dropped() == 2u);
+    for (size_t i = 0; i < ring.size(); i++) {
+        BOOST_TEST(ring[i].cycle == (int) i + 2);
+        BOOST_TEST(ring[i].round == (int) i + 2);
+    }
+}
+
+// every round, op and memory stall of the cycle model is traced and exported as matched slices
+BOOST_FIXTURE_TEST_CASE(test_trace, CompilerFixture) {
+    compile(two_model_json());
+
+    auto recorder = std::make_unique<trace::Recorder>(&compiler, 1 << 16);
+    BOOST_TEST(recorder->rings.size() == 2u + 8 + 8 + 3 * 8);
+    compiler.run_cycle_model();
+    BOOST_TEST(compiler.memory_stall_cycles > 0);
+
+    auto count = [](trace::Ring const &ring, trace::EventType type) {
+        int n = 0;
+        for (size_t i = 0; i < ring.size(); i++) n += ring[i].type == type;
+        return n;
+    };
+    trace::Ring const &rounds = *recorder->rounds();
+    BOOST_TEST(rounds.dropped() == 0u);
+    BOOST_TEST(count(rounds, trace::EventType::round_begin) == max(compiler.no_main_rounds(), compiler.no_post_rounds()));
+    BOOST_TEST(count(rounds, trace::EventType::round_end) == count(rounds, trace::EventType::round_begin));
+    BOOST_TEST(count(rounds, trace::EventType::stall_begin) > 0);
+    BOOST_TEST(count(rounds, trace::EventType::stall_begin) == count(rounds, trace::EventType::stall_end));
+    BOOST_TEST(rounds[rounds.size() - 1].cycle <= compiler.no_cycles);
+
+    int no_ops = 0;
+    for (auto it = arrays.array_map->begin(); it != arrays.array_map->end(); it++) {
+        no_ops += count(*it->second->trace, trace::EventType::array_busy);
+        BOOST_TEST(count(*it->second->trace, trace::EventType::array_idle) == count(*it->second->trace, trace::EventType::array_busy));
+    }
+    BOOST_TEST(no_ops > 0);
+    BOOST_TEST(count(*dram.trace, trace::EventType::fetch_begin) == count(*dram.trace, trace::EventType::fetch_end));
+
+    std::ostringstream out;
+    trace::write_chrome_trace(*recorder, compiler.freq, out);
+    json events = json::parse(out.str())["traceEvents"];
+    int begins = 0, ends = 0, mult_ops = 0;
+    for (auto &e: events) {
+        begins += e["ph"] == "B";
+        ends += e["ph"] == "E";
+        mult_ops += e["ph"] == "B" && e["name"] == "mult op";
+    }
+    BOOST_TEST(begins == ends);
+    BOOST_TEST(mult_ops == no_ops);
+
+    recorder.reset();
+    BOOST_TEST(compiler.trace == nullptr);
+    BOOST_TEST(dram.trace == nullptr);
+}
+
+// a write back begins on the cycle its first bytes are written, not when the reads use up the bandwidth
+BOOST_AUTO_TEST_CASE(test_dram_write_back_begin) {
+    boost::log::core::get()->set_logging_enabled(false);
+
+    int clock = 0;
+    trace::Ring ring("dram", 16, &clock);
+    Dram dram(8, 100);
+    dram.trace = &ring;
+
+    // the second x tile does not fit next to the first one and stops the reads
+    Bank x_bank(0, data_type::X, 12);
+    Bank p_bank(0, data_type::P, 1024);
+    X_Tile x("layer", {0, 0}, {4, 3}, 1, 12);
+    X_Tile blocked("layer", {0, 1}, {4, 3}, 1, 12);
+    P_Tile p("layer", {0, 0, 0}, {4, 4}, 1, 16);
+    x.assign_bank(&x_bank);
+    blocked.assign_bank(&x_bank);
+    p.assign_bank(&p_bank);
+    dram.load_queue->push_back({0, &x});
+    dram.load_queue->push_back({0, &blocked});
+    p_bank.write_back_queue->push_back(&p);
+    list<Bank*> p_banks{&p_bank};
+
+    auto count = [&ring](trace::EventType type) {
+        int n = 0;
+        for (size_t i = 0; i < ring.size(); i++) n += ring[i].type == type;
+        return n;
+    };
+
+    // the read takes the whole bandwidth
+    dram.update(&p_banks, 0);
+    BOOST_TEST(p.bytes_written_to_memory == 0);
+    BOOST_TEST(count(trace::EventType::write_back_begin) == 0);
+
+    // the rest of the read leaves 4 bytes for the write back
+    clock++;
+    dram.update(&p_banks, 0);
+    BOOST_TEST(p.bytes_written_to_memory == 4);
+    BOOST_TEST(count(trace::EventType::write_back_begin) == 1);
+    BOOST_TEST(ring[ring.size() - 1].cycle == 1);
+}
+
+// runs in parallel threads count into the profiles bound to their threads
+BOOST_AUTO_TEST_CASE(test_profile_scope) {
+    profile::Profile first, second;
+    profile::Profile *process = &profile::current();
+    {
+        profile::Scope scope(first);
+        std::thread other([&second] {
+            profile::Scope scope(second);
+            profile::current().counters[profile::op_placed]++;
+        });
+        profile::current().counters[profile::op_placed]++;
+        profile::current().counters[profile::op_placed]++;
+        other.join();
+        BOOST_TEST(&profile::current() == &first);
+    }
+    BOOST_TEST(&profile::current() == process);
+    BOOST_TEST(first.counters[profile::op_placed].load() == 2);
+    BOOST_TEST(second.counters[profile::op_placed].load() == 1);
+}
+
+// the rounds of the statistics cover the cycle model and its memory traffic
+BOOST_FIXTURE_TEST_CASE(test_round_stats, CompilerFixture) {
+    compile(two_model_json());
+
+    auto path = std::filesystem::temp_directory_path() / "test_round_stats.csv";
+    auto round_stats = std::make_unique<RoundStats>(path.string());
+    compiler.round_stats = round_stats.get();
+    compiler.run_cycle_model();
+    round_stats.reset();
+    BOOST_TEST(compiler.memory_stall_cycles > 0);
+
+    std::ifstream in(path);
+    std::string line;
+    std::getline(in, line);
+    BOOST_TEST(line.rfind("round,start_cycle,cycles,stall_cycles,", 0) == 0u);
+
+    int no_rounds = 0, end_cycle = 0, stall_cycles = 0, max_active = 0;
+    double dram_bytes = 0;
+    while (std::getline(in, line)) {
+        std::vector<double> row;
+        std::istringstream fields(line);
+        for (std::string field; std::getline(fields, field, ',');) row.push_back(std::stod(field));
+        BOOST_TEST_REQUIRE(row.size() == 11u);
+
+        BOOST_TEST(row[0] == no_rounds);
+        if (no_rounds > 0) BOOST_TEST(row[1] == end_cycle);
+        end_cycle = row[1] + row[2];
+        stall_cycles += row[3];
+        max_active = max(max_active, (int) row[4]);
+        dram_bytes += row[6] + row[7] + row[8];
+        BOOST_TEST(row[10] <= row[9]);
+        BOOST_TEST(row[9] <= 524288);
+        no_rounds++;
+    }
+
+    BOOST_TEST(no_rounds == max(compiler.no_main_rounds(), compiler.no_post_rounds()));
+    BOOST_TEST(end_cycle == compiler.no_cycles - compiler.pp_latency_offset);
+    BOOST_TEST(stall_cycles > 0);
+    BOOST_TEST(stall_cycles <= compiler.memory_stall_cycles);
+    BOOST_TEST(max_active == 8);
+    double total_bytes = dram.x_tiles_bw_usage + dram.w_tiles_bw_usage + dram.p_tiles_bw_usage;
+    // whole bytes are counted per round, the bytes after the last round are not in the file
+    BOOST_TEST(dram_bytes + dram.x_round_bytes + dram.w_round_bytes + dram.p_round_bytes == total_bytes);
+    std::filesystem::remove(path);
+}
+
+// the runs of a sweep are independent, in parallel they give the results of sequential runs
+BOOST_AUTO_TEST_CASE(test_sweep) {
+    boost::log::core::get()->set_logging_enabled(false);
+
+    json jin = two_model_json();
+    sweep::ModelDescription models(jin.dump());
+    BOOST_TEST(models.args() == jin["args"]);
+
+    sweep::Config defaults {8, 32, 32, 524288, 8, 100, InterconnectType::banyan_exp_1};
+    std::vector<sweep::Config> configs;
+    for (json j: {json::object(), json{{"ict_type", "crossbar"}}, json{{"no_array", 4}, {"memory_bw", 4.0}},
+            json{{"ict_type", "benes_vanilla"}, {"prefetch", 2}, {"bank_size", 1 << 20}}}) {
+        configs.push_back(sweep::parse_config(j, defaults));
+    }
+    BOOST_TEST(configs[1].interconnect_type == InterconnectType::crossbar);
+    BOOST_TEST(configs[2].no_array == 4);
+    BOOST_TEST(configs[2].no_rows == 32);
+    BOOST_CHECK_THROW(sweep::parse_config(json{{"ict_type", "none"}}, defaults), std::runtime_error);
+
+    std::vector<json> results = sweep::run(models, configs, 3);
+    BOOST_TEST(results.size() == configs.size());
+
+    auto path = std::filesystem::temp_directory_path() / "test_sweep.bin";
+    model_format::write_model_file(jin, path.string());
+    std::unique_ptr<sweep::ModelDescription> bin_models(sweep::ModelDescription::load(path.string()));
+
+    for (std::size_t i = 0; i < configs.size(); i++) {
+        // the timers of the profile differ from run to run
+        results[i].erase("profile");
+        json expected = sweep::run_config(models, configs[i]);
+        expected.erase("profile");
+        BOOST_TEST(results[i] == expected);
+        BOOST_TEST(results[i]["no_array"] == configs[i].no_array);
+        BOOST_TEST(results[i]["no_cycles"].get<int>() > 0);
+
+        json from_bin = sweep::run_config(*bin_models, configs[i]);
+        from_bin.erase("profile");
+        BOOST_TEST(from_bin == expected);
+    }
+    BOOST_TEST(results[0] != results[1]);
+    std::filesystem::remove(path);
+}
+
+BOOST_AUTO_TEST_CASE(test_schedule_arrays) {
+    boost::log::core::get()->set_logging_enabled(false);
+
+    json jin = two_model_json();
+    sweep::ModelDescription models(jin.dump());
+    sweep::Config config {8, 32, 32, 524288, 8, 100, InterconnectType::crossbar};
+    ScheduleArrays schedule;
+    RoundStats round_stats;
+    json results = sweep::run_config(models, config, &schedule, &round_stats);
+    json expected = sweep::run_config(models, config);
+    results.erase("profile");
+    expected.erase("profile");
+    BOOST_TEST(results == expected);
+
+    BOOST_TEST(schedule.no_rounds == results["no_main_rounds"].get<int>() + 1);
+    BOOST_TEST(schedule.no_arrays == 8);
+    BOOST_TEST(schedule.ops.size() == (std::size_t) schedule.no_rounds * 8);
+    BOOST_TEST(schedule.op_index.size() == 3 * schedule.op_layer.size());
+
+    // every op is placed once, with the banks of its tiles
+    std::vector<int> placed(schedule.op_layer.size(), 0);
+    for (std::size_t i = 0; i < schedule.ops.size(); i++) {
+        int op = schedule.ops[i];
+        if (op < 0) {
+            BOOST_TEST(schedule.layers[i] == -1);
+            BOOST_TEST(schedule.x_banks[i] == -1);
+            continue;
+        }
+        placed[op]++;
+        BOOST_TEST(schedule.layers[i] == schedule.op_layer[op]);
+        BOOST_TEST(schedule.x_banks[i] >= 0);
+        BOOST_TEST(schedule.w_banks[i] >= 0);
+        BOOST_TEST(schedule.p_banks[i] >= 0);
+    }
+    BOOST_TEST(std::count(placed.begin(), placed.end(), 1) == (long) placed.size());
+    BOOST_TEST(schedule.layer_names[schedule.op_layer.back()].rfind("toy:", 0) == 0u);
+
+    // the rounds kept in memory add up to the cycles of the run
+    std::size_t no_rounds = round_stats.cycles.size();
+    BOOST_TEST(no_rounds == (std::size_t) max(results["no_main_rounds"].get<int>(), results["no_post_rounds"].get<int>()));
+    BOOST_TEST(round_stats.bank_mean_bytes.size() == no_rounds);
+    for (std::size_t r = 1; r < no_rounds; r++) {
+        BOOST_TEST(round_stats.start_cycle[r] == round_stats.start_cycle[r - 1] + round_stats.cycles[r - 1]);
+    }
+    long stall_cycles = 0;
+    for (int s: round_stats.stall_cycles) stall_cycles += s;
+    BOOST_TEST(stall_cycles <= results["memory_stall_cycles"].get<long>());
+}
+
+BOOST_AUTO_TEST_CASE(test_session) {
+    boost::log::core::get()->set_logging_enabled(false);
+
+    json jin = two_model_json();
+    sweep::ModelDescription models(jin.dump());
+    for (auto type: {InterconnectType::crossbar, InterconnectType::benes_vanilla, InterconnectType::banyan_exp_1,
+            InterconnectType::clos_strict, InterconnectType::clos_rearrangeable}) {
+        sweep::Config config {8, 32, 32, 524288, 8, 100, type};
+        sweep::Session session(models, config);
+
+        // every run after a reset matches a run compiled for its settings,
+        // also after a run that stalls out at 2 GB/s
+        for (auto memory: std::vector<std::pair<float, int>>{{8, 100}, {2, 100}, {8, 2}, {8, 100}}) {
+            json results = session.run(memory.first, memory.second);
+
+            sweep::Config fresh = config;
+            fresh.bandwidth = memory.first;
+            fresh.prefetch_limit = memory.second;
+            json expected = sweep::run_config(models, fresh);
+            expected.erase("profile");
+            BOOST_TEST(expected["prefetch"] == memory.second);
+            BOOST_TEST(results == expected);
+        }
+        BOOST_TEST(session.no_runs() == 4);
+    }
+
+    sweep::Config config {8, 32, 32, 524288, 8, 100, InterconnectType::crossbar};
+    BOOST_CHECK_THROW(sweep::Session(sweep::ModelDescription(json{{"args", json::object()}}.dump()), config), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(test_results_store) {
+    boost::log::core::get()->set_logging_enabled(false);
+
+    auto path = std::filesystem::temp_directory_path() / "test_results_store.srs";
+    std::filesystem::remove(path);
+
+    json jin = two_model_json();
+    sweep::ModelDescription models(jin.dump());
+    sweep::Config config {8, 32, 32, 524288, 8, 100, InterconnectType::crossbar};
+    json run = sweep::run_config(models, config);
+    results_store::append(path.string(), run);
+
+    json first = {{"model", "toy"}, {"extra_models", {"conv", "toy"}}, {"array_size", {32, 16}},
+        {"no_array", 16}, {"bandwidth", 1.5}, {"no_cycles", 100}, {"total_bw_usage", 2.5}};
+    json rerun = first;
+    rerun["no_cycles"] = 101;
+    json other = first;
+    other["no_array"] = 64;
+    for (json const* results: {&first, &rerun, &other}) {
+        results_store::append(path.string(), *results);
+    }
+
+    {
+        results_store::ResultsFile store(path.string());
+        BOOST_TEST(store.no_rows() == 4u);
+        BOOST_TEST(store.row(0)["no_cycles"] == run["no_cycles"]);
+        BOOST_TEST(store.row(0)["total_no_gemm_ops"] == run["total_no_gemm_ops"]);
+        // the shape of the arrays, the args have no array_size
+        BOOST_TEST(store.row(0)["array_rows"] == 32);
+        BOOST_TEST(store.row(0)["array_cols"] == 32);
+        BOOST_TEST(store.key(0) == results_store::config_key(run));
+
+        json row = store.row(1);
+        BOOST_TEST(row["model"] == "toy");
+        BOOST_TEST(row["extra_models"] == "conv,toy");
+        BOOST_TEST(row["array_rows"] == 32);
+        BOOST_TEST(row["array_cols"] == 16);
+        BOOST_TEST(row["bandwidth"] == 1.5);
+        BOOST_TEST(row["total_bw_usage"] == 2.5);
+        // missing fields are not in the rows
+        BOOST_TEST(!row.contains("sentence_len"));
+        BOOST_TEST(!row.contains("no_ops"));
+
+        // the runs of a configuration have the same key
+        BOOST_TEST(store.key(1) == store.key(2));
+        BOOST_TEST(store.key(1) != store.key(3));
+        BOOST_TEST(store.row(2)["no_cycles"] == 101);
+    }
+
+    // rows past the first block
+    for (int i = 0; i < (int) results_store::block_rows; i++) {
+        json results = other;
+        results["no_cycles"] = i;
+        results_store::append(path.string(), results);
+    }
+    {
+        results_store::ResultsFile store(path.string());
+        BOOST_TEST(store.no_rows() == 4u + results_store::block_rows);
+        BOOST_TEST(store.row(store.no_rows() - 1)["no_cycles"] == results_store::block_rows - 1);
+        BOOST_TEST(store.row(results_store::block_rows)["no_cycles"] == results_store::block_rows - 4);
+        BOOST_TEST(store.key(store.no_rows() - 1) == store.key(3));
+    }
+
+    json long_name = first;
+    long_name["model"] = std::string(64, 'm');
+    BOOST_CHECK_THROW(results_store::append(path.string(), long_name), std::runtime_error);
+    std::filesystem::remove(path);
+
+    // not a results store
+    auto model_path = std::filesystem::temp_directory_path() / "test_results_store.bin";
+    model_format::write_model_file(jin, model_path.string());
+    BOOST_CHECK_THROW(results_store::append(model_path.string(), first), std::runtime_error);
+    BOOST_CHECK_THROW(results_store::ResultsFile store(model_path.string()), std::runtime_error);
+    std::filesystem::remove(model_path);
+}
+
+#ifdef COMPILER_MULTITHREADING
+
+// (round, layer, op index, array or post processor, x bank, w bank, pout bank)
+// of every placement, post processors are numbered after the arrays
+using Placements = std::vector<std::tuple<int, std::string, tuple<int, int, int>, int, int, int, int>>;
+
+Placements compile_placements(json const &j, InterconnectType type, std::size_t num_workers, std::size_t window) {
+    CompilerFixture fx(type, 1200);
+    Compiler &compiler = fx.compiler;
+    if (num_workers > 1) compiler.enable_multithreading(num_workers, 1);
+    if (window > 1) compiler.enable_speculation(3, window);
+    fx.compile({{"toy", j}}, false);
+
+    Placements placements;
+    for (auto &[id, array]: *fx.arrays.array_map) {
+        for (int r = 0; r <= compiler.no_main_rounds(); ++r) {
+            MultOp *op = array->get_op(r);
+            if (op == nullptr) continue;
+            placements.emplace_back(r, op->layer_name, op->op_ind, id, op->x_tile->bank->id, op->w_tile->bank->id, op->pout_tile->bank->id);
+        }
+    }
+    for (auto &[id, pp]: *fx.post_processors.pp_map) {
+        for (int r = 0; r <= compiler.no_post_rounds(); ++r) {
+            AggrOp *op = pp->get_op(r);
+            if (op == nullptr) continue;
+            placements.emplace_back(r, op->layer_name, op->op_ind, 8 + id, -1, -1, op->pout_tile->bank->id);
+        }
+    }
+    return placements;
+}
+
+BOOST_DATA_TEST_CASE(
+    test_speculative_placement,
+    bdata::make({InterconnectType::banyan_exp_1, InterconnectType::benes_vanilla, InterconnectType::clos_rearrangeable, InterconnectType::clos_strict, InterconnectType::bus}),
+    type) {
+    boost::log::core::get()->set_logging_enabled(false);
+
+    // only the Clos network has to replay the earlier rounds of a window
+    auto ict = Interconnects(8, type);
+    BOOST_TEST(ict.x_interconnect->is_apply_incremental() == (type == InterconnectType::clos_rearrangeable || type == InterconnectType::clos_strict));
+
+    auto j = two_layer_model_json();
+    auto sequential = compile_placements(j, type, 1, 1);
+    BOOST_TEST(std::any_of(sequential.begin(), sequential.end(), [](auto &p) { return std::get<0>(p) > 8; }));
+    for (std::size_t window: {2, 5}) {
+        BOOST_TEST((compile_placements(j, type, 1, window) == sequential));
+    }
+}
+
+// the multithreaded placement must produce the schedule of the single-threaded one
+BOOST_DATA_TEST_CASE(
+    test_multithreaded_placement,
+    bdata::make({InterconnectType::banyan_exp_1, InterconnectType::benes_vanilla, InterconnectType::clos_rearrangeable, InterconnectType::crossbar}),
+    type) {
+    boost::log::core::get()->set_logging_enabled(false);
+
+    auto j = two_layer_model_json();
+    auto sequential = compile_placements(j, type, 1, 1);
+    BOOST_TEST((compile_placements(j, type, 4, 1) == sequential));
+    BOOST_TEST((compile_placements(j, type, 4, 4) == sequential));
 }
+
+// every placement decision is counted once, as placed or with the reason of its failure
+BOOST_DATA_TEST_CASE(
+    test_profile,
+    bdata::make({1, 4}),
+    num_workers) {
+    CompilerFixture fx(InterconnectType::benes_vanilla);
+    Compiler &compiler = fx.compiler;
+    profile::current().reset();
+    if (num_workers > 1) compiler.enable_multithreading(num_workers, 1);
+    fx.compile(two_model_json(), false);
+
+    long no_ops = 0, no_post_ops = 0;
+    std::set<std::string> layer_names;
+    for (auto &model: fx.models) {
+        for (auto layer = model->begin(); layer != model->end(); layer++) {
+            layer_names.insert(layer->layer_name);
+            no_ops += get<0>(layer->no_tiles) * get<1>(layer->no_tiles) * get<2>(layer->no_tiles);
+            for (auto &post_ops: layer->post_ops) no_post_ops += post_ops.second.size();
+        }
+    }
+    compiler.run_cycle_model();
+
+    json jprofile = profile::current().to_json();
+    for (auto [name, placed] : {std::make_pair("op_placement", no_ops), std::make_pair("post_op_placement", no_post_ops)}) {
+        json placement = jprofile[name];
+        long failures = 0;
+        for (auto &failure: placement["failures"]) failures += failure.get<long>();
+        BOOST_TEST(placement["placed"].get<long>() == placed);
+        BOOST_TEST(placement["attempts"].get<long>() == placed + failures);
+    }
+    BOOST_TEST(jprofile["op_placement"]["failures"]["no_array"].get<long>() > 0);
+    BOOST_TEST(jprofile["interconnects"]["x"]["is_route_free"].get<long>() > 0);
+    BOOST_TEST(jprofile["interconnects"]["x"]["apply_permute"].get<long>() > 0);
+    BOOST_TEST(jprofile["interconnects"]["pp_out"]["is_route_free"].get<long>() > 0);
+
+    long dispatched = jprofile["pls"]["tasks_dispatched"];
+    long cancelled = jprofile["pls"]["tasks_cancelled"];
+    BOOST_TEST((num_workers > 1 ? dispatched > 0 : dispatched == 0));
+    BOOST_TEST(cancelled >= 0);
+    BOOST_TEST(cancelled <= dispatched);
+
+    BOOST_TEST(jprofile["seconds"]["compile_layer"].size() == layer_names.size());
+    BOOST_TEST(jprofile["seconds"]["run_cycle_model"].get<double>() > 0);
+    BOOST_TEST(jprofile["seconds"]["create_memory_fifo"].get<double>() > 0);
+}
+
+#endif
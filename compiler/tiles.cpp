@@ -133,6 +133,13 @@ bool Tile::allocate_on_sram(int curr_round, int target_round){
     return true;
 }
 
+void Tile::reset(bool is_allocated_on_sram){
+    this->bytes_fetched_from_memory = 0;
+    this->bytes_written_to_memory = 0;
+    this->is_spawn_ = false;
+    this->is_allocated_on_sram = is_allocated_on_sram;
+}
+
 int Tile::get_mem_height(){
     return get<0>(this->dims);
 }
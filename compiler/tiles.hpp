@@ -6,18 +6,17 @@
 #include <list>
 
 #include "helper.hpp"
-#include "serialize_tuple.h"
 
 #include <boost/log/trivial.hpp>
 
-#include <boost/serialization/map.hpp>
-#include <boost/serialization/list.hpp>
-#include <boost/archive/text_oarchive.hpp>
-#include <boost/archive/text_iarchive.hpp>
-
 class Bank;
 class Op;
 
+namespace schedule_file {
+    class Writer;
+    class Reader;
+}
+
 using namespace std;
 
 class Tile{
@@ -34,14 +33,20 @@ class Tile{
         float bytes_written_to_memory; //In terms of number of bytes
         int memory_size; //In terms of number of bytes
 
-        list<Op*>* input_of;
+        // owned by the tile, the ops are owned by their layer
+        list<Op*>* input_of {nullptr};
         Op* output_of;
 
         Bank* bank;
 
         bool is_spawn_;
         bool is_allocated_on_sram;
-        
+
+        Tile() {}
+        Tile(Tile const&) = delete;
+        Tile& operator=(Tile const&) = delete;
+        ~Tile(){ delete this->input_of; }
+
         void assign_bank(Bank* bank);
         bool is_allocated();
         int get_mem_width();
@@ -50,21 +55,8 @@ class Tile{
         float write_to_memory(float);
         bool allocate_on_sram(int, int);
         void remove_from_sram();
-
-        friend class boost::serialization::access;
-
-        template<class Archive>
-        void serialize(Archive & ar, const unsigned int version){
-            ar & this->layer_name;   
-            ar & this->type; 
-            ar & this->dims; 
-            ar & this->precision; 
-            ar & this->memory_size; 
-            ar & this->bytes_fetched_from_memory; 
-            ar & this->input_of;
-            ar & this->bank;
-            ar & this->is_allocated_on_sram;
-        }
+        // returns the tile to its state before the cycle model
+        void reset(bool is_allocated_on_sram);
 
         
 };
@@ -75,23 +67,6 @@ class X_Tile: public Tile{
         
         X_Tile(){};
         X_Tile(string layer_name, tuple<int, int> id, tuple<int, int> dims, int precision, int memory_size);
-        X_Tile(const X_Tile& x_tile) = default;
-
-        friend class boost::serialization::access;
-
-        template<class Archive>
-        void serialize(Archive & ar, const unsigned int version){
-            ar & this->layer_name;   
-            ar & this->type; 
-            ar & this->dims; 
-            ar & this->precision; 
-            ar & this->memory_size; 
-            ar & this->bytes_fetched_from_memory; 
-            ar & this->input_of;
-            ar & this->bank;
-            ar & this->is_allocated_on_sram;
-            ar & this->id;
-        }
 };
 
 class W_Tile: public Tile{
@@ -100,23 +75,6 @@ class W_Tile: public Tile{
 
         W_Tile(){};
         W_Tile(string layer_name, tuple<int, int> id, tuple<int, int> dims, int precision, int memory_size);
-        W_Tile(const W_Tile& w_tile) = default;
-
-        friend class boost::serialization::access;
-        
-        template<class Archive>
-        void serialize(Archive & ar, const unsigned int version){
-            ar & this->layer_name;   
-            ar & this->type; 
-            ar & this->dims; 
-            ar & this->precision; 
-            ar & this->memory_size; 
-            ar & this->bytes_fetched_from_memory; 
-            ar & this->input_of;
-            ar & this->bank;
-            ar & this->is_allocated_on_sram;
-            ar & this->id;
-        }     
 };
 
 class P_Tile: public Tile{
@@ -125,25 +83,8 @@ class P_Tile: public Tile{
         
         P_Tile(){};
         P_Tile(string layer_name, tuple<int, int, int> id, tuple<int, int> dims, int precision, int memory_size);
-        P_Tile(const P_Tile& p_tile) = default;
 
-        friend class boost::serialization::access;
-        
         string get_id_str();
-
-        template<class Archive>
-        void serialize(Archive & ar, const unsigned int version){
-            ar & this->layer_name;   
-            ar & this->type; 
-            ar & this->dims; 
-            ar & this->precision; 
-            ar & this->memory_size; 
-            ar & this->bytes_fetched_from_memory; 
-            ar & this->input_of;
-            ar & this->bank;
-            ar & this->is_allocated_on_sram;
-            ar & this->id;
-        }
 };
 
 
@@ -0,0 +1,210 @@
+#include "trace.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+#include "compiler.hpp"
+#include "helper.hpp"
+
+namespace trace {
+
+Ring::Ring(string name, size_t capacity, int const* clock){
+    size_t size = 1;
+    while (size < capacity) size <<= 1;
+
+    this->name = name;
+    this->events_.resize(size);
+    this->mask_ = size - 1;
+    this->clock_ = clock;
+}
+
+size_t Ring::size() const {
+    return this->no_events_ < this->events_.size() ? this->no_events_ : this->events_.size();
+}
+
+Event const& Ring::operator[](size_t i) const {
+    return this->events_[(this->no_events_ - this->size() + i) & this->mask_];
+}
+
+size_t Ring::dropped() const {
+    return this->no_events_ - this->size();
+}
+
+Recorder::Recorder(Compiler* compiler, size_t capacity){
+    this->compiler_ = compiler;
+
+    this->rings.push_back(new Ring("rounds", capacity, &this->clock));
+
+    Ring* dram_ring = new Ring("dram", capacity, &this->clock);
+    compiler->dram->trace = dram_ring;
+    this->rings.push_back(dram_ring);
+
+    for (auto it = compiler->arrays->array_map->begin(); it != compiler->arrays->array_map->end(); it++){
+        Ring* ring = new Ring("array " + to_string(it->first), capacity, &this->clock);
+        it->second->trace = ring;
+        this->rings.push_back(ring);
+    }
+
+    for (auto it = compiler->post_processors->pp_map->begin(); it != compiler->post_processors->pp_map->end(); it++){
+        Ring* ring = new Ring("post processor " + to_string(it->first), capacity, &this->pp_clock);
+        it->second->trace = ring;
+        this->rings.push_back(ring);
+    }
+
+    for (list<Bank*>* banks: {compiler->banks->get_x_banks(), compiler->banks->get_w_banks(), compiler->banks->get_p_banks()}){
+        for (auto it = banks->begin(); it != banks->end(); it++){
+            Ring* ring = new Ring(string(PRINT_TYPE((*it)->type)) + " bank " + to_string((*it)->id), capacity, &this->clock);
+            (*it)->trace = ring;
+            this->rings.push_back(ring);
+        }
+    }
+
+    compiler->trace = this;
+}
+
+Recorder::~Recorder(){
+    Compiler* compiler = this->compiler_;
+    compiler->trace = nullptr;
+    compiler->dram->trace = nullptr;
+    for (auto it = compiler->arrays->array_map->begin(); it != compiler->arrays->array_map->end(); it++){
+        it->second->trace = nullptr;
+    }
+    for (auto it = compiler->post_processors->pp_map->begin(); it != compiler->post_processors->pp_map->end(); it++){
+        it->second->trace = nullptr;
+    }
+    for (list<Bank*>* banks: {compiler->banks->get_x_banks(), compiler->banks->get_w_banks(), compiler->banks->get_p_banks()}){
+        for (auto it = banks->begin(); it != banks->end(); it++){
+            (*it)->trace = nullptr;
+        }
+    }
+
+    for (Ring* ring: this->rings){
+        delete ring;
+    }
+}
+
+Ring* Recorder::rounds(){
+    return this->rings[0];
+}
+
+namespace {
+
+// Writes the events of one track. Begin and end events are matched per track:
+// an end whose begin was overwritten is skipped and the slices still open at
+// the end of the trace are closed at `last`.
+class TrackWriter{
+    public:
+        TrackWriter(ostream& out, float cycles_per_us, int tid, bool& first)
+            : out_(out), cycles_per_us_(cycles_per_us), tid_(tid), first_(first) {}
+
+        void begin(Event const& e, string const& name){
+            this->open_++;
+            this->write(e.cycle, "B", name, &e);
+        }
+
+        void end(Event const& e){
+            if (this->open_ == 0) return;
+            this->open_--;
+            this->write(e.cycle, "E", "", nullptr);
+        }
+
+        void instant(Event const& e, string const& name){
+            this->write(e.cycle, "i", name, &e);
+        }
+
+        void close(int last){
+            for (; this->open_ > 0; this->open_--){
+                this->write(last, "E", "", nullptr);
+            }
+        }
+
+    private:
+        void write(int cycle, char const* ph, string const& name, Event const* args){
+            char ts[32];
+            snprintf(ts, sizeof(ts), "%.3f", cycle / this->cycles_per_us_);
+
+            if (!this->first_) this->out_ << ",\n";
+            this->first_ = false;
+
+            this->out_ << "{\"ph\":\"" << ph << "\",\"pid\":0,\"tid\":" << this->tid_ << ",\"ts\":" << ts;
+            if (!name.empty()) this->out_ << ",\"name\":\"" << name << "\"";
+            if (ph[0] == 'i') this->out_ << ",\"s\":\"t\"";
+            if (args != nullptr){
+                this->out_ << ",\"args\":{\"round\":" << args->round;
+                if (args->bytes != 0) this->out_ << ",\"bank\":" << args->bank << ",\"bytes\":" << args->bytes;
+                this->out_ << "}";
+            }
+            this->out_ << "}";
+        }
+
+        ostream& out_;
+        float cycles_per_us_;
+        int tid_;
+        bool& first_;
+        int open_ {0};
+};
+
+string tile_name(char const* what, Event const& e){
+    return string(what) + " " + PRINT_TYPE((data_type) e.tile_type) + " tile";
+}
+
+} // namespace
+
+void write_chrome_trace(Recorder const& recorder, float freq, ostream& out){
+    float cycles_per_us = freq / 1e6;
+    bool first = true;
+
+    int last = max(recorder.clock, recorder.pp_clock);
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+
+    // the dram reads and writes back at the same time, they get one track each
+    int no_tracks = recorder.rings.size() + 1;
+    for (int tid = 0; tid < no_tracks; tid++){
+        string name = tid == 1 ? "dram read" : tid == no_tracks - 1 ? "dram write back" : recorder.rings[tid]->name;
+        int sort_index = tid == no_tracks - 1 ? 2 : tid < 2 ? tid : tid + 1;
+
+        if (!first) out << ",\n";
+        first = false;
+        out << "{\"ph\":\"M\",\"pid\":0,\"tid\":" << tid << ",\"name\":\"thread_name\",\"args\":{\"name\":\"" << name << "\"}},\n";
+        out << "{\"ph\":\"M\",\"pid\":0,\"tid\":" << tid << ",\"name\":\"thread_sort_index\",\"args\":{\"sort_index\":" << sort_index << "}}";
+    }
+
+    for (size_t k = 0; k < recorder.rings.size(); k++){
+        Ring const& ring = *recorder.rings[k];
+        TrackWriter track(out, cycles_per_us, k, first);
+        TrackWriter write_back(out, cycles_per_us, no_tracks - 1, first);
+
+        for (size_t i = 0; i < ring.size(); i++){
+            Event const& e = ring[i];
+            switch (e.type){
+                case EventType::warmup_begin: track.begin(e, "warm-up"); break;
+                case EventType::round_begin: track.begin(e, "round " + to_string(e.round)); break;
+                case EventType::stall_begin: track.begin(e, "memory stall"); break;
+                case EventType::fetch_begin: track.begin(e, tile_name("fetch", e)); break;
+                case EventType::write_back_begin: write_back.begin(e, tile_name("write back", e)); break;
+                case EventType::array_busy: track.begin(e, "mult op"); break;
+                case EventType::pp_busy: track.begin(e, "aggr op"); break;
+                case EventType::evict: track.instant(e, tile_name("evict", e)); break;
+                case EventType::write_back_end: write_back.end(e); break;
+                default: track.end(e); break;
+            }
+        }
+
+        track.close(last);
+        write_back.close(last);
+    }
+
+    out << "\n]}\n";
+}
+
+void save_chrome_trace(Recorder const& recorder, float freq, string const& path){
+    ofstream out(path, ofstream::out);
+    if (!out.is_open()){
+        throw runtime_error("Trace file " + path + " cannot be opened.");
+    }
+    write_chrome_trace(recorder, freq, out);
+}
+
+} // namespace trace
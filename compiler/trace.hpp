@@ -0,0 +1,102 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class Compiler;
+
+// Event trace of run_cycle_model
+//
+// Every component of the cycle model (the round loop, the dram, each array,
+// post processor and bank) records fixed-size events into its own ring
+// buffer. A full ring overwrites its oldest events, so the last `capacity`
+// events of every component are kept. The components hold a pointer to their
+// ring, nullptr (the default) disables the trace.
+//
+// write_chrome_trace() exports the rings in the Chrome trace event format,
+// which chrome://tracing and ui.perfetto.dev open.
+namespace trace {
+
+enum class EventType: uint8_t {
+    warmup_begin, warmup_end,
+    round_begin, round_end,
+    stall_begin, stall_end,
+    fetch_begin, fetch_end,             // dram -> bank
+    write_back_begin, write_back_end,   // bank -> dram
+    evict,
+    array_busy, array_idle,
+    pp_busy, pp_idle
+};
+
+struct Event {
+    int32_t cycle;
+    EventType type;
+    uint8_t tile_type;  // data_type of the tile
+    uint16_t bank;
+    int32_t round;
+    int32_t bytes;
+};
+
+class Ring{
+    public:
+        string name;
+
+        // capacity is rounded up to a power of two, clock is read at every event
+        Ring(string name, size_t capacity, int const* clock);
+
+        void record(EventType type, int round = 0, int tile_type = 0, int bank = 0, int bytes = 0){
+            Event& e = this->events_[this->no_events_ & this->mask_];
+            e.cycle = *this->clock_;
+            e.type = type;
+            e.tile_type = (uint8_t) tile_type;
+            e.bank = (uint16_t) bank;
+            e.round = round;
+            e.bytes = bytes;
+            this->no_events_++;
+        }
+
+        // events kept, the oldest first
+        size_t size() const;
+        Event const& operator[](size_t i) const;
+        // events overwritten since the ring became full
+        size_t dropped() const;
+
+    private:
+        vector<Event> events_;
+        size_t mask_;
+        size_t no_events_ {0};
+        int const* clock_;
+};
+
+class Recorder{
+    public:
+        // run_cycle_model advances the clocks of the arrays and post processors
+        int clock {0};
+        int pp_clock {0};
+
+        // the round loop, the dram, arrays, post processors, then x, w and p banks
+        vector<Ring*> rings;
+
+        // Creates a ring for every component of the compiler and attaches them.
+        Recorder(Compiler* compiler, size_t capacity);
+        // Detaches the rings from the components.
+        ~Recorder();
+
+        Ring* rounds();
+
+    private:
+        Compiler* compiler_;
+};
+
+// ts of the events in microseconds, freq in Hz
+void write_chrome_trace(Recorder const& recorder, float freq, ostream& out);
+void save_chrome_trace(Recorder const& recorder, float freq, string const& path);
+
+} // namespace trace
+
+#endif /* TRACE_HPP */
@@ -21,6 +21,12 @@ def calculate_peak_power(r_range, c_range, N, freq, e_data, e_compute, I_0, ict_
         p_interconnect = I_0 * N * N * sram_read
     elif ict_type == "bus":
         p_interconnect = I_0 * 1 * sram_read
+    elif ict_type in ("clos_rearrangeable", "clos_strict"):
+        # n inputs per ingress switch, r ingress/egress switches, m middle switches
+        n = 2 ** (int(np.ceil(np.log2(N))) // 2)
+        r = 2 ** int(np.ceil(np.log2(N))) // n
+        m = n if ict_type == "clos_rearrangeable" else 2 * n - 1
+        p_interconnect = I_0 * (2 * r * n * m + m * r * r) * sram_read
     else:
         raise NotImplementedError
 
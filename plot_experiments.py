@@ -9,6 +9,7 @@ import sys
 sys.path.append('.')
 
 from helpers import calculate_peak_power, calculate_peak_throughput
+from results_store import ResultsStore
 
 import itertools
 import numpy as np
@@ -44,6 +45,10 @@ batch_size = 1
 def get_result(target, fields, out_jsons):
     res = []
     for o in out_jsons:
+        if isinstance(o, ResultsStore):
+            res += o.values(target, **fields)
+            continue
+
         is_found = True
         for k in fields:
             if o[k] != fields[k]:
@@ -71,6 +76,11 @@ def get_result(target, fields, out_jsons):
 def parse_out_jsons(exp_dirs):
     out_jsons = []
     for exp_dir in exp_dirs:
+        # the runs of the experiment appended to a results store, if it has one
+        if os.path.exists(exp_dir + "/results.srs"):
+            out_jsons.append(ResultsStore(exp_dir + "/results.srs"))
+            continue
+
         files = os.listdir(exp_dir)
         
         for fname in files:
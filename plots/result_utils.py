@@ -19,6 +19,10 @@ class IctType(IntEnum):
     banyan_exp_2 = banyan | 2
     banyan_exp_3 = banyan | 3
     banyan_exp_4 = banyan | 4
+    bus = 16 << 4
+    clos = 32 << 4
+    clos_rearrangeable = clos | 0
+    clos_strict = clos | 1
 
 
 # TODO is there a better way to assign aliases to enum names?
@@ -33,6 +37,9 @@ def _icttype_str() -> Callable[[], Callable[[IctType], str]]:
         IctType.banyan_exp_2: "Butterfly-4",
         IctType.banyan_exp_3: "Butterfly-8",
         IctType.banyan_exp_4: "Butterfly-16",
+        IctType.bus: "Bus",
+        IctType.clos_rearrangeable: "Clos",
+        IctType.clos_strict: "Clos (strict-sense)",
     }
     def f(self: IctType) -> str:
         """
@@ -66,6 +73,7 @@ class ExpRes:
     Experiment results.
     """
     interconnect_tdp: float = None
+    interconnect_energy: float = None
     no_cycles: int = None
     no_main_rounds: int = None
     no_ops: int = None
@@ -0,0 +1,145 @@
+"""Writer for the binary precompiled model (precompiled_model.bin).
+
+The layout is documented in compiler/model_format.hpp, the records below must
+be kept in sync with the structs there.
+"""
+
+import json
+import struct
+
+MAGIC = b"SOSAMDL\0"
+BYTE_ORDER = 0x01020304
+VERSION = 3
+
+# LayerRecord tiling
+EXPLICIT_TILING = 0
+UNIFORM_TILING = 1
+UNTILED = 2
+
+HEADER = struct.Struct('<8sIIIIIIQIIQQQQQQQ')
+MODEL_RECORD = struct.Struct('<IIiIIIq')
+LAYER_RECORD = struct.Struct('<IIIIiiiiiiiiiiiIIIQQ')
+STR_REF = struct.Struct('<II')
+
+assert HEADER.size == 104 and MODEL_RECORD.size == 32 and LAYER_RECORD.size == 88
+
+
+def _align8(offset):
+    return (offset + 7) & ~7
+
+
+def _tile(tile_dim, i, j):
+    # keys are ints before the model is dumped to JSON, strings after
+    row = tile_dim[str(i)] if str(i) in tile_dim else tile_dim[i]
+    return row[str(j)] if str(j) in row else row[j]
+
+
+class _Writer:
+    def __init__(self):
+        self.models = []
+        self.layers = []
+        self.deps = []
+        self.dims = []
+        self.strings = bytearray()
+
+    def add_string(self, s):
+        data = s.encode("utf-8")
+        ref = (len(self.strings), len(data))
+        self.strings += data
+        return ref
+
+    def add_dims(self, tile_dim, rows, cols):
+        first = len(self.dims)
+        for i in range(rows):
+            for j in range(cols):
+                d = _tile(tile_dim, i, j)
+                self.dims += [int(d[0]), int(d[1])]
+        return first
+
+    def add_layer(self, layer, layer_name):
+        name = self.add_string(layer_name)
+        layer_type = self.add_string(layer["layer_type"])
+
+        first_dep = len(self.deps)
+        for dep in layer["deps"]:
+            self.deps.append(self.add_string(dep))
+        no_deps = len(self.deps) - first_dep
+
+        gemm_op = layer["gemm_op"]
+        has_gemm = 0
+        input_size = weight_size = (0, 0)
+        no_tiles = (0, 0, 0)
+        kernel_size = (-1, -1)
+        tiling = EXPLICIT_TILING
+        x_dims = w_dims = 0
+        if gemm_op is not None:
+            has_gemm = 1
+            input_size = gemm_op["input_size"]
+            weight_size = gemm_op["weight_size"]
+            if "kernel_size" in gemm_op:
+                kernel_size = gemm_op["kernel_size"]
+            if "no_tiles" not in gemm_op:
+                # only the GEMM shape, the compiler tiles it
+                tiling = UNTILED
+            elif "tile_size" in gemm_op:
+                no_tiles = gemm_op["no_tiles"]
+                tiling = UNIFORM_TILING
+                x_dims = w_dims = len(self.dims)
+                self.dims += [int(t) for t in gemm_op["tile_size"][:3]]
+            else:
+                no_tiles = gemm_op["no_tiles"]
+                x_dims = self.add_dims(gemm_op["x_tile_dim"], no_tiles[0], no_tiles[1])
+                w_dims = self.add_dims(gemm_op["w_tile_dim"], no_tiles[1], no_tiles[2])
+
+        self.layers.append(LAYER_RECORD.pack(
+            *name, *layer_type, int(layer["raw_input"]), has_gemm,
+            int(input_size[0]), int(input_size[1]), int(weight_size[0]), int(weight_size[1]),
+            int(no_tiles[0]), int(no_tiles[1]), int(no_tiles[2]),
+            int(kernel_size[0]), int(kernel_size[1]),
+            first_dep, no_deps, tiling, x_dims, w_dims))
+
+    def add_model(self, model, model_name):
+        name = self.add_string(model_name)
+        first_layer = len(self.layers)
+        for layer_name in model["order"]:
+            self.add_layer(model["layers"][layer_name], layer_name)
+        no_layers = len(self.layers) - first_layer
+        self.models.append(MODEL_RECORD.pack(
+            *name, int(model["no_repeat"]), first_layer, no_layers, 0, int(model.get("no_ops", 0))))
+
+
+def write_model_file(json_out, path):
+    """Writes the precompiled model dictionary (as dumped to
+    precompiled_model.json) in the binary format."""
+    w = _Writer()
+    # the compiler reads args as compact JSON with sorted keys
+    args = w.add_string(json.dumps(json_out.get("args", {}), separators=(',', ':'), sort_keys=True, ensure_ascii=False))
+
+    # models in the order the compiler iterates the JSON object
+    for model_name in sorted(k for k in json_out if k != "args"):
+        w.add_model(json_out[model_name], model_name)
+
+    models_offset = _align8(HEADER.size)
+    layers_offset = _align8(models_offset + len(w.models) * MODEL_RECORD.size)
+    deps_offset = _align8(layers_offset + len(w.layers) * LAYER_RECORD.size)
+    dims_offset = _align8(deps_offset + len(w.deps) * STR_REF.size)
+    strings_offset = _align8(dims_offset + len(w.dims) * 4)
+    file_size = strings_offset + len(w.strings)
+
+    buffer = bytearray(file_size)
+    buffer[0:HEADER.size] = HEADER.pack(
+        MAGIC, BYTE_ORDER, VERSION, len(w.models), len(w.layers), len(w.deps), 0,
+        len(w.dims), *args,
+        models_offset, layers_offset, deps_offset, dims_offset, strings_offset, len(w.strings), file_size)
+
+    def put(offset, data):
+        buffer[offset:offset + len(data)] = data
+
+    put(models_offset, b"".join(w.models))
+    put(layers_offset, b"".join(w.layers))
+    put(deps_offset, b"".join(STR_REF.pack(*d) for d in w.deps))
+    put(dims_offset, struct.pack('<%di' % len(w.dims), *w.dims))
+    put(strings_offset, w.strings)
+
+    with open(path, "wb") as outfile:
+        outfile.write(buffer)
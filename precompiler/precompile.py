@@ -21,6 +21,7 @@ import graph
 from graph import convert_keras_to_graph
 
 from benchmarks import benchmark, get_benchmarks
+import model_format
 
 import argparse
 
@@ -65,7 +66,7 @@ def split_mat(x_size, w_size, array_size, tile_first_dim=None):
     return x_tile_dim, w_tile_dim, no_batch_tile, no_row_tile, no_col_tile
 
 
-def partition_layer(layer_node, array_size, partition_size):
+def partition_layer(layer_node, array_size, partition_size, tiling='untiled'):
     if layer_node.layer_type == 'Conv2D' or layer_node.layer_type == 'Dense':
         gemm_info = {}
 
@@ -78,11 +79,20 @@ def partition_layer(layer_node, array_size, partition_size):
         gemm_info["input_size"] = input_size
         gemm_info["weight_size"] = weight_size
 
+        # untiled: only the GEMM shape, the compiler tiles it for its --no_rows/--no_cols/--partition_size
+        if tiling == 'untiled':
+            return gemm_info
+
         x_tile_dim, w_tile_dim, no_batch_tile, no_row_tile, no_col_tile = split_mat(input_size, weight_size, array_size, partition_size)
         no_tiles = (no_batch_tile, no_row_tile, no_col_tile)
 
-        gemm_info["x_tile_dim"] = x_tile_dim
-        gemm_info["w_tile_dim"] = w_tile_dim
+        if tiling == 'explicit':
+            gemm_info["x_tile_dim"] = x_tile_dim
+            gemm_info["w_tile_dim"] = w_tile_dim
+        else:
+            # all tiles but the last row/column are of this size, the compiler derives the edge tiles
+            no_row, no_col = array_size
+            gemm_info["tile_size"] = (no_row if partition_size is None else partition_size, no_row, no_col)
         gemm_info["no_tiles"] = no_tiles
         
 
@@ -100,7 +110,7 @@ def all_dependencies_scheduled(layer_name, graph, layer_schedules):
 
     return True
 
-def precompile_model(model, array_size, partition_size=None):
+def precompile_model(model, array_size, partition_size=None, tiling='untiled'):
     graph = convert_keras_to_graph(model)
 
     raw_input = 1
@@ -108,7 +118,7 @@ def precompile_model(model, array_size, partition_size=None):
     layers = OrderedDict()
     for layer_name in graph.get_layer_names():
         layer_node = graph.get_node(layer_name)
-        gemm_op = partition_layer(layer_node, array_size, partition_size)
+        gemm_op = partition_layer(layer_node, array_size, partition_size, tiling)
 
         dependencies = [s.layer_name for s in layer_node.src]
         
@@ -131,6 +141,8 @@ def main():
     parser.add_argument('--partition_size', type=int, required=False, default=None)
     parser.add_argument('--read_only', type=int, required=False, default=1)
     parser.add_argument('--enable_schedule_duplication', type=int, required=False, default=1)
+    parser.add_argument('--tiling', type=str, choices=['untiled', 'uniform', 'explicit'], required=False, default='untiled', help='untiled GEMM shapes that the compiler tiles for its array size, or tiles for --array_size/--partition_size: uniform tile size or the dims of every tile')
+    parser.add_argument('--output_format', type=str, choices=['json', 'bin', 'both'], required=False, default='both', help='precompiled_model.json and/or the binary precompiled_model.bin mapped by the compiler')
 
     args = parser.parse_args()
 
@@ -158,12 +170,16 @@ def main():
             keras_model = bm.get_keras_model() 
             no_repeat = 1
 
-        layers = precompile_model(keras_model, array_size=array_size, partition_size=partition_size)
+        layers = precompile_model(keras_model, array_size=array_size, partition_size=partition_size, tiling=args.tiling)
         json_out[m] = {"order":list(layers.keys()), "layers":layers, "no_repeat":no_repeat, "no_ops":bm.no_ops}
     
     os.makedirs(out_dir, exist_ok=True)
-    with open(out_dir+"/precompiled_model.json", "w") as outfile:  
-        json.dump(json_out, outfile)
+    if args.output_format in ('json', 'both'):
+        with open(out_dir+"/precompiled_model.json", "w") as outfile:  
+            json.dump(json_out, outfile)
+    if args.output_format in ('bin', 'both'):
+        # the round trip converts the tile keys and numpy values as json.dump does
+        model_format.write_model_file(json.loads(json.dumps(json_out)), out_dir+"/precompiled_model.bin")
 
     print("precompiled model is saved at: {}".format(out_dir))
 
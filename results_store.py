@@ -0,0 +1,167 @@
+"""Reader of the columnar results store (results.srs), to which compiler_st,
+run_cycle_model and pythonbinder append the results of their runs with
+--results_store / results_store=.
+
+The layout is documented in compiler/results_store.hpp, the records below must
+be kept in sync with the structs there. The file is mapped with numpy, every
+column is read as one array.
+
+    store = ResultsStore("experiments/run-.../results.srs")
+    store.get("no_cycles", model="resnet50", no_array=64, array_size=[32, 32])
+"""
+
+import struct
+
+import numpy as np
+
+MAGIC = b"SOSARES\0"
+BYTE_ORDER = 0x01020304
+VERSION = 1
+
+# ColumnRecord type
+INT64 = 0
+FLOAT64 = 1
+STRING = 2
+KEY = 3
+
+HEADER = struct.Struct('<8sIIIIQQQQQ')
+COLUMN_RECORD = struct.Struct('<40sIIIIQ')
+
+assert HEADER.size == 64 and COLUMN_RECORD.size == 64
+
+_FNV_OFFSET = 0xcbf29ce484222325
+_FNV_PRIME = 0x100000001b3
+
+
+def _fnv1a(data, h=_FNV_OFFSET):
+    for b in data:
+        h = ((h ^ b) * _FNV_PRIME) & 0xffffffffffffffff
+    return h
+
+
+class Column:
+    def __init__(self, record):
+        name, self.type, self.width, is_config, _, self.offset = COLUMN_RECORD.unpack(record)
+        self.name = name.rstrip(b"\0").decode("utf-8")
+        self.is_config = bool(is_config)
+
+    @property
+    def dtype(self):
+        return {INT64: '<i8', FLOAT64: '<f8', STRING: 'S{}'.format(self.width), KEY: '<u8'}[self.type]
+
+    def missing(self):
+        return {INT64: -1, FLOAT64: float('nan'), STRING: "", KEY: 0}[self.type]
+
+    def pack(self, value):
+        """The value as the compiler stores it."""
+        if self.type == STRING:
+            if isinstance(value, (list, tuple)):
+                value = ",".join(value)
+            return value.encode("utf-8").ljust(self.width, b"\0")
+        if self.type == FLOAT64:
+            return struct.pack('<d', value)
+        return struct.pack('<q', value)
+
+
+class ResultsStore:
+    def __init__(self, path):
+        self._data = np.memmap(path, dtype=np.uint8, mode='r')
+        if len(self._data) < HEADER.size:
+            raise ValueError("{} is not a results store".format(path))
+
+        (magic, byte_order, version, no_columns, self.block_rows, self.no_rows, self.no_blocks,
+         columns_offset, self._blocks_offset, self._block_size) = HEADER.unpack_from(self._data, 0)
+        if magic != MAGIC or byte_order != BYTE_ORDER:
+            raise ValueError("{} is not a results store".format(path))
+        if version != VERSION:
+            raise ValueError("Unsupported results store version {}".format(version))
+        if self._blocks_offset + self.no_blocks * self._block_size > len(self._data):
+            raise ValueError("{} is truncated".format(path))
+
+        self.columns = {}
+        for i in range(no_columns):
+            offset = columns_offset + i * COLUMN_RECORD.size
+            column = Column(bytes(self._data[offset:offset + COLUMN_RECORD.size]))
+            self.columns[column.name] = column
+
+        self._values = {}
+        self._index = None
+
+    def __len__(self):
+        return self.no_rows
+
+    def column(self, name):
+        """The values of a column, strings are decoded."""
+        if name not in self._values:
+            c = self.columns[name]
+            blocks = np.ndarray((self.no_blocks, self.block_rows), dtype=c.dtype, buffer=self._data,
+                                offset=self._blocks_offset + c.offset, strides=(self._block_size, c.width))
+            values = blocks.reshape(-1)[:self.no_rows]
+            if c.type == STRING:
+                values = np.char.decode(values, "utf-8")
+            self._values[name] = values
+        return self._values[name]
+
+    def config_key(self, **config):
+        """config_key of a configuration, the fields it leaves out are missing."""
+        h = _FNV_OFFSET
+        for c in self.columns.values():
+            if c.is_config:
+                h = _fnv1a(c.pack(config.get(c.name, c.missing())), h)
+        return h
+
+    def _conditions(self, fields):
+        conditions = {}
+        for name, value in fields.items():
+            # array_size selects the shape of the arrays, stored in two columns
+            if name == "array_size":
+                conditions["array_rows"], conditions["array_cols"] = value
+            elif isinstance(value, (list, tuple)):
+                conditions[name] = ",".join(value)
+            else:
+                conditions[name] = value
+        return conditions
+
+    def find(self, **fields):
+        """Rows whose fields have the given values, in the order of the runs.
+        A complete configuration is looked up in the config_key index, a
+        partial one is compared column by column."""
+        conditions = self._conditions(fields)
+        config = [c.name for c in self.columns.values() if c.is_config]
+
+        if set(conditions) == set(config):
+            if self._index is None:
+                keys = self.column("config_key")
+                order = np.argsort(keys, kind="stable")
+                self._index = (keys[order], order)
+            keys, order = self._index
+            key = self.config_key(**conditions)
+            return order[np.searchsorted(keys, key, "left"):np.searchsorted(keys, key, "right")]
+
+        mask = np.ones(self.no_rows, dtype=bool)
+        for name, value in conditions.items():
+            mask &= self.column(name) == value
+        return np.flatnonzero(mask)
+
+    def values(self, target, **fields):
+        """Values of target of the rows matching fields."""
+        return self.column(target)[self.find(**fields)].tolist()
+
+    def get(self, target, **fields):
+        """Value of target of the runs matching fields, as get_result of
+        plot_experiments.py: it is an error if there is none or if they differ."""
+        values = self.values(target, **fields)
+        if len(values) == 0:
+            raise ValueError("Result not found for {}".format(fields))
+        if any(v != values[0] for v in values[1:]):
+            raise ValueError("Multiple different results found for {}".format(fields))
+        return values[0]
+
+    def row(self, i):
+        """The fields of a row, without the missing ones."""
+        out = {}
+        for name, c in self.columns.items():
+            value = self.column(name)[i].item()
+            if c.type == KEY or not (value == c.missing() or value != value):
+                out[name] = value
+        return out
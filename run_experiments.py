@@ -8,6 +8,9 @@ import numpy as np
 NO_PROCS = 32
 running_procs = []
 
+# compiled schedules, reused by the runs that differ only in the memory bandwidth or prefetch
+SCHEDULE_CACHE = "experiments/schedule_cache"
+
 def is_proc_ended(proc):
     retcode = proc.poll()
     if retcode is not None: # Process finished.
@@ -93,7 +96,9 @@ def memory_experiment():
                     -M {MEMORY_BW} \
                     -S {BANK_SIZE} \
                     -I {INTERCONN} \
-                    -d {OUT_DIR}"
+                    -d {OUT_DIR} \
+                    --schedule_cache {SCHEDULE_CACHE} \
+                    --results_store {exp_dir}/results.srs"
                 
                 cmd = cmd1 + " && " + cmd2
                 p = subprocess.Popen(cmd, shell=True)
@@ -155,7 +160,9 @@ def interconnect_experiment():
                     -M {MEMORY_BW} \
                     -S {BANK_SIZE} \
                     -I {INTERCONN} \
-                    -d {OUT_DIR}"
+                    -d {OUT_DIR} \
+                    --schedule_cache {SCHEDULE_CACHE} \
+                    --results_store {exp_dir}/results.srs"
 
                 cmd = cmd1 + " && " + cmd2
                 p = subprocess.Popen(cmd, shell=True)
@@ -207,7 +214,9 @@ def bank_size_experiment():
                     -M {MEMORY_BW} \
                     -S {BANK_SIZE} \
                     -I {INTERCONN} \
-                    -d {OUT_DIR}"
+                    -d {OUT_DIR} \
+                    --schedule_cache {SCHEDULE_CACHE} \
+                    --results_store {exp_dir}/results.srs"
                 
                 cmd = cmd1 + " && " + cmd2
                 p = subprocess.Popen(cmd, shell=True)
@@ -266,7 +275,9 @@ def multi_batch_experiment():
                 -M {MEMORY_BW} \
                 -S {BANK_SIZE} \
                 -I {INTERCONN} \
-                -d {OUT_DIR}"
+                -d {OUT_DIR} \
+                --schedule_cache {SCHEDULE_CACHE} \
+                --results_store {exp_dir}/results.srs"
             
             cmd = cmd1 + " && " + cmd2
             p = subprocess.Popen(cmd, shell=True)
@@ -339,7 +350,9 @@ def array_scale_experiment():
                 -M {MEMORY_BW} \
                 -S {bank_size_norm} \
                 -I {INTERCONN} \
-                -d {OUT_DIR}"
+                -d {OUT_DIR} \
+                --schedule_cache {SCHEDULE_CACHE} \
+                --results_store {exp_dir}/results.srs"
             
             cmd = cmd1 + " && " + cmd2
             p = subprocess.Popen(cmd, shell=True)
@@ -402,7 +415,10 @@ def partition_size_experiment():
                 -M {MEMORY_BW} \
                 -S {BANK_SIZE} \
                 -I {INTERCONN} \
-                -d {OUT_DIR}"
+                --partition_size {PARTITION_SIZE} \
+                -d {OUT_DIR} \
+                --schedule_cache {SCHEDULE_CACHE} \
+                --results_store {exp_dir}/results.srs"
 
             cmd = cmd1 + " && " + cmd2
             p = subprocess.Popen(cmd, shell=True)